@@ -17,8 +17,13 @@
 #include "control_wm8731.h"
 #include "control_cs42448.h"
 #include "control_sgtl5000.h"
+#include "effect_asrc.h"
+#include "effect_convolution.h"
+#include "effect_delay.h"
+#include "effect_dynamics.h"
 #include "effect_reverb.h"
 #include "effect_freeverb.h"
+#include "filter_biquad_bank.h"
 #include "input_i2s.h"
 #include "input_tdm.h"
 #include "input_teensy_quad.h"
@@ -48,7 +53,6 @@
     #include "effect_flange.h"
     #include "effect_envelope.h"
     #include "effect_multiply.h"
-    #include "effect_delay.h"
     #include "effect_delay_ext.h"
     #include "effect_midside.h"
     #include "effect_waveshaper.h"
@@ -0,0 +1,165 @@
+// AudioBench.cpp
+
+#include "AudioBench.h"
+#include <circle/timer.h>
+#include <circle/machineinfo.h>
+#include <math.h>
+
+#define SIGNAL_BLOCKS    8		// distinct synthetic input blocks
+
+static bool    signal_inited;
+static int16_t signal_data[SIGNAL_BLOCKS][AUDIO_BLOCK_SAMPLES];
+
+
+void AudioBench::initSignal()
+	// a sine sweep at about -6db with some noise on it,
+	// so nothing can take a shortcut on silence
+{
+	u32 seed = 12345;
+	float phase = 0.0;
+	for (u16 b=0; b<SIGNAL_BLOCKS; b++)
+	{
+		float inc = 2.0 * M_PI * (220.0 * (b + 1)) / AUDIO_SAMPLE_RATE;
+		for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			s32 noise = ((s32) (seed >> 16) & 0x3ff) - 512;
+			signal_data[b][i] = (int16_t) (16000.0 * sinf(phase)) + noise;
+			phase += inc;
+		}
+	}
+	signal_inited = 1;
+}
+
+
+const int16_t *AudioBench::getSignal(u32 block)
+{
+	if (!signal_inited)
+		initSignal();
+	return signal_data[block % SIGNAL_BLOCKS];
+}
+
+
+void AudioBench::feedInputs(AudioStream *stream, u32 block)
+{
+	for (u16 i=0; i<stream->m_numInputs; i++)
+	{
+		if (stream->m_inputQueue[i])
+			AudioSystem::release(stream->m_inputQueue[i]);
+		audio_block_t *in = AudioSystem::allocate();
+		if (in)
+			memcpy(in->data, getSignal(block + i), AUDIO_BLOCK_BYTES);
+		stream->m_inputQueue[i] = in;
+	}
+}
+
+
+u32 AudioBench::countAllocs()
+{
+	return
+		AudioSystem::getPoolAllocs(AUDIO_BLOCK_CLASS_16) +
+		AudioSystem::getPoolAllocs(AUDIO_BLOCK_CLASS_32) +
+		AudioSystem::getPoolAllocs(AUDIO_BLOCK_CLASS_RAW);
+}
+
+
+void AudioBench::printHeader()
+{
+	printf("device,inputs,outputs,blocks,ns_per_block,cycles_per_sample,allocs_per_block\n");
+}
+
+
+void AudioBench::print(const char *name, s16 instance, u16 num_in, u16 num_out,
+	u32 num_blocks, u32 us, u32 allocs)
+{
+	float ns = ((float) us) * 1000.0 / num_blocks;
+	float mhz = CMachineInfo::Get()->GetClockRate(CLOCK_ID_ARM) / 1000000.0;
+	float cycles = ns * mhz / 1000.0 / AUDIO_BLOCK_SAMPLES;
+	if (instance >= 0)
+		printf("%s%d,",name,instance);
+	else
+		printf("%s,",name);
+	printf("%d,%d,%d,%0.0f,%0.2f,%0.2f\n",
+		num_in,num_out,num_blocks,ns,cycles,
+		((float) allocs) / num_blocks);
+}
+
+
+void AudioBench::run(AudioStream *stream, u32 num_blocks)
+{
+	if (!signal_inited)
+		initSignal();
+
+	// the cost of the inputs alone
+
+	u32 start = CTimer::GetClockTicks();
+	for (u32 b=0; b<num_blocks; b++)
+	{
+		feedInputs(stream,b);
+		stream->releaseInputs();
+	}
+	u32 overhead = CTimer::GetClockTicks() - start;
+
+	// and with update()
+
+	u32 allocs = countAllocs();
+
+	start = CTimer::GetClockTicks();
+	for (u32 b=0; b<num_blocks; b++)
+	{
+		feedInputs(stream,b);
+		stream->update();
+	}
+	u32 us = CTimer::GetClockTicks() - start;
+	stream->releaseInputs();
+
+	allocs = countAllocs() - allocs - num_blocks * stream->m_numInputs;
+
+	print(stream->getName(),stream->getInstance(),
+		stream->m_numInputs,stream->m_numOutputs,
+		num_blocks, us > overhead ? us - overhead : 0, allocs);
+}
+
+
+void AudioBench::runChain(const char *name, AudioStream **chain, u16 num_streams, u32 num_blocks)
+{
+	if (!signal_inited)
+		initSignal();
+
+	AudioStream *first = chain[0];
+	AudioStream *last = chain[num_streams - 1];
+
+	u32 start = CTimer::GetClockTicks();
+	for (u32 b=0; b<num_blocks; b++)
+	{
+		feedInputs(first,b);
+		first->releaseInputs();
+	}
+	u32 overhead = CTimer::GetClockTicks() - start;
+	u32 allocs = countAllocs();
+
+	start = CTimer::GetClockTicks();
+	for (u32 b=0; b<num_blocks; b++)
+	{
+		feedInputs(first,b);
+		for (u16 i=0; i<num_streams; i++)
+			chain[i]->update();
+	}
+	u32 us = CTimer::GetClockTicks() - start;
+	for (u16 i=0; i<num_streams; i++)
+		chain[i]->releaseInputs();
+	allocs = countAllocs() - allocs - num_blocks * first->m_numInputs;
+
+	print(name,-1,first->m_numInputs,last->m_numOutputs,
+		num_blocks, us > overhead ? us - overhead : 0, allocs);
+}
+
+
+void AudioBench::runKernel(const char *name, void (*kernel)(), u32 num_blocks)
+{
+	u32 start = CTimer::GetClockTicks();
+	for (u32 b=0; b<num_blocks; b++)
+		(*kernel)();
+	u32 us = CTimer::GetClockTicks() - start;
+	print(name,-1,0,0,num_blocks,us,0);
+}
@@ -0,0 +1,62 @@
+// AudioBench.h
+//
+// Measures the cost of AudioStreams in isolation.  The stream
+// does not need to be connected.  run() feeds every input with a
+// fresh synthetic block, calls update() directly num_blocks times,
+// and prints one CSV line:
+//
+//     device,inputs,outputs,blocks,ns_per_block,cycles_per_sample,allocs_per_block
+//
+// The cost of building and releasing the input blocks is measured
+// separately and subtracted, as are the input allocations.  Cycles
+// are derived from the ARM clock rate, not counted.
+//
+// runChain() times a chain of streams that the caller has already
+// connected, updated in the order given, with only the first one
+// fed.  It includes the transmit()/release() traffic between them,
+// which run() does not see.
+//
+// runKernel() does what run() does for a plain function, i.e. the dma
+// buffer de/interleave kernels of the i/o devices, which cannot
+// be instantiated without starting the hardware.
+//
+// step() is a single update() of one stream, untimed, for tests
+// that clock a hand connected chain themselves and check its output.
+//
+// The AudioSystem must have been initialized with enough blocks.
+
+#ifndef AudioBench_h
+#define AudioBench_h
+
+#include "AudioStream.h"
+
+#define AUDIO_BENCH_BLOCKS     4000
+
+
+class AudioBench
+{
+public:
+
+	static void printHeader();
+	static void run(AudioStream *stream, u32 num_blocks = AUDIO_BENCH_BLOCKS);
+	static void runChain(const char *name, AudioStream **chain, u16 num_streams,
+		u32 num_blocks = AUDIO_BENCH_BLOCKS);
+	static void runKernel(const char *name, void (*kernel)(), u32 num_blocks = AUDIO_BENCH_BLOCKS);
+
+	static void step(AudioStream *stream)	{ stream->update(); }
+
+	static const int16_t *getSignal(u32 block);
+		// the synthetic input for the nth block
+
+private:
+
+	static u32  countAllocs();
+	static void feedInputs(AudioStream *stream, u32 block);
+	static void print(const char *name, s16 instance, u16 num_in, u16 num_out,
+		u32 num_blocks, u32 us, u32 allocs);
+	static void initSignal();
+
+};
+
+
+#endif	// !AudioBench_h
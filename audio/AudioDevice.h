@@ -65,6 +65,7 @@ public:
     
 private:
     friend class AudioSystem;
+    friend class AudioGraph;
     
     static AudioCodec *s_pCodec;
 };
@@ -0,0 +1,463 @@
+// AudioGraph.cpp
+
+#include "Audio.h"
+#include "AudioGraph.h"
+#include "AudioGraphFormat.h"
+#include <circle/logger.h>
+#include <circle/alloc.h>
+#include <fatfs/ff.h>
+
+#define log_name "graph"
+
+#define ARENA_ALIGN     16
+
+u16           AudioGraph::s_numDevices = 0;
+AudioDevice **AudioGraph::s_devices = 0;
+u8           *AudioGraph::s_pArena = 0;
+u32           AudioGraph::s_arenaBytes = 0;
+
+
+// placement into the arena, tagged so as not to
+// depend on, or clash with, any other placement new
+
+struct graph_arena_t {};
+inline void *operator new(size_t size, void *mem, graph_arena_t)
+{
+	return mem;
+}
+
+
+//------------------------------------------
+// device tables
+//------------------------------------------
+
+#define X(id, name, in, out, params)    name,
+static const char *graph_type_name[] = { AUDIO_GRAPH_TYPES };
+#undef X
+
+#define X(id, name, in, out, params)    in,
+static const u8 graph_type_inputs[] = { AUDIO_GRAPH_TYPES };
+#undef X
+
+#define X(id, name, in, out, params)    out,
+static const u8 graph_type_outputs[] = { AUDIO_GRAPH_TYPES };
+#undef X
+
+#define X(id, name, in, out, params)    params,
+static const u32 graph_type_params[] = { AUDIO_GRAPH_TYPES };
+#undef X
+
+
+// C(type, class, constructor args)
+
+#define GRAPH_CLASSES \
+	C(I2SI,         AudioInputI2S,                      ())                         \
+	C(I2SO,         AudioOutputI2S,                     ())                         \
+	C(TDMI,         AudioInputTDM,                      ())                         \
+	C(TDMO,         AudioOutputTDM,                     ())                         \
+	C(MIXER,        AudioMixer4,                        ())                         \
+	C(AMP,          AudioAmplifier,                     ())                         \
+	C(FREEVERB,     AudioEffectFreeverb,                ())                         \
+	C(FREEVERBS,    AudioEffectFreeverbStereo,          ())                         \
+	C(REVERB,       AudioEffectReverb,                  ())                         \
+	C(SINE,         AudioSynthWaveformSine,             ())                         \
+	C(SINE_HIRES,   AudioSynthWaveformSineHires,        ())                         \
+	C(SINE_MOD,     AudioSynthWaveformSineModulated,    ())                         \
+	C(PEAK,         AudioAnalyzePeak,                   ())                         \
+	C(RECORDER,     AudioRecorder,                      ())                         \
+	C(DELAY,        AudioEffectDelay,                   (arg > 0 ? arg : 1000.0))   \
+	C(ASRC,         AudioEffectASRC,                    ())                         \
+	C(DYNAMICS,     AudioEffectDynamics,                ())                         \
+	C(BIQUADS,      AudioFilterBiquadBank,              ())                         \
+	C(WM8731,       AudioControlWM8731,                 ())                         \
+	C(WM8731S,      AudioControlWM8731Slave,            ())                         \
+	C(CS42448,      AudioControlCS42448,                ())                         \
+	C(SGTL5000,     AudioControlSGTL5000,               ())                         \
+
+
+static u32 deviceBytes(u8 type)
+{
+	#define C(id, cls, args)	case AUDIO_GRAPH_TYPE_##id : return sizeof(cls);
+	switch (type)
+	{
+		GRAPH_CLASSES
+	}
+	#undef C
+	return 0;
+}
+
+
+static AudioDevice *createDevice(u8 type, void *mem, float arg)
+{
+	#define C(id, cls, args)	case AUDIO_GRAPH_TYPE_##id : return new (mem, graph_arena_t()) cls args;
+	switch (type)
+	{
+		GRAPH_CLASSES
+	}
+	#undef C
+	return 0;
+}
+
+
+static void destroyDevice(u8 type, AudioDevice *dev)
+	// the destructors are not virtual, so by type
+{
+	#define C(id, cls, args)	case AUDIO_GRAPH_TYPE_##id : ((cls *) dev)->~cls(); break;
+	switch (type)
+	{
+		GRAPH_CLASSES
+	}
+	#undef C
+}
+
+
+static u32 arenaRound(u32 bytes)
+{
+	return (bytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+
+//------------------------------------------
+// parameters
+//------------------------------------------
+
+// a biquad q is held until the lowpass or highpass it precedes
+
+static AudioDevice *biquad_q_dev = 0;
+static u8           biquad_q_index = 0;
+static float        biquad_q = 0.0;
+
+
+static void setParam(u8 type, AudioDevice *dev, u8 param, u8 index, float value)
+	// the param and index have already been checked by validate()
+{
+	#define IS(p)	(param == AUDIO_GRAPH_PARAM_##p)
+
+	switch (type)
+	{
+		case AUDIO_GRAPH_TYPE_MIXER :
+			((AudioMixer4 *) dev)->gain(index, value);
+			break;
+		case AUDIO_GRAPH_TYPE_AMP :
+			((AudioAmplifier *) dev)->gain(value);
+			break;
+		case AUDIO_GRAPH_TYPE_FREEVERB :
+			if (IS(ROOMSIZE)) ((AudioEffectFreeverb *) dev)->roomsize(value);
+			if (IS(DAMPING))  ((AudioEffectFreeverb *) dev)->damping(value);
+			break;
+		case AUDIO_GRAPH_TYPE_FREEVERBS :
+			if (IS(ROOMSIZE)) ((AudioEffectFreeverbStereo *) dev)->roomsize(value);
+			if (IS(DAMPING))  ((AudioEffectFreeverbStereo *) dev)->damping(value);
+			break;
+		case AUDIO_GRAPH_TYPE_REVERB :
+			((AudioEffectReverb *) dev)->reverbTime(value);
+			break;
+		case AUDIO_GRAPH_TYPE_SINE :
+			if (IS(FREQUENCY)) ((AudioSynthWaveformSine *) dev)->frequency(value);
+			if (IS(AMPLITUDE)) ((AudioSynthWaveformSine *) dev)->amplitude(value);
+			break;
+		case AUDIO_GRAPH_TYPE_SINE_HIRES :
+			if (IS(FREQUENCY)) ((AudioSynthWaveformSineHires *) dev)->frequency(value);
+			if (IS(AMPLITUDE)) ((AudioSynthWaveformSineHires *) dev)->amplitude(value);
+			break;
+		case AUDIO_GRAPH_TYPE_SINE_MOD :
+			if (IS(FREQUENCY)) ((AudioSynthWaveformSineModulated *) dev)->frequency(value);
+			if (IS(AMPLITUDE)) ((AudioSynthWaveformSineModulated *) dev)->amplitude(value);
+			break;
+		case AUDIO_GRAPH_TYPE_RECORDER :
+			((AudioRecorder *) dev)->setRecordMask((u16) value);
+			break;
+		case AUDIO_GRAPH_TYPE_DELAY :
+			if (IS(DELAY))    ((AudioEffectDelay *) dev)->setDelay(index, value);
+			if (IS(FEEDBACK)) ((AudioEffectDelay *) dev)->setFeedback(index, value);
+			break;
+		case AUDIO_GRAPH_TYPE_ASRC :
+			if (IS(RATIO))  ((AudioEffectASRC *) dev)->setRatio(value);
+			if (IS(LOCKED)) ((AudioEffectASRC *) dev)->setLocked(value != 0);
+			break;
+		case AUDIO_GRAPH_TYPE_DYNAMICS :
+		{
+			AudioEffectDynamics *p = (AudioEffectDynamics *) dev;
+			if (IS(MODE))       p->setMode((u8) value);
+			if (IS(THRESHOLD))  p->setThreshold(value);
+			if (IS(RATIO))      p->setRatio(value);
+			if (IS(CEILING))    p->setCeiling(value);
+			if (IS(MAKEUP))     p->setMakeup(value);
+			if (IS(RANGE))      p->setRange(value);
+			if (IS(ATTACK))     p->setAttack(value);
+			if (IS(RELEASE))    p->setRelease(value);
+			if (IS(LOOKAHEAD))  p->setLookahead(value);
+			if (IS(DETECT_RMS)) p->setDetectRMS(value != 0);
+			break;
+		}
+		case AUDIO_GRAPH_TYPE_BIQUADS :
+		{
+			AudioFilterBiquadBank *p = (AudioFilterBiquadBank *) dev;
+			float q = 0.7071;
+			if (IS(Q))
+			{
+				biquad_q_dev = dev;
+				biquad_q_index = index;
+				biquad_q = value;
+				break;
+			}
+			if (biquad_q_dev == dev && biquad_q_index == index)
+			{
+				q = biquad_q;
+				biquad_q_dev = 0;
+			}
+			if (IS(LOWPASS))  p->setLowpass(index >> 4, index & 15, value, q);
+			if (IS(HIGHPASS)) p->setHighpass(index >> 4, index & 15, value, q);
+			break;
+		}
+		case AUDIO_GRAPH_TYPE_WM8731 :
+		case AUDIO_GRAPH_TYPE_WM8731S :
+		case AUDIO_GRAPH_TYPE_CS42448 :
+		case AUDIO_GRAPH_TYPE_SGTL5000 :
+			if (IS(VOLUME))      ((AudioCodec *) dev)->volume(value);
+			if (IS(INPUT_LEVEL)) ((AudioCodec *) dev)->inputLevel(value);
+			break;
+	}
+
+	#undef IS
+}
+
+
+//------------------------------------------
+// load
+//------------------------------------------
+
+static bool indexOK(u8 type, u8 index)
+	// the index of a param against the channels, taps or
+	// stages of the device, and zero if it takes none
+{
+	switch (type)
+	{
+		case AUDIO_GRAPH_TYPE_MIXER :
+			return index < graph_type_inputs[type];
+		case AUDIO_GRAPH_TYPE_DELAY :
+			return index < AUDIO_DELAY_TAPS;
+		case AUDIO_GRAPH_TYPE_BIQUADS :
+			return (index >> 4) < BIQUAD_BANK_CHANNELS &&
+				(index & 15) < BIQUAD_BANK_STAGES;
+	}
+	return !index;
+}
+
+
+static bool validate(
+	const audio_graph_header_t *hdr,
+	const audio_graph_device_t *devs,
+	const audio_graph_connection_t *cons,
+	const audio_graph_param_t *params)
+	// everything is checked before anything is created
+{
+	for (u16 i=0; i<hdr->num_devices; i++)
+	{
+		if (devs[i].type >= AUDIO_GRAPH_NUM_TYPES)
+		{
+			LOG_ERROR("device(%d) unknown type(%d)",i,devs[i].type);
+			return false;
+		}
+		if (i && devs[i].depth < devs[i-1].depth)
+		{
+			LOG_ERROR("device(%d) %s is out of order",i,graph_type_name[devs[i].type]);
+			return false;
+		}
+	}
+	for (u16 i=0; i<hdr->num_connections; i++)
+	{
+		const audio_graph_connection_t *c = &cons[i];
+		if (c->src >= hdr->num_devices ||
+			c->dest >= hdr->num_devices ||
+			c->src_port >= graph_type_outputs[devs[c->src].type] ||
+			c->dest_port >= graph_type_inputs[devs[c->dest].type] ||
+			devs[c->dest].depth <= devs[c->src].depth)
+		{
+			LOG_ERROR("bad connection(%d) %d:%d -> %d:%d",
+				i,c->src,c->src_port,c->dest,c->dest_port);
+			return false;
+		}
+	}
+	for (u16 i=0; i<hdr->num_params; i++)
+	{
+		const audio_graph_param_t *p = &params[i];
+		if (p->device >= hdr->num_devices ||
+			p->param >= AUDIO_GRAPH_NUM_PARAMS ||
+			!(graph_type_params[devs[p->device].type] & (1UL << p->param)))
+		{
+			LOG_ERROR("bad param(%d) device(%d) param(%d)",i,p->device,p->param);
+			return false;
+		}
+		if (!indexOK(devs[p->device].type, p->index))
+		{
+			LOG_ERROR("param(%d) device(%d) %s index(%d) out of range",
+				i,p->device,graph_type_name[devs[p->device].type],p->index);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool AudioGraph::load(const char *filename)
+{
+	if (s_numDevices)
+	{
+		LOG_ERROR("a graph is already loaded",0);
+		return false;
+	}
+
+	FIL file;
+	if (FR_OK != f_open(&file, filename, FA_READ | FA_OPEN_EXISTING))
+	{
+		LOG_ERROR("Could not open %s",filename);
+		return false;
+	}
+
+	audio_graph_header_t hdr;
+	u32 got;
+	if (FR_OK != f_read(&file, &hdr, sizeof(hdr), &got) || got != sizeof(hdr) ||
+		hdr.magic != AUDIO_GRAPH_MAGIC ||
+		hdr.version != AUDIO_GRAPH_VERSION ||
+		!hdr.num_devices ||
+		hdr.num_devices > AUDIO_GRAPH_MAX_DEVICES)
+	{
+		f_close(&file);
+		LOG_ERROR("%s is not a version %d audio graph",filename,AUDIO_GRAPH_VERSION);
+		return false;
+	}
+
+	u32 bytes =
+		hdr.num_devices * sizeof(audio_graph_device_t) +
+		hdr.num_connections * sizeof(audio_graph_connection_t) +
+		hdr.num_params * sizeof(audio_graph_param_t);
+	u8 *records = (u8 *) malloc(bytes);
+	if (!records ||
+		FR_OK != f_read(&file, records, bytes, &got) || got != bytes)
+	{
+		f_close(&file);
+		if (records)
+			free(records);
+		LOG_ERROR("could not read %s",filename);
+		return false;
+	}
+	f_close(&file);
+
+	audio_graph_device_t *devs = (audio_graph_device_t *) records;
+	audio_graph_connection_t *cons = (audio_graph_connection_t *) &devs[hdr.num_devices];
+	audio_graph_param_t *params = (audio_graph_param_t *) &cons[hdr.num_connections];
+
+	if (!validate(&hdr, devs, cons, params))
+	{
+		free(records);
+		return false;
+	}
+
+	// size and allocate the arena
+
+	u32 arena_bytes = arenaRound(hdr.num_devices * sizeof(AudioDevice *));
+	for (u16 i=0; i<hdr.num_devices; i++)
+		arena_bytes += arenaRound(deviceBytes(devs[i].type));
+	arena_bytes += hdr.num_connections * arenaRound(sizeof(AudioConnection));
+
+	u8 *mem = (u8 *) malloc(arena_bytes + ARENA_ALIGN - 1);
+	if (!mem)
+	{
+		free(records);
+		LOG_ERROR("could not allocate %d byte arena",arena_bytes);
+		return false;
+	}
+	memset(mem, 0, arena_bytes + ARENA_ALIGN - 1);
+	s_pArena = (u8 *) ((((u32) mem) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1));
+	s_arenaBytes = arena_bytes;
+
+	LOG("%s: %d devices, %d connections, %d params, %d byte arena",
+		filename,hdr.num_devices,hdr.num_connections,hdr.num_params,arena_bytes);
+
+	// construct the devices, in update order, and the connections
+
+	u8 *ptr = s_pArena;
+	s_devices = (AudioDevice **) ptr;
+	ptr += arenaRound(hdr.num_devices * sizeof(AudioDevice *));
+
+	u16 num_streams = 0;
+	u16 prev_streams = AudioSystem::getNumStreams();
+	AudioStream *prev_last = AudioSystem::s_pLastStream;
+	AudioCodec *prev_codec = AudioCodec::s_pCodec;
+	for (u16 i=0; i<hdr.num_devices; i++)
+	{
+		u8 type = devs[i].type;
+		AudioDevice *dev = createDevice(type, ptr, devs[i].arg);
+		ptr += arenaRound(deviceBytes(type));
+		s_devices[i] = dev;
+		if (dev->getType() != AUDIO_DEVICE_CODEC)
+		{
+			((AudioStream *) dev)->setUpdateDepth(devs[i].depth);
+			num_streams++;
+		}
+	}
+	s_numDevices = hdr.num_devices;
+
+	u8 *cons_mem = ptr;
+	for (u16 i=0; i<hdr.num_connections; i++)
+	{
+		const audio_graph_connection_t *c = &cons[i];
+		new (ptr, graph_arena_t()) AudioConnection(
+			*(AudioStream *) s_devices[c->src], c->src_port,
+			*(AudioStream *) s_devices[c->dest], c->dest_port);
+		ptr += arenaRound(sizeof(AudioConnection));
+	}
+
+	// The streams were linked in the order they were constructed,
+	// which is already the update order, unless other streams were
+	// constructed statically.
+
+	AudioSystem::s_bPresorted = !prev_streams && num_streams == AudioSystem::getNumStreams();
+
+	bool ok = AudioSystem::initialize(
+		hdr.num_audio_blocks,
+		hdr.num_blocks32,
+		hdr.num_raw_blocks,
+		hdr.num_delay_blocks);
+
+	if (ok)
+	{
+		for (u16 i=0; i<hdr.num_params; i++)
+		{
+			const audio_graph_param_t *p = &params[i];
+			setParam(devs[p->device].type, s_devices[p->device], p->param, p->index, p->value);
+		}
+	}
+	else
+	{
+		// Take the graph back out, so that another load() starts
+		// clean.  initialize() only fails before it sorts the
+		// streams, so the graph's are still the tail of the list.
+
+		LOG_ERROR("could not initialize the AudioSystem for %s",filename);
+
+		for (u16 i=0; i<hdr.num_connections; i++)
+			((AudioConnection *) (cons_mem + i * arenaRound(sizeof(AudioConnection))))->~AudioConnection();
+		for (u16 i=0; i<hdr.num_devices; i++)
+			destroyDevice(devs[i].type, s_devices[i]);
+
+		AudioSystem::s_pLastStream = prev_last;
+		if (prev_last)
+			prev_last->m_pNextStream = 0;
+		else
+			AudioSystem::s_pFirstStream = 0;
+		AudioSystem::s_numStreams = prev_streams;
+		AudioSystem::s_bPresorted = false;
+		AudioCodec::s_pCodec = prev_codec;
+
+		free(mem);
+		s_pArena = 0;
+		s_arenaBytes = 0;
+		s_devices = 0;
+		s_numDevices = 0;
+	}
+
+	free(records);
+	return ok;
+}
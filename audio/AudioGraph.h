@@ -0,0 +1,52 @@
+// AudioGraph.h
+//
+// Instantiates an audio graph from a binary descriptor on the SD
+// card (see AudioGraphFormat.h, and graphc.c which compiles one from
+// a text description), instead of from static objects and global
+// AudioConnections.  Changing the routing is then a matter of
+// copying a new file to the SD card rather than a new kernel.
+//
+// load() is called in place of AudioSystem::initialize().  It checks
+// the whole descriptor before creating anything, constructs all of
+// the devices and connections in one preallocated arena, in the
+// update order computed by graphc, and then initializes the
+// AudioSystem with the block counts from the descriptor and applies
+// the parameters.  The graph is never freed.
+//
+// Parameters with an index (mixer channel, delay tap, biquad
+// channel and stage) are checked against the device before anything
+// is created.  The biquad index is channel * 16 + stage, and a q
+// param sets the q of the next lowpass or highpass of that stage,
+// see AudioGraphFormat.h.
+//
+// Devices can then be found by name and instance with
+// AudioSystem::find() as usual, or by their index in the
+// descriptor with getDevice().
+
+#ifndef AudioGraph_h
+#define AudioGraph_h
+
+#include "AudioStream.h"
+
+
+class AudioGraph
+{
+public:
+
+	static bool load(const char *filename);
+
+	static u16 getNumDevices()				{ return s_numDevices; }
+	static AudioDevice *getDevice(u16 num)	{ return num < s_numDevices ? s_devices[num] : 0; }
+	static u32 getArenaBytes()				{ return s_arenaBytes; }
+
+private:
+
+	static u16           s_numDevices;
+	static AudioDevice **s_devices;
+	static u8           *s_pArena;
+	static u32           s_arenaBytes;
+
+};
+
+
+#endif	// !AudioGraph_h
@@ -0,0 +1,150 @@
+// AudioGraphFormat.h
+//
+// The binary audio graph descriptor that AudioGraph::load() reads
+// from the SD card, and that graphc.c compiles from a text file.
+// This header is plain C so that the host side compiler can share it.
+//
+// The file is a header, followed by the device, connection and
+// parameter records, all little endian:
+//
+//     audio_graph_header_t
+//     audio_graph_device_t      [num_devices]
+//     audio_graph_connection_t  [num_connections]
+//     audio_graph_param_t       [num_params]
+//
+// The devices are already in update order, sorted by their depth
+// from the sources, so they are instantiated and linked in file
+// order without sorting on the Pi.  Connections and parameters
+// refer to devices by their index in the file.
+
+#ifndef AudioGraphFormat_h
+#define AudioGraphFormat_h
+
+#include <stdint.h>
+
+#define AUDIO_GRAPH_MAGIC           0x48505247      // "GRPH"
+#define AUDIO_GRAPH_VERSION         1
+#define AUDIO_GRAPH_MAX_DEVICES     256
+
+
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t num_devices;
+	uint16_t num_connections;
+	uint16_t num_params;
+	uint16_t num_audio_blocks;      // passed to AudioSystem::initialize()
+	uint16_t num_blocks32;
+	uint16_t num_raw_blocks;
+	uint16_t num_delay_blocks;
+}   audio_graph_header_t;           // 20 bytes
+
+
+typedef struct
+{
+	uint8_t  type;                  // AUDIO_GRAPH_TYPE_XXX
+	uint8_t  reserved;
+	uint16_t depth;                 // update depth, sources are 1
+	float    arg;                   // constructor argument, 0 for the default
+}   audio_graph_device_t;           // 8 bytes
+
+
+typedef struct
+{
+	uint16_t src;
+	uint16_t dest;
+	uint8_t  src_port;
+	uint8_t  dest_port;
+	uint16_t reserved;
+}   audio_graph_connection_t;       // 8 bytes
+
+
+typedef struct
+{
+	uint16_t device;
+	uint8_t  param;                 // AUDIO_GRAPH_PARAM_XXX
+	uint8_t  index;                 // channel, tap, etc, if the param has one
+	float    value;
+}   audio_graph_param_t;            // 8 bytes
+
+
+// Parameters.  X(id, name)
+
+#define AUDIO_GRAPH_PARAMS \
+	X(GAIN,         "gain")         \
+	X(ROOMSIZE,     "roomsize")     \
+	X(DAMPING,      "damping")      \
+	X(TIME,         "time")         \
+	X(FREQUENCY,    "frequency")    \
+	X(AMPLITUDE,    "amplitude")    \
+	X(DELAY,        "delay")        \
+	X(FEEDBACK,     "feedback")     \
+	X(RATIO,        "ratio")        \
+	X(LOCKED,       "locked")       \
+	X(MODE,         "mode")         \
+	X(THRESHOLD,    "threshold")    \
+	X(CEILING,      "ceiling")      \
+	X(MAKEUP,       "makeup")       \
+	X(RANGE,        "range")        \
+	X(ATTACK,       "attack")       \
+	X(RELEASE,      "release")      \
+	X(LOOKAHEAD,    "lookahead")    \
+	X(DETECT_RMS,   "rms")          \
+	X(LOWPASS,      "lowpass")      \
+	X(HIGHPASS,     "highpass")     \
+	X(VOLUME,       "volume")       \
+	X(INPUT_LEVEL,  "inputlevel")   \
+	X(RECORD_MASK,  "recordmask")   \
+	X(Q,            "q")            \
+
+#define X(id, name)     AUDIO_GRAPH_PARAM_##id,
+enum { AUDIO_GRAPH_PARAMS AUDIO_GRAPH_NUM_PARAMS };
+#undef X
+
+#define GP(id)          (1UL << AUDIO_GRAPH_PARAM_##id)
+
+
+// Device types.  X(id, name, inputs, outputs, allowed params)
+// The names are the getName() of the devices, but for sine_mod,
+// which shares the name of sine_hires on the Pi.  Codecs have no
+// inputs or outputs and are not part of the update order.
+
+#define AUDIO_GRAPH_TYPES \
+	X(I2SI,         "i2si",         0, 2, 0)                                \
+	X(I2SO,         "i2so",         2, 0, 0)                                \
+	X(TDMI,         "tdmi",         0, 8, 0)                                \
+	X(TDMO,         "tdmo",         8, 0, 0)                                \
+	X(MIXER,        "mixer",        4, 1, GP(GAIN))                         \
+	X(AMP,          "amp",          1, 1, GP(GAIN))                         \
+	X(FREEVERB,     "freeverb",     1, 1, GP(ROOMSIZE) | GP(DAMPING))       \
+	X(FREEVERBS,    "freeverbs",    1, 2, GP(ROOMSIZE) | GP(DAMPING))       \
+	X(REVERB,       "reverb",       1, 1, GP(TIME))                         \
+	X(SINE,         "sine",         0, 1, GP(FREQUENCY) | GP(AMPLITUDE))    \
+	X(SINE_HIRES,   "sine_hires",   0, 1, GP(FREQUENCY) | GP(AMPLITUDE))    \
+	X(SINE_MOD,     "sine_mod",     1, 1, GP(FREQUENCY) | GP(AMPLITUDE))    \
+	X(PEAK,         "peak",         1, 0, 0)                                \
+	X(RECORDER,     "recorder",     4, 4, GP(RECORD_MASK))                  \
+	X(DELAY,        "delay",        1, 8, GP(DELAY) | GP(FEEDBACK))         \
+	X(ASRC,         "asrc",         2, 2, GP(RATIO) | GP(LOCKED))           \
+	X(DYNAMICS,     "dynamics",     8, 8, GP(MODE) | GP(THRESHOLD) |        \
+		GP(RATIO) | GP(CEILING) | GP(MAKEUP) | GP(RANGE) | GP(ATTACK) |     \
+		GP(RELEASE) | GP(LOOKAHEAD) | GP(DETECT_RMS))                       \
+	X(BIQUADS,      "biquads",      8, 8, GP(LOWPASS) | GP(HIGHPASS) | GP(Q)) \
+	X(WM8731,       "wm8731",       0, 0, GP(VOLUME) | GP(INPUT_LEVEL))     \
+	X(WM8731S,      "wm8731s",      0, 0, GP(VOLUME) | GP(INPUT_LEVEL))     \
+	X(CS42448,      "cs42448",      0, 0, GP(VOLUME) | GP(INPUT_LEVEL))     \
+	X(SGTL5000,     "sgtl5000",     0, 0, GP(VOLUME) | GP(INPUT_LEVEL))     \
+
+#define X(id, name, in, out, params)    AUDIO_GRAPH_TYPE_##id,
+enum { AUDIO_GRAPH_TYPES AUDIO_GRAPH_NUM_TYPES };
+#undef X
+
+// For the biquads, the index of a lowpass, highpass or q is
+// channel * 16 + stage (graphc writes it as [channel.stage]),
+// and the value of a lowpass or highpass is the frequency.  A q
+// applies to the next lowpass or highpass with the same index,
+// which otherwise gets a q of 0.7071.
+
+
+#endif	// !AudioGraphFormat_h
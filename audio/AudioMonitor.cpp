@@ -32,6 +32,13 @@ monitorVal_t mon_vals[] = {
 	{ "totalBlocks",		0,	0,	AudioSystem::getTotalMemoryBlocks,		},
 	{ "blocksUsed",			0,	0,	AudioSystem::getMemoryBlocksUsed	    },
 	{ "blocksUsedMax",		0,	0,	AudioSystem::getMemoryBlocksUsedMax,	},
+	{ "delayBlocks",		0,	0,	AudioSystem::getDelayBlocks,			},
+	{ "delayBlocksUsed",	0,	0,	AudioSystem::getDelayBlocksUsed,		},
+	{ "numOverflows",		0,	0,	AudioSystem::getNumOverflows,			},
+	{ "governorLoad",		0,	0,	AudioSystem::getGovernorLoad,			},
+	{ "streamsDegraded",	0,	0,	AudioSystem::getNumDegraded,			},
+	{ "streamsSkipped",		0,	0,	AudioSystem::getNumSkipped,				},
+	{ "governorEvents",		0,	0,	AudioSystem::getGovernorEvents,			},
 	{ "in_irq_count",		0,	&bcm_pcm.in_irq_count,     },
 	{ "out_irq_count",      0,	&bcm_pcm.out_irq_count,    },
 	{ "in_block_count",     0,	&bcm_pcm.in_block_count,   },
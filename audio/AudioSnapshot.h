@@ -0,0 +1,82 @@
+// AudioSnapshot.h
+//
+// A single writer, single reader seqlock for handing small structures
+// from the audio core (which publishes once per block in update())
+// to the UI core (which reads once per frame), without disabling
+// interrupts, which does nothing for the other core anyway.
+//
+// The writer bumps the sequence to an odd number, copies the value,
+// and bumps it to the next even number.  The reader copies the value
+// between two reads of the sequence and tries again if they differ,
+// or were odd, so it never sees a torn value.  The writer never waits.
+//
+// The reader also stores the sequence it last read, so available()
+// tells it if anything new has been published, and consumed() tells
+// the writer that the reader has seen the last value, for streams
+// like the peak analyzer that accumulate "since last read".
+
+#ifndef AudioSnapshot_h
+#define AudioSnapshot_h
+
+#include <circle/types.h>
+#include <circle/synchronize.h>
+
+
+template <class T> class AudioSnapshot
+{
+public:
+
+	AudioSnapshot() :
+		m_seq(0),
+		m_read_seq(0),
+		m_value()
+	{}
+
+	// writer (audio) side
+
+	void publish(const T &value)
+	{
+		u32 seq = m_seq;
+		m_seq = seq + 1;
+		DataMemBarrier();
+		m_value = value;
+		DataMemBarrier();
+		m_seq = seq + 2;
+	}
+
+	bool consumed() const		{ return m_read_seq == m_seq; }
+
+	// reader (ui) side
+
+	bool available() const		{ return m_read_seq != m_seq; }
+
+	u32 read(T *pValue)
+		// returns the sequence number of the value read,
+		// zero if nothing has been published yet.
+	{
+		u32 seq;
+		while (1)
+		{
+			seq = m_seq;
+			if (seq & 1)
+				continue;
+			DataMemBarrier();
+			*pValue = m_value;
+			DataMemBarrier();
+			if (m_seq == seq)
+				break;
+		}
+		m_read_seq = seq;
+		return seq;
+	}
+
+private:
+
+	volatile u32 m_seq;
+	volatile u32 m_read_seq;
+	T m_value;
+
+};
+
+
+#endif	// !AudioSnapshot_h
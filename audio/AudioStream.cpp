@@ -1,5 +1,8 @@
 #include "AudioStream.h"
 #include "AudioConnection.h"
+#include <circle/logger.h>
+
+#define log_name "audio"
 
 
 AudioStream::~AudioStream() {}
@@ -21,6 +24,9 @@ AudioStream::AudioStream(
     m_numConnections    = 0;
 	m_pFirstConnection  = 0;
 	m_updateDepth       = 0;
+	m_fullCycles        = 0;
+	m_priority          = AUDIO_PRIORITY_NORMAL;
+	m_runMode           = AUDIO_RUN_NORMAL;
     
     // initialize the input queue for the client
     // as the typical usage is to pass it to us
@@ -62,26 +68,54 @@ void AudioStream::transmit(audio_block_t *block, unsigned char index)
 }
 
 
-audio_block_t *AudioStream::receiveReadOnly(unsigned int index)
+audio_block_t *AudioStream::receiveClass(unsigned int index, u8 block_class)
+	// A block of the wrong size class is a wiring error, i.e. a 32 bit
+	// source connected to a 16 bit input. It is dropped with a one time
+	// error rather than being misinterpreted.
 {
 	if (index >= m_numInputs)
 		return NULL;
 	audio_block_t *in = m_inputQueue[index];
 	m_inputQueue[index] = NULL;
+	if (in && in->block_class != block_class)
+	{
+		static bool class_error = 0;
+		if (!class_error)
+			LOG_ERROR("%s%d input(%d) got block class(%d) expected(%d)",
+				getName(),getInstance(),index,in->block_class,block_class);
+		class_error = 1;
+		AudioSystem::release(in);
+		in = NULL;
+	}
 	return in;    
 }
 
 
-audio_block_t *AudioStream::receiveWritable(unsigned int index)
+void AudioStream::releaseInputs()
+	// drop anything queued for a stream that is not being updated
 {
-	if (index >= m_numInputs)
-		return NULL;
-	audio_block_t *in = m_inputQueue[index];
-	m_inputQueue[index] = NULL;
+	for (u16 i=0; m_inputQueue && i<m_numInputs; i++)
+	{
+		if (m_inputQueue[i])
+		{
+			AudioSystem::release(m_inputQueue[i]);
+			m_inputQueue[i] = NULL;
+		}
+	}
+}
+
+
+audio_block_t *AudioStream::receiveWritableClass(unsigned int index, u8 block_class)
+{
+	audio_block_t *in = receiveClass(index,block_class);
 	if (in && in->ref_count > 1)
 	{
-		audio_block_t *p = AudioSystem::allocate();
-		if (p) memcpy(p->data, in->data, sizeof(p->data));
+		audio_block_t *p = AudioSystem::allocate(block_class);
+		if (p)
+		{
+			p->num_channels = in->num_channels;
+			memcpy(p->data, in->data, AudioSystem::getPoolDataBytes(block_class));
+		}
 		in->ref_count--;
 		in = p;
 	}
@@ -5,6 +5,20 @@
 #include "AudioDevice.h"
 #include "AudioSystem.h"
 
+// Priorities and run modes for the overload governor in AudioSystem.
+// Only LOW and BACKGROUND streams are ever degraded or skipped, the
+// BACKGROUND ones (analyzers) first.  A stream that has a cheaper
+// fallback is put into its degraded mode before it is skipped.
+
+#define AUDIO_PRIORITY_CRITICAL     0		// i/o devices
+#define AUDIO_PRIORITY_NORMAL       1		// the default
+#define AUDIO_PRIORITY_LOW          2		// reverbs, etc
+#define AUDIO_PRIORITY_BACKGROUND   3		// analyzers
+
+#define AUDIO_RUN_NORMAL            0
+#define AUDIO_RUN_DEGRADED          1
+#define AUDIO_RUN_SKIPPED           2
+
 
 class AudioStream :  public AudioDevice
 {
@@ -28,6 +42,11 @@ public:
 	u32 	getCPUCycles()  	        { return m_cpuCycles; }
 	u32 	getCPUCyclesMax()	        { return m_cpuCyclesMax; }
 	void 	resetStats()                { m_cpuCycles=0; m_cpuCyclesMax=0; }
+
+	void	setPriority(u8 priority)	{ m_priority = priority; }
+	u8		getPriority()				{ return m_priority; }
+	u8		getRunMode()				{ return m_runMode; }
+	virtual bool hasFallback()			{ return false; }
     
     AudioStream *getConnectedInput(u8 channel, u8 *src_channel);
     AudioStream *getFirstConnectedOutput(u8 channel, u8 *dest_channel);
@@ -35,14 +54,41 @@ public:
 protected:
 friend class AudioSystem;
 friend class AudioConnection;
+friend class AudioBench;
+friend class AudioGraph;
     
 	virtual void update(void) {}
 	void transmit(audio_block_t *block, unsigned char index = 0);
-	audio_block_t *receiveReadOnly(unsigned int index = 0);
-	audio_block_t *receiveWritable(unsigned int index = 0);
+	audio_block_t *receiveReadOnly(unsigned int index = 0)
+		{ return receiveClass(index,AUDIO_BLOCK_CLASS_16); }
+	audio_block_t *receiveWritable(unsigned int index = 0)
+		{ return receiveWritableClass(index,AUDIO_BLOCK_CLASS_16); }
+
+	// typed helpers for the other block pool size classes
+	
+	void transmit(audio_block32_t *block, unsigned char index = 0)
+		{ transmit((audio_block_t *) block, index); }
+	void transmit(audio_block_raw_t *block, unsigned char index = 0)
+		{ transmit((audio_block_t *) block, index); }
+	audio_block32_t *receiveReadOnly32(unsigned int index = 0)
+		{ return (audio_block32_t *) receiveClass(index,AUDIO_BLOCK_CLASS_32); }
+	audio_block32_t *receiveWritable32(unsigned int index = 0)
+		{ return (audio_block32_t *) receiveWritableClass(index,AUDIO_BLOCK_CLASS_32); }
+	audio_block_raw_t *receiveReadOnlyRaw(unsigned int index = 0)
+		{ return (audio_block_raw_t *) receiveClass(index,AUDIO_BLOCK_CLASS_RAW); }
+	audio_block_raw_t *receiveWritableRaw(unsigned int index = 0)
+		{ return (audio_block_raw_t *) receiveWritableClass(index,AUDIO_BLOCK_CLASS_RAW); }
+
+	audio_block_t *receiveClass(unsigned int index, u8 block_class);
+	audio_block_t *receiveWritableClass(unsigned int index, u8 block_class);
 
 	void	setUpdateDepth(u16 depth)	{ m_updateDepth = depth; }
 
+	virtual void setDegraded(bool degraded) {}
+		// called by the governor, between updates, on streams
+		// that return true from hasFallback()
+	void	releaseInputs();
+
     // member variables
     
 	u16 			m_numInputs;
@@ -54,6 +100,9 @@ friend class AudioConnection;
 	u16             m_updateDepth;
 	u32      		m_cpuCycles;
 	u32      		m_cpuCyclesMax;
+	u32				m_fullCycles;		// cost before the governor degraded it
+	u8				m_priority;
+	u8				m_runMode;
     
     static u16      s_numStreams;
 
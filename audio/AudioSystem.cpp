@@ -2,6 +2,7 @@
 #include "Audio.h"
 #include <circle/logger.h>
 #include <circle/alloc.h>
+#include <circle/synchronize.h>
 
 #define log_name "audio"
 
@@ -12,19 +13,35 @@
 AudioCodec *AudioCodec::s_pCodec = 0;
 
 u16  AudioSystem::s_numStreams = 0;
-u32  AudioSystem::s_totalBlocks = 0;
-u32  AudioSystem::s_blocksUsed = 0;
-u32  AudioSystem::s_blocksUsedMax = 0;
 u32  AudioSystem::s_cpuCycles = 0;
 u32  AudioSystem::s_nInUpdate = 0;
 u32  AudioSystem::s_cpuCyclesMax = 0;
 u32  AudioSystem::s_numOverflows = 0;
 bool AudioSystem::s_bUpdateScheduled = 0;
+bool AudioSystem::s_bPresorted = 0;
 
 AudioStream   *AudioSystem::s_pFirstStream = 0;
 AudioStream   *AudioSystem::s_pLastStream = 0;
-audio_block_t *AudioSystem::s_pAudioMemory = 0;
-audio_block_t *AudioSystem::s_pFreeBlock = 0;
+audio_pool_t   AudioSystem::s_pool[AUDIO_NUM_BLOCK_CLASSES];
+int16_t       *AudioSystem::s_pDelayArena = 0;
+u32            AudioSystem::s_delayBlocks = 0;
+u32            AudioSystem::s_delayBlocksUsed = 0;
+
+bool           AudioSystem::s_bGovernor = 1;
+u32            AudioSystem::s_governorLoad = 0;
+u32            AudioSystem::s_governorAvg = 0;
+u32            AudioSystem::s_governorLastOverflows = 0;
+u32            AudioSystem::s_governorOverflowBits = 0;
+u16            AudioSystem::s_governorOver = 0;
+u16            AudioSystem::s_governorUnder = 0;
+u16            AudioSystem::s_governorSettle = 0;
+u32            AudioSystem::s_numDegraded = 0;
+u32            AudioSystem::s_numSkipped = 0;
+u32            AudioSystem::s_governorEvents = 0;
+audio_governor_event_t AudioSystem::s_governorLog[AUDIO_GOVERNOR_EVENTS];
+AudioSnapshot<audio_system_stats_t> AudioSystem::s_stats;
+volatile u32   AudioSystem::s_governorHead = 0;
+u32            AudioSystem::s_governorTail = 0;
 
 
 
@@ -41,16 +58,18 @@ void AudioSystem::stop()
 
 
 
-bool AudioSystem::initialize(u32 num_audio_blocks)
+bool AudioSystem::initialize(u32 num_audio_blocks, u32 num_blocks32, u32 num_raw_blocks, u32 num_delay_blocks)
 {
-    LOG("initialize(%d)",num_audio_blocks);
+    LOG("initialize(%d,%d,%d,%d)",num_audio_blocks,num_blocks32,num_raw_blocks,num_delay_blocks);
     
-    if (!initialize_memory(num_audio_blocks))
+    if (!initialize_memory(num_audio_blocks,num_blocks32,num_raw_blocks,num_delay_blocks))
         return false;
 
-	// sort the streams
+	// sort the streams, unless an AudioGraph
+	// already constructed them in update order
     
-    sortStreams();
+	if (!s_bPresorted)
+		sortStreams();
 		
     // start the codec if there's one
     
@@ -91,6 +110,7 @@ void AudioSystem::resetStats()
 	s_cpuCycles     = 0;
 	s_cpuCyclesMax  = 0;
 	s_numOverflows  = 0;
+	s_governorLastOverflows = 0;
     
     for (AudioStream *p=s_pFirstStream; p; p=p->m_pNextStream)
         p->resetStats();
@@ -118,85 +138,171 @@ AudioStream *AudioSystem::find(u32 type, const char *name, s16 instance)
 //----------------------------------------
 
 
-bool AudioSystem::initialize_memory(u32 num_audio_blocks)
+bool AudioSystem::initialize_memory(u32 num_audio_blocks, u32 num_blocks32, u32 num_raw_blocks, u32 num_delay_blocks)
 {
-    LOG("initialize_memory(%d)",num_audio_blocks);
-    u32 bytes = num_audio_blocks * sizeof(audio_block_t);
+    LOG("initialize_memory(%d,%d,%d,%d)",num_audio_blocks,num_blocks32,num_raw_blocks,num_delay_blocks);
+    
+    u32 bytes =
+        num_audio_blocks * (sizeof(audio_block_t) + AUDIO_BLOCK_BYTES) +
+        num_blocks32 * (sizeof(audio_block32_t) + AUDIO_BLOCK32_BYTES) +
+        num_raw_blocks * (sizeof(audio_block_raw_t) + AUDIO_BLOCK_RAW_BYTES) +
+        num_delay_blocks * AUDIO_BLOCK_BYTES;
     u32 avail = mem_get_size() - AUDIO_RESERVE_MEMORY;
-    if (bytes > avail)
+    if (bytes > avail ||
+        num_audio_blocks >= AUDIO_BLOCK_NONE ||
+        num_blocks32 >= AUDIO_BLOCK_NONE ||
+        num_raw_blocks >= AUDIO_BLOCK_NONE)
     {
         LOG_ERROR("cannot allocate %d memory blocks (%d bytes) max=%d bytes",
-            num_audio_blocks,bytes,avail);
+            num_audio_blocks + num_blocks32 + num_raw_blocks,bytes,avail);
         return false;
     }
+
+    memset(s_pool,0,sizeof(s_pool));
+
+    if (num_delay_blocks)
+    {
+        u8 *mem = (u8 *) malloc(num_delay_blocks * AUDIO_BLOCK_BYTES + AUDIO_BLOCK_ALIGN - 1);
+        assert(mem);
+        if (!mem)
+        {
+            LOG_ERROR("could not allocate %d delay blocks",num_delay_blocks);
+            return false;
+        }
+        s_pDelayArena = (int16_t *) ((((u32) mem) + AUDIO_BLOCK_ALIGN - 1) & ~(AUDIO_BLOCK_ALIGN - 1));
+        memset(s_pDelayArena,0,num_delay_blocks * AUDIO_BLOCK_BYTES);
+        s_delayBlocks = num_delay_blocks;
+        s_delayBlocksUsed = 0;
+    }
     
-    s_pAudioMemory = (audio_block_t *) malloc(bytes);
-    assert(s_pAudioMemory);
-    if (!s_pAudioMemory)
+    return
+        initialize_pool(AUDIO_BLOCK_CLASS_16, num_audio_blocks, AUDIO_BLOCK_BYTES) &&
+        initialize_pool(AUDIO_BLOCK_CLASS_32, num_blocks32, AUDIO_BLOCK32_BYTES) &&
+        initialize_pool(AUDIO_BLOCK_CLASS_RAW, num_raw_blocks, AUDIO_BLOCK_RAW_BYTES);
+}
+
+
+bool AudioSystem::initialize_pool(u8 block_class, u32 num_blocks, u32 data_bytes)
+    // The headers are a separate compact array so that the payloads
+    // can each start on a cache line.  All of the data_bytes sizes
+    // are multiples of AUDIO_BLOCK_ALIGN, so aligning the first
+    // payload aligns them all.
+{
+    audio_pool_t *pool = &s_pool[block_class];
+    pool->free = AUDIO_BLOCK_NONE;
+    pool->data_bytes = data_bytes;
+        // in this order, as allocate() takes a zero data_bytes
+        // to mean the pool is not set up yet
+    if (!num_blocks)
+        return true;
+    
+    u32 bytes = num_blocks * data_bytes + AUDIO_BLOCK_ALIGN - 1;
+    pool->memory = (u8 *) malloc(bytes);
+    pool->headers = (audio_block_t *) malloc(num_blocks * sizeof(audio_block_t));
+    assert(pool->memory);
+    assert(pool->headers);
+    if (!pool->memory || !pool->headers)
     {
-        LOG_ERROR("could not allocate %d memory blocks (%d bytes) max=%d bytes",
-            num_audio_blocks,bytes,avail);
+        LOG_ERROR("could not allocate %d class(%d) memory blocks (%d bytes)",
+            num_blocks,block_class,bytes);
         return false;
     }
+    pool->payload = (u8 *) ((((u32) pool->memory) + AUDIO_BLOCK_ALIGN - 1) & ~(AUDIO_BLOCK_ALIGN - 1));
 
     // setup the free list
     
-    s_totalBlocks = num_audio_blocks;
-    audio_block_t *p = s_pAudioMemory;
-    audio_block_t *prev = 0;
-    
-    for (u32 i=0; i<s_totalBlocks; i++)
+    pool->total = num_blocks;
+    for (u32 i=0; i<num_blocks; i++)
     {
-        p->next = 0;
-        if (prev) prev->next = p;
-        prev = p;
-        p++;
+        audio_block_t *p = &pool->headers[i];
+        p->ref_count = 0;
+        p->block_class = block_class;
+        p->num_channels = 1;
+        p->index = i;
+        p->next = (i + 1 < num_blocks) ? i + 1 : AUDIO_BLOCK_NONE;
+        p->data = (int16_t *) (pool->payload + i * data_bytes);
     }
     
-    s_pFreeBlock = s_pAudioMemory;
+    pool->free = 0;
     return true;
 }
 
 
 // volatile bool show_allocs = 0;
 
-audio_block_t *AudioSystem::allocate(void)
+audio_block_t *AudioSystem::allocate(u8 block_class)
 {
+    audio_pool_t *pool = &s_pool[block_class];
+
     // if (show_allocs)
     // {
-    //     LOG("alloc   %d/%d  %08lx", s_blocksUsed,s_totalBlocks,(u32)s_pFreeBlock);
+    //     LOG("alloc   %d/%d  %d", pool->used,pool->total,pool->free);
     //     delay(5);
     // }
 
 	__disable_irq();
 
-    if (!s_pFreeBlock)
+    if (!pool->data_bytes)
+        // Before initialize() s_pool is still all zeros, so free
+        // would be header 0 of a pool that has no headers.  Not
+        // reported, so that a real out of memory still is.
+    {
+    	__enable_irq();
+        return NULL;
+    }
+    if (pool->free == AUDIO_BLOCK_NONE)
     {
-        static bool out_of_memory_error = 0;
-        if (!out_of_memory_error)
-            LOG_ERROR("OUT OF MEMORY",0);
-        out_of_memory_error = 1;
+        static bool out_of_memory_error[AUDIO_NUM_BLOCK_CLASSES] = {0};
+        if (!out_of_memory_error[block_class])
+            LOG_ERROR("OUT OF MEMORY class(%d)",block_class);
+        out_of_memory_error[block_class] = 1;
     	__enable_irq();
         return NULL;
     }
     
-    audio_block_t *block = s_pFreeBlock;
-    s_pFreeBlock = block->next;
-    s_pFreeBlock->prev = 0;
-
-    block->prev = 0;
-    block->next = 0;
+    audio_block_t *block = &pool->headers[pool->free];
+    pool->free = block->next;
+    block->next = AUDIO_BLOCK_NONE;
    	block->ref_count = 1;
 
-    s_blocksUsed++;
-    if (s_blocksUsed > s_blocksUsedMax)
-        s_blocksUsedMax = s_blocksUsed;
+    pool->allocs++;
+    pool->used++;
+    if (pool->used > pool->used_max)
+        pool->used_max = pool->used;
         
 	__enable_irq();
     return block;
 }	
 
 
+audio_block_raw_t *AudioSystem::allocateRaw(u8 num_channels)
+{
+    if (num_channels > AUDIO_RAW_MAX_CHANNELS)
+    {
+        LOG_ERROR("allocateRaw(%d) max channels=%d",num_channels,AUDIO_RAW_MAX_CHANNELS);
+        return NULL;
+    }
+    audio_block_raw_t *block = (audio_block_raw_t *) allocate(AUDIO_BLOCK_CLASS_RAW);
+    if (block)
+        block->num_channels = num_channels;
+    return block;
+}
+
+
+int16_t *AudioSystem::allocateDelayLine(u32 num_blocks)
+{
+    if (s_delayBlocksUsed + num_blocks > s_delayBlocks)
+    {
+        LOG_ERROR("delay arena cannot allocate %d blocks (%d of %d used)",
+            num_blocks,s_delayBlocksUsed,s_delayBlocks);
+        return NULL;
+    }
+    int16_t *line = s_pDelayArena + s_delayBlocksUsed * AUDIO_BLOCK_SAMPLES;
+    s_delayBlocksUsed += num_blocks;
+    return line;
+}
+
+
 void AudioSystem::release(audio_block_t *block)
 {
     // assert(block);
@@ -207,15 +313,17 @@ void AudioSystem::release(audio_block_t *block)
     
 	__disable_irq();
     
-    if ( ((u32)block) < ((u32)s_pAudioMemory) ||
-         ((u32)block) > ((u32)s_pAudioMemory) + ((u32)s_totalBlocks*AUDIO_BLOCK_BYTES) )
+    audio_pool_t *pool = block->block_class < AUDIO_NUM_BLOCK_CLASSES ?
+        &s_pool[block->block_class] : 0;
+    if (!pool ||
+        block->index >= pool->total ||
+        block != &pool->headers[block->index])
     {
         static bool bad_pointer_error = 0;
         if (!bad_pointer_error)
-            LOG_ERROR("release BAD POINTER block(%08x) mem=(%08x to %08x)",
+            LOG_ERROR("release BAD POINTER block(%08x) class(%d)",
                 (u32) block,
-                (u32)s_pAudioMemory,
-                ((u32)s_pAudioMemory) + ((u32)s_totalBlocks*AUDIO_BLOCK_BYTES));
+                block->block_class);
         bad_pointer_error = 1;
     	__enable_irq();
         return;
@@ -229,16 +337,14 @@ void AudioSystem::release(audio_block_t *block)
     {    
         // if (show_allocs)
         // {
-        //     LOG("release %d/%d  %08lx free=%08lx", s_blocksUsed,s_totalBlocks,(u32)block,(u32)s_pFreeBlock);
+        //     LOG("release %d/%d  %d free=%d", pool->used,pool->total,block->index,pool->free);
         //     delay(5);
         // }
 
-        block->prev = 0;
-        block->next = (audio_block_t *) s_pFreeBlock;
-        if (s_pFreeBlock)
-            s_pFreeBlock->prev = block;
-        s_pFreeBlock = block;
-        s_blocksUsed--;
+        block->ref_count = 0;
+        block->next = pool->free;
+        pool->free = block->index;
+        pool->used--;
     }
     
 	__enable_irq();
@@ -441,6 +547,13 @@ void AudioSystem::doUpdate()
 	{
 		if (p->m_numConnections)
 		{
+			if (p->m_runMode == AUDIO_RUN_SKIPPED)
+			{
+				p->releaseInputs();
+				p->m_cpuCycles = 0;
+				continue;
+			}
+
 			#ifdef WITH_TIMING
 				uint32_t cycles =  CTimer::GetClockTicks();
 			#endif
@@ -464,11 +577,202 @@ void AudioSystem::doUpdate()
 		s_cpuCycles = totalcycles;
 		if (totalcycles > s_cpuCyclesMax)
 			s_cpuCyclesMax = totalcycles;
+		governor(totalcycles);
 	#endif
 	
 	__disable_irq();
 	s_nInUpdate--;
 	__enable_irq();    
+
+	audio_system_stats_t stats;
+	stats.in_update       = s_nInUpdate;
+	stats.cpu_cycles      = s_cpuCycles;
+	stats.cpu_cycles_max  = s_cpuCyclesMax;
+	stats.num_overflows   = s_numOverflows;
+	stats.blocks_used     = s_pool[AUDIO_BLOCK_CLASS_16].used;
+	stats.blocks_used_max = s_pool[AUDIO_BLOCK_CLASS_16].used_max;
+	stats.governor_load   = s_governorLoad;
+	s_stats.publish(stats);
 }
 
 	
+
+
+
+//----------------------------------------------
+// overload governor
+//----------------------------------------------
+
+static const char *run_mode_name[] = { "normal", "degraded", "skipped" };
+
+
+void AudioSystem::governor(u32 us)
+	// called at the end of every doUpdate()
+{
+	// one pole smoothing by 1/8, kept scaled by 8
+
+	s_governorAvg += us - (s_governorAvg >> 3);
+	s_governorLoad = (s_governorAvg >> 3) * 100 / AUDIO_BLOCK_PERIOD_US;
+
+	// count the blocks with overflows in a sliding window
+
+	s_governorOverflowBits <<= 1;
+	if (s_numOverflows != s_governorLastOverflows)
+		s_governorOverflowBits |= 1;
+	s_governorLastOverflows = s_numOverflows;
+	bool overflow = __builtin_popcount(s_governorOverflowBits &
+		(u32) ((1ULL << AUDIO_GOVERNOR_HOLD) - 1)) >= AUDIO_GOVERNOR_OVERFLOWS;
+
+	if (!s_bGovernor)
+	{
+		// put everything back if it was turned off
+		if (s_numDegraded || s_numSkipped)
+		{
+			for (AudioStream *p = s_pFirstStream; p; p = p->m_pNextStream)
+			{
+				if (p->m_runMode != AUDIO_RUN_NORMAL)
+					governorSet(p,AUDIO_RUN_NORMAL);
+			}
+		}
+		return;
+	}
+
+	if (s_governorSettle)
+	{
+		s_governorSettle--;
+		return;
+	}
+
+	if (overflow || s_governorLoad > AUDIO_GOVERNOR_HIGH)
+	{
+		s_governorUnder = 0;
+		if (overflow || ++s_governorOver >= AUDIO_GOVERNOR_HOLD)
+		{
+			s_governorOver = 0;
+			s_governorOverflowBits = 0;
+			governorDegrade();
+		}
+	}
+	else if (s_governorLoad < AUDIO_GOVERNOR_LOW)
+	{
+		s_governorOver = 0;
+		if ((s_numDegraded || s_numSkipped) &&
+			++s_governorUnder >= AUDIO_GOVERNOR_RESTORE)
+		{
+			s_governorUnder = 0;
+			governorRestore();
+		}
+	}
+	else
+	{
+		s_governorOver = 0;
+		s_governorUnder = 0;
+	}
+}
+
+
+void AudioSystem::governorDegrade()
+	// Shed the lowest priority stream, the most expensive
+	// of those, that can still be degraded or skipped.
+{
+	AudioStream *victim = 0;
+	for (AudioStream *p = s_pFirstStream; p; p = p->m_pNextStream)
+	{
+		if (!p->m_numConnections ||
+			p->m_priority < AUDIO_PRIORITY_LOW ||
+			p->m_runMode == AUDIO_RUN_SKIPPED)
+			continue;
+		if (!victim ||
+			p->m_priority > victim->m_priority ||
+			(p->m_priority == victim->m_priority &&
+			 p->m_cpuCycles > victim->m_cpuCycles))
+			victim = p;
+	}
+	if (!victim)
+		return;		// nothing left to shed
+
+	if (victim->m_runMode == AUDIO_RUN_NORMAL)
+		victim->m_fullCycles = victim->m_cpuCycles;
+	governorSet(victim,
+		victim->m_runMode == AUDIO_RUN_NORMAL && victim->hasFallback() ?
+			AUDIO_RUN_DEGRADED : AUDIO_RUN_SKIPPED);
+	s_governorSettle = AUDIO_GOVERNOR_SETTLE;
+}
+
+
+void AudioSystem::governorRestore()
+	// Bring back the highest priority, cheapest, shed stream
+	// one step, if its full cost fits under the high mark.
+{
+	AudioStream *best = 0;
+	for (AudioStream *p = s_pFirstStream; p; p = p->m_pNextStream)
+	{
+		if (p->m_runMode == AUDIO_RUN_NORMAL)
+			continue;
+		if (!best ||
+			p->m_priority < best->m_priority ||
+			(p->m_priority == best->m_priority &&
+			 p->m_fullCycles < best->m_fullCycles))
+			best = p;
+	}
+	if (!best)
+		return;
+
+	u32 load = s_governorAvg >> 3;
+	if (best->m_fullCycles > best->m_cpuCycles)
+		load += best->m_fullCycles - best->m_cpuCycles;
+	if (load * 100 / AUDIO_BLOCK_PERIOD_US >= AUDIO_GOVERNOR_HIGH)
+		return;
+
+	governorSet(best,
+		best->m_runMode == AUDIO_RUN_SKIPPED && best->hasFallback() ?
+			AUDIO_RUN_DEGRADED : AUDIO_RUN_NORMAL);
+	s_governorSettle = AUDIO_GOVERNOR_SETTLE;
+}
+
+
+void AudioSystem::governorSet(AudioStream *p, u8 mode)
+{
+	u8 from = p->m_runMode;
+	if (from == AUDIO_RUN_DEGRADED) s_numDegraded--;
+	if (from == AUDIO_RUN_SKIPPED)  s_numSkipped--;
+	if (mode == AUDIO_RUN_DEGRADED) s_numDegraded++;
+	if (mode == AUDIO_RUN_SKIPPED)  s_numSkipped++;
+
+	// a skipped stream keeps its degraded setting
+	// so it comes back the way it left
+	
+	if (mode != AUDIO_RUN_SKIPPED && p->hasFallback())
+		p->setDegraded(mode == AUDIO_RUN_DEGRADED);
+	p->m_runMode = mode;
+	s_governorEvents++;
+
+	u32 head = s_governorHead;
+	if (head - s_governorTail < AUDIO_GOVERNOR_EVENTS)
+	{
+		audio_governor_event_t *e = &s_governorLog[head & (AUDIO_GOVERNOR_EVENTS-1)];
+		e->stream = p;
+		e->from = from;
+		e->to = mode;
+		e->load = s_governorLoad;
+		DataMemBarrier();
+		s_governorHead = head + 1;
+	}
+}
+
+
+void AudioSystem::logGovernor()
+{
+	while (s_governorTail != s_governorHead)
+	{
+		DataMemBarrier();
+		audio_governor_event_t *e = &s_governorLog[s_governorTail & (AUDIO_GOVERNOR_EVENTS-1)];
+		LOG("governor load(%d%%) %s%d %s -> %s",
+			e->load,
+			e->stream->getName(),
+			e->stream->getInstance(),
+			run_mode_name[e->from],
+			run_mode_name[e->to]);
+		s_governorTail++;
+	}
+}
@@ -3,12 +3,75 @@
 #define AudioSystem_h
 
 #include "AudioTypes.h"
+#include "AudioSnapshot.h"
+
+
+typedef struct audio_pool_struct
+	// one size class of the block pool
+{
+	u32 data_bytes;             // payload, a multiple of AUDIO_BLOCK_ALIGN
+	u32 total;
+	u32 used;
+	u32 used_max;
+	u32 allocs;                 // count of allocate() calls, for AudioBench
+	u8  *memory;                // as malloc'd
+	u8  *payload;               // aligned start of the payloads
+	audio_block_t *headers;
+	u16 free;                   // index of first free header
+}   audio_pool_t;
+
+
+// The overload governor compares the smoothed doUpdate() time against
+// the block period.  After AUDIO_GOVERNOR_HOLD blocks over the high
+// mark, or AUDIO_GOVERNOR_OVERFLOWS overflows within the last
+// AUDIO_GOVERNOR_HOLD blocks, it degrades or skips one LOW or BACKGROUND
+// stream, and after AUDIO_GOVERNOR_RESTORE blocks under the low mark
+// it restores one, if its old cost fits under the high mark.  It then
+// waits AUDIO_GOVERNOR_SETTLE blocks before deciding again.
+
+#define AUDIO_BLOCK_PERIOD_US       (AUDIO_BLOCK_SAMPLES * 1000000 / AUDIO_SAMPLE_RATE)
+#define AUDIO_GOVERNOR_HIGH         85		// percent of the block period
+#define AUDIO_GOVERNOR_LOW          60
+#define AUDIO_GOVERNOR_HOLD         16		// blocks, at most 32
+#define AUDIO_GOVERNOR_OVERFLOWS    4
+	// a single overflow is usually an SD or USB interrupt
+	// hogging the core, not a sustained overload
+#define AUDIO_GOVERNOR_RESTORE      512
+#define AUDIO_GOVERNOR_SETTLE       64
+#define AUDIO_GOVERNOR_EVENTS       16		// power of 2
+
+
+typedef struct audio_governor_event_struct
+	// one decision, queued for logGovernor()
+{
+	AudioStream *stream;
+	u8  from;
+	u8  to;
+	u16 load;                   // percent of the block period
+}   audio_governor_event_t;
+
+
+typedef struct audio_system_stats_struct
+	// published by doUpdate() once per block for the UI
+{
+	u32 in_update;
+	u32 cpu_cycles;
+	u32 cpu_cycles_max;
+	u32 num_overflows;
+	u32 blocks_used;
+	u32 blocks_used_max;
+	u32 governor_load;
+}	audio_system_stats_t;
+
 
 class AudioSystem  // singleton
 {
 public:
 
-	static bool initialize(u32 num_audio_blocks);
+	static bool initialize(u32 num_audio_blocks,
+		u32 num_blocks32 = 0,
+		u32 num_raw_blocks = 0,
+		u32 num_delay_blocks = 0);
 	static void start();
 	static void stop();
     static void sortStreams();  
@@ -21,37 +84,93 @@ public:
 	static void doUpdate();
 	static void startUpdate();
 	static bool takeUpdateResponsibility();
-	static audio_block_t *allocate(void);
+	static audio_block_t *allocate(void)		{ return allocate(AUDIO_BLOCK_CLASS_16); }
+	static audio_block_t *allocate(u8 block_class);
+	static audio_block32_t *allocate32()		{ return (audio_block32_t *) allocate(AUDIO_BLOCK_CLASS_32); }
+	static audio_block_raw_t *allocateRaw(u8 num_channels);
 	static void release(audio_block_t * block);
+	static void release(audio_block32_t *block)		{ release((audio_block_t *) block); }
+	static void release(audio_block_raw_t *block)	{ release((audio_block_t *) block); }
+
+	// The delay arena is a single preallocated region that long
+	// delay lines are carved out of, in whole AUDIO_BLOCK_SAMPLES
+	// int16_t blocks, by the streams' start() methods.  It is never
+	// freed back, as the graph is static once initialized.
+	
+	static int16_t *allocateDelayLine(u32 num_blocks);
 	
 	static void resetStats();
 	static u32 	getCPUCycles()  			{ return s_cpuCycles; }
 	static u32 	getCPUCyclesMax()			{ return s_cpuCyclesMax; }
-	static u32  getTotalMemoryBlocks()		{ return s_totalBlocks; }
-	static u32  getMemoryBlocksUsed()		{ return s_blocksUsed; }
-	static u32  getMemoryBlocksUsedMax()	{ return s_blocksUsedMax; }
+	static u32  getTotalMemoryBlocks()		{ return s_pool[AUDIO_BLOCK_CLASS_16].total; }
+	static u32  getMemoryBlocksUsed()		{ return s_pool[AUDIO_BLOCK_CLASS_16].used; }
+	static u32  getMemoryBlocksUsedMax()	{ return s_pool[AUDIO_BLOCK_CLASS_16].used_max; }
+
+	static u32  getPoolTotal(u8 block_class)		{ return s_pool[block_class].total; }
+	static u32  getPoolUsed(u8 block_class)			{ return s_pool[block_class].used; }
+	static u32  getPoolUsedMax(u8 block_class)		{ return s_pool[block_class].used_max; }
+	static u32  getPoolDataBytes(u8 block_class)	{ return s_pool[block_class].data_bytes; }
+	static u32  getPoolAllocs(u8 block_class)		{ return s_pool[block_class].allocs; }
+	static u32  getDelayBlocks()				{ return s_delayBlocks; }
+	static u32  getDelayBlocksUsed()			{ return s_delayBlocksUsed; }
+	static u32  getNumOverflows()				{ return s_numOverflows; }
+
+	static void setGovernor(bool enable)		{ s_bGovernor = enable; }
+	static void logGovernor();
+		// logs queued governor decisions from task level,
+		// i.e. from the audio core's loop()
+	static u32  getGovernorLoad()				{ return s_governorLoad; }
+	static u32  getNumDegraded()				{ return s_numDegraded; }
+	static u32  getNumSkipped()					{ return s_numSkipped; }
+	static u32  getGovernorEvents()				{ return s_governorEvents; }
+
+	static void getStats(audio_system_stats_t *pStats)	{ s_stats.read(pStats); }
+		// a consistent copy of the stats as of the last block,
+		// for UI code on another core
 	
 private:
     friend class AudioStream;
-	friend class CStatusWindow;
+	friend class AudioGraph;
     
-    static bool initialize_memory(u32 num_audio_blocks);
+    static bool initialize_memory(u32 num_audio_blocks, u32 num_blocks32, u32 num_raw_blocks, u32 num_delay_blocks);
+    static bool initialize_pool(u8 block_class, u32 num_blocks, u32 data_bytes);
 	static void traverse_update(u16 depth, AudioStream *p);
+	static void governor(u32 us);
+	static void governorDegrade();
+	static void governorRestore();
+	static void governorSet(AudioStream *p, u8 mode);
 
 	static u16  s_numStreams;
-	static u32  s_totalBlocks;
-	static u32  s_blocksUsed;
-	static u32  s_blocksUsedMax;
 	static u32  s_cpuCycles;
     static u32  s_nInUpdate;
 	static u32  s_cpuCyclesMax;
 	static u32  s_numOverflows;
     static bool s_bUpdateScheduled;
+	static bool s_bPresorted;		// by AudioGraph
     
     static AudioStream   *s_pFirstStream;
 	static AudioStream   *s_pLastStream;
-	static audio_block_t *s_pAudioMemory;
-    static audio_block_t *s_pFreeBlock;
+	static audio_pool_t   s_pool[AUDIO_NUM_BLOCK_CLASSES];
+	static int16_t       *s_pDelayArena;
+	static u32            s_delayBlocks;
+	static u32            s_delayBlocksUsed;
+
+	static bool           s_bGovernor;
+	static u32            s_governorLoad;		// percent, smoothed
+	static u32            s_governorAvg;		// us << 3
+	static u32            s_governorLastOverflows;
+	static u32            s_governorOverflowBits;	// one per block, newest in bit 0
+	static u16            s_governorOver;
+	static u16            s_governorUnder;
+	static u16            s_governorSettle;
+	static u32            s_numDegraded;
+	static u32            s_numSkipped;
+	static u32            s_governorEvents;
+	static audio_governor_event_t s_governorLog[AUDIO_GOVERNOR_EVENTS];
+	static volatile u32   s_governorHead;
+	static u32            s_governorTail;
+
+	static AudioSnapshot<audio_system_stats_t> s_stats;
 
 };
 
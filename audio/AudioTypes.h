@@ -13,14 +13,63 @@ class AudioStream;
 #define AUDIO_BLOCK_BYTES  			(AUDIO_BLOCK_SAMPLES * sizeof(s16))
 #define AUDIO_SAMPLE_RATE           44100
 
+// The block pool has several size classes that share a common header.
+// All of them travel through the same input queues and connections as
+// an audio_block_t pointer, and the typed helpers in AudioStream and
+// AudioSystem check the class and cast.  The 16 bit mono class is the
+// classic teensy block and is what every existing stream uses.
+//
+// The headers live in a compact array per class, apart from the
+// payloads, and are linked by index.  Each payload is aligned to a
+// cache line so that SIMD code gets aligned loads, and so that the
+// ref_count traffic from transmit() and release() on one core does
+// not dirty the lines another core is streaming samples through.
+
+#define AUDIO_BLOCK_CLASS_16        0       // int16_t mono
+#define AUDIO_BLOCK_CLASS_32        1       // int32_t mono
+#define AUDIO_BLOCK_CLASS_RAW       2       // int32_t interleaved
+#define AUDIO_NUM_BLOCK_CLASSES     3
+
+#define AUDIO_RAW_MAX_CHANNELS      8
+	// matches the widest bcm_pcm raw (tdm) block
+
+#define AUDIO_BLOCK_ALIGN           64      // payload alignment (cache line)
+#define AUDIO_BLOCK_NONE            0xffff  // end of a free list
+
+#define AUDIO_BLOCK32_BYTES         (AUDIO_BLOCK_SAMPLES * sizeof(s32))
+#define AUDIO_BLOCK_RAW_BYTES       (AUDIO_BLOCK_SAMPLES * AUDIO_RAW_MAX_CHANNELS * sizeof(s32))
+
 typedef struct audio_block_struct
 {
 	u16 ref_count;
-    audio_block_struct *next;
-    audio_block_struct *prev;
-	int16_t data[AUDIO_BLOCK_SAMPLES];
+	u8  block_class;
+	u8  num_channels;       // only meaningful for raw blocks
+	u16 index;              // of this header within its class
+	u16 next;               // free list link (index)
+	int16_t *data;          // AUDIO_BLOCK_SAMPLES
 } audio_block_t;
 
+typedef struct audio_block32_struct
+{
+	u16 ref_count;
+	u8  block_class;
+	u8  num_channels;
+	u16 index;
+	u16 next;
+	int32_t *data;          // AUDIO_BLOCK_SAMPLES
+} audio_block32_t;
+
+typedef struct audio_block_raw_struct
+{
+	u16 ref_count;
+	u8  block_class;
+	u8  num_channels;
+	u16 index;
+	u16 next;
+	int32_t *data;          // AUDIO_BLOCK_SAMPLES * num_channels, interleaved
+} audio_block_raw_t;
+
+
 #define AUDIO_INPUT_LINEIN  0
 #define AUDIO_INPUT_MIC     1
 
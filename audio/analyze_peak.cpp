@@ -40,10 +40,19 @@ void AudioAnalyzePeak::update(void)
 	if (!block)
 		return;
 		
+	// start over if the UI has read the last one,
+	// otherwise keep accumulating into it
+
+	if (m_snapshot.consumed())
+	{
+		m_peak.min_sample = 32767;
+		m_peak.max_sample = -32768;
+	}
+
 	p = block->data;
 	end = p + AUDIO_BLOCK_SAMPLES;
-	min = min_sample;
-	max = max_sample;
+	min = m_peak.min_sample;
+	max = m_peak.max_sample;
 	do
 	{
 		int16_t d=*p++;
@@ -52,9 +61,9 @@ void AudioAnalyzePeak::update(void)
 	}
 	while (p < end);
 	
-	min_sample = min;
-	max_sample = max;
-	m_bChanged = true;
+	m_peak.min_sample = min;
+	m_peak.max_sample = max;
+	m_snapshot.publish(m_peak);
 
 	AudioSystem::release(block);
 
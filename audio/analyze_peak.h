@@ -28,6 +28,14 @@
 #define analyze_peakdetect_h_
 
 #include "AudioStream.h"
+#include "AudioSnapshot.h"
+
+
+typedef struct
+{
+	int16_t min_sample;
+	int16_t max_sample;
+}   audio_peak_t;
 
 
 class AudioAnalyzePeak : public AudioStream
@@ -38,46 +46,34 @@ public:
 		AudioStream(1,0,inputQueueArray)
 	{
 		m_instance = s_nextInstance++;
-		m_bChanged = 0;
-		min_sample = 32767;
-		max_sample = -32768;
+		m_priority = AUDIO_PRIORITY_BACKGROUND;
+		m_peak.min_sample = 32767;
+		m_peak.max_sample = -32768;
 	}
 	
 	virtual const char *getName()	{ return "peak"; }
 	virtual u16   getType()  	  	{ return AUDIO_DEVICE_OTHER; }
 
-	bool available(void)
-	{
-		__disable_irq();
-		bool flag = m_bChanged;
-		if (flag) m_bChanged = false;
-		__enable_irq();
-		return flag;
-	}
+	// These are called from the UI core.  Each read returns the
+	// peak since the previous read, as published by update().
+
+	bool available(void)	{ return m_snapshot.available(); }
 	
 	float read(void)
 	{
-		__disable_irq();
-		int min = min_sample;
-		int max = max_sample;
-		min_sample = 32767;
-		max_sample = -32768;
-		__enable_irq();
-		min = abs(min);
-		max = abs(max);
+		audio_peak_t peak;
+		m_snapshot.read(&peak);
+		int min = abs(peak.min_sample);
+		int max = abs(peak.max_sample);
 		if (min > max) max = min;
 		return (float)max / 32767.0f;
 	}
 	
 	float readPeakToPeak(void)
 	{
-		__disable_irq();
-		int min = min_sample;
-		int max = max_sample;
-		min_sample = 32767;
-		max_sample = -32768;
-		__enable_irq();
-		return (float)(max - min) / 32767.0f;
+		audio_peak_t peak;
+		m_snapshot.read(&peak);
+		return (float)(peak.max_sample - peak.min_sample) / 32767.0f;
 	}
 
 private:
@@ -85,10 +81,10 @@ private:
 	static u16 s_nextInstance;
 
 	volatile bool m_bRunning;
-	volatile bool m_bChanged;
 	
-	int16_t min_sample;
-	int16_t max_sample;
+	audio_peak_t m_peak;
+		// accumulated by update() until the UI has read it
+	AudioSnapshot<audio_peak_t> m_snapshot;
 	
 	audio_block_t *inputQueueArray[1];
 	
@@ -34,14 +34,17 @@ u16 AudioAnalyzeRMS::s_nextInstance = 0;
 
 void AudioAnalyzeRMS::update(void)
 {
-	count++;
+	m_totals.count++;
 	audio_block_t *block = receiveReadOnly();
 	if (!block)
+	{
+		m_snapshot.publish(m_totals);
 		return;
+	}
 
 	uint32_t *p = (uint32_t *)(block->data);
 	uint32_t *end = p + AUDIO_BLOCK_SAMPLES/2;
-	int64_t sum = accum;
+	int64_t sum = 0;
 	do {
 		uint32_t n1 = *p++;
 		uint32_t n2 = *p++;
@@ -52,7 +55,8 @@ void AudioAnalyzeRMS::update(void)
 		sum = multiply_accumulate_16tx16t_add_16bx16b(sum, n3, n3);
 		sum = multiply_accumulate_16tx16t_add_16bx16b(sum, n4, n4);
 	} while (p < end);
-	accum = sum;
+	m_totals.sum += sum;
+	m_snapshot.publish(m_totals);
 	
 #if 0	// KINETISL implementation
 	int16_t *p = block->data;
@@ -71,12 +75,15 @@ void AudioAnalyzeRMS::update(void)
 
 float AudioAnalyzeRMS::read(void)
 {
-	__disable_irq();
-	int64_t sum = accum;
-	accum = 0;
-	uint32_t num = count;
-	count = 0;
-	__enable_irq();
+	// unsigned differences are correct across wraps
+
+	audio_rms_t totals;
+	m_snapshot.read(&totals);
+	uint64_t sum = totals.sum - m_last.sum;
+	uint32_t num = totals.count - m_last.count;
+	m_last = totals;
+	if (!num)
+		return 0.0;
 	float meansq = sum / (num * AUDIO_BLOCK_SAMPLES);
 	// TODO: shift down to 32 bits and use sqrt_uint32
 	//       but is that really any more efficient?
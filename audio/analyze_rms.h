@@ -29,12 +29,22 @@
 
 #include "Arduino.h"
 #include "AudioStream.h"
+#include "AudioSnapshot.h"
 
 #ifdef __circle__
     #include "khrn_int_math.h"
 #endif
 
 
+typedef struct
+	// running totals that are never reset, so the reader
+	// can difference them against the ones it last read
+{
+	uint64_t sum;
+	uint32_t count;
+}   audio_rms_t;
+
+
 class AudioAnalyzeRMS : public AudioStream
 {
 public:
@@ -43,22 +53,27 @@ public:
 		AudioStream(0,1,inputQueueArray)
 	{
 		m_instance = s_nextInstance++;
-		accum = 0;
-		count = 0;
+		m_priority = AUDIO_PRIORITY_BACKGROUND;
+		m_totals.sum = 0;
+		m_totals.count = 0;
+		m_last.sum = 0;
+		m_last.count = 0;
 	}
 
 	virtual const char *getName()	{ return "rms"; }
 	virtual u16   getType()  	  	{ return AUDIO_DEVICE_OTHER; }
 	
-	bool available(void)  	{ return count > 0; }
+	bool available(void)  	{ return m_snapshot.available(); }
 	float read(void);
+		// from the UI core, the rms since the previous read
 	
 private:
 
 	static u16 s_nextInstance;
 	
-	int64_t accum;
-	uint32_t count;
+	audio_rms_t m_totals;		// audio side
+	audio_rms_t m_last;			// ui side
+	AudioSnapshot<audio_rms_t> m_snapshot;
 
 	audio_block_t *inputQueueArray[1];
 	
@@ -40,6 +40,8 @@
 
 #include "arm_math.h"
 
+#ifndef ARM_MATH_NEON    // see arm_math_neon.cpp
+
 /**    
  * @ingroup groupMath    
  */
@@ -146,3 +148,5 @@ void arm_add_q31(
 /**    
  * @} end of BasicAdd group    
  */
+
+#endif  // !ARM_MATH_NEON
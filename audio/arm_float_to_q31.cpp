@@ -40,6 +40,8 @@
 
 #include "arm_math.h"
 
+#ifndef ARM_MATH_NEON    // see arm_math_neon.cpp
+
 /**    
  * @ingroup groupSupport    
  */
@@ -209,3 +211,5 @@ void arm_float_to_q31(
 /**    
  * @} end of float_to_x group    
  */
+
+#endif  // !ARM_MATH_NEON
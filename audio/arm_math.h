@@ -267,6 +267,12 @@
 #include "core_cmInstr.h"
 #include "core_cm4_simd.h"
 
+// On the Pi the basic kernels in arm_math_neon.cpp replace the
+// vendored scalar ones.  Define ARM_MATH_NO_NEON to build without.
+#if defined(__ARM_NEON) && !defined(ARM_MATH_NO_NEON)
+#define ARM_MATH_NEON
+#endif
+
 
 #if 0
 // generic for any board...
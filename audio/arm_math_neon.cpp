@@ -0,0 +1,453 @@
+// arm_math_neon.cpp
+//
+// NEON versions of the vendored CMSIS basic kernels, for the Pi's
+// A-class cores, where the CMSIS sources otherwise run as scalar
+// loops over the emulated M4 SIMD intrinsics.
+//
+// When ARM_MATH_NEON is defined (see arm_math.h) this file provides
+// arm_add_q31, arm_shift_q31, arm_q15_to_q31, arm_q31_to_q15 and
+// arm_float_to_q31, and the vendored sources compile to nothing.
+//
+// It also provides the fill, copy, scale and mult kernels that were
+// not vendored, as NEON or as plain C, so that code can use them
+// on either build.
+//
+// The results are bit exact with the CMSIS reference code, except
+// that arm_scale_q31() of -1.0 by -1.0 with a non-negative shift gives
+// 0x7ffffffe where CMSIS saturates to 0x7fffffff.
+
+#include "arm_math.h"
+
+#ifdef ARM_MATH_NEON
+	#include <arm_neon.h>
+#endif
+
+
+#ifdef ARM_MATH_NEON
+
+//------------------------------------------
+// replacements for the vendored kernels
+//------------------------------------------
+
+void arm_add_q31(
+	q31_t * pSrcA,
+	q31_t * pSrcB,
+	q31_t * pDst,
+	uint32_t blockSize)
+{
+	uint32_t blkCnt = blockSize >> 2u;
+	while (blkCnt--)
+	{
+		vst1q_s32(pDst, vqaddq_s32(vld1q_s32(pSrcA), vld1q_s32(pSrcB)));
+		pSrcA += 4;
+		pSrcB += 4;
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	while (blkCnt--)
+		*pDst++ = clip_q63_to_q31((q63_t) *pSrcA++ + *pSrcB++);
+}
+
+
+void arm_shift_q31(
+	q31_t * pSrc,
+	int8_t shiftBits,
+	q31_t * pDst,
+	uint32_t blockSize)
+	// vqshl saturates left shifts, and a negative count
+	// is a truncating arithmetic right shift, as in CMSIS
+{
+	int32x4_t shift = vdupq_n_s32(shiftBits);
+	uint32_t blkCnt = blockSize >> 2u;
+	while (blkCnt--)
+	{
+		vst1q_s32(pDst, vqshlq_s32(vld1q_s32(pSrc), shift));
+		pSrc += 4;
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	while (blkCnt--)
+	{
+		*pDst++ = (shiftBits >= 0) ?
+			clip_q63_to_q31((q63_t) *pSrc++ << shiftBits) :
+			*pSrc++ >> -shiftBits;
+	}
+}
+
+
+void arm_q15_to_q31(
+	q15_t * pSrc,
+	q31_t * pDst,
+	uint32_t blockSize)
+{
+	uint32_t blkCnt = blockSize >> 3u;
+	while (blkCnt--)
+	{
+		int16x8_t in = vld1q_s16(pSrc);
+		vst1q_s32(pDst,     vshll_n_s16(vget_low_s16(in), 16));
+		vst1q_s32(pDst + 4, vshll_n_s16(vget_high_s16(in), 16));
+		pSrc += 8;
+		pDst += 8;
+	}
+	blkCnt = blockSize & 7u;
+	while (blkCnt--)
+		*pDst++ = (q31_t) *pSrc++ << 16;
+}
+
+
+void arm_q31_to_q15(
+	q31_t * pSrc,
+	q15_t * pDst,
+	uint32_t blockSize)
+{
+	uint32_t blkCnt = blockSize >> 3u;
+	while (blkCnt--)
+	{
+		int16x4_t lo = vshrn_n_s32(vld1q_s32(pSrc), 16);
+		int16x4_t hi = vshrn_n_s32(vld1q_s32(pSrc + 4), 16);
+		vst1q_s16(pDst, vcombine_s16(lo, hi));
+		pSrc += 8;
+		pDst += 8;
+	}
+	blkCnt = blockSize & 7u;
+	while (blkCnt--)
+		*pDst++ = (q15_t) (*pSrc++ >> 16);
+}
+
+
+void arm_float_to_q31(
+	float32_t * pSrc,
+	q31_t * pDst,
+	uint32_t blockSize)
+	// vcvt saturates and truncates toward zero, like the
+	// clip_q63_to_q31 of a truncating cast in the reference
+{
+	uint32_t blkCnt = blockSize >> 2u;
+	#ifdef ARM_MATH_ROUNDING
+		float32x4_t half = vdupq_n_f32(0.5f);
+		uint32x4_t sign_bit = vdupq_n_u32(0x80000000);
+	#endif
+	while (blkCnt--)
+	{
+		#ifdef ARM_MATH_ROUNDING
+			float32x4_t in = vmulq_n_f32(vld1q_f32(pSrc), 2147483648.0f);
+			float32x4_t rnd = vreinterpretq_f32_u32(vorrq_u32(
+				vreinterpretq_u32_f32(half),
+				vandq_u32(vreinterpretq_u32_f32(in), sign_bit)));
+			vst1q_s32(pDst, vcvtq_s32_f32(vaddq_f32(in, rnd)));
+		#else
+			vst1q_s32(pDst, vcvtq_n_s32_f32(vld1q_f32(pSrc), 31));
+		#endif
+		pSrc += 4;
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	while (blkCnt--)
+	{
+		float32_t in = *pSrc++ * 2147483648.0f;
+		#ifdef ARM_MATH_ROUNDING
+			in += in > 0.0f ? 0.5f : -0.5f;
+		#endif
+		*pDst++ = clip_q63_to_q31((q63_t) in);
+	}
+}
+
+
+//------------------------------------------
+// additional kernels
+//------------------------------------------
+
+void arm_fill_q31(q31_t value, q31_t * pDst, uint32_t blockSize)
+{
+	int32x4_t v = vdupq_n_s32(value);
+	uint32_t blkCnt = blockSize >> 2u;
+	while (blkCnt--)
+	{
+		vst1q_s32(pDst, v);
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	while (blkCnt--)
+		*pDst++ = value;
+}
+
+
+void arm_fill_q15(q15_t value, q15_t * pDst, uint32_t blockSize)
+{
+	int16x8_t v = vdupq_n_s16(value);
+	uint32_t blkCnt = blockSize >> 3u;
+	while (blkCnt--)
+	{
+		vst1q_s16(pDst, v);
+		pDst += 8;
+	}
+	blkCnt = blockSize & 7u;
+	while (blkCnt--)
+		*pDst++ = value;
+}
+
+
+void arm_fill_f32(float32_t value, float32_t * pDst, uint32_t blockSize)
+{
+	float32x4_t v = vdupq_n_f32(value);
+	uint32_t blkCnt = blockSize >> 2u;
+	while (blkCnt--)
+	{
+		vst1q_f32(pDst, v);
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	while (blkCnt--)
+		*pDst++ = value;
+}
+
+
+void arm_copy_q31(q31_t * pSrc, q31_t * pDst, uint32_t blockSize)
+{
+	uint32_t blkCnt = blockSize >> 2u;
+	while (blkCnt--)
+	{
+		vst1q_s32(pDst, vld1q_s32(pSrc));
+		pSrc += 4;
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	while (blkCnt--)
+		*pDst++ = *pSrc++;
+}
+
+
+void arm_copy_q15(q15_t * pSrc, q15_t * pDst, uint32_t blockSize)
+{
+	uint32_t blkCnt = blockSize >> 3u;
+	while (blkCnt--)
+	{
+		vst1q_s16(pDst, vld1q_s16(pSrc));
+		pSrc += 8;
+		pDst += 8;
+	}
+	blkCnt = blockSize & 7u;
+	while (blkCnt--)
+		*pDst++ = *pSrc++;
+}
+
+
+void arm_copy_f32(float32_t * pSrc, float32_t * pDst, uint32_t blockSize)
+{
+	uint32_t blkCnt = blockSize >> 2u;
+	while (blkCnt--)
+	{
+		vst1q_f32(pDst, vld1q_f32(pSrc));
+		pSrc += 4;
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	while (blkCnt--)
+		*pDst++ = *pSrc++;
+}
+
+
+void arm_scale_q31(
+	q31_t * pSrc,
+	q31_t scaleFract,
+	int8_t shift,
+	q31_t * pDst,
+	uint32_t blockSize)
+	// CMSIS computes ((a*b) >> 32) << (shift+1).  vqdmulh gives
+	// (a*b) >> 31, so for left shifts the low bit is cleared first.
+{
+	int32x4_t scale = vdupq_n_s32(scaleFract);
+	int32x4_t count = vdupq_n_s32(shift);
+	int32x4_t mask = vdupq_n_s32(shift >= 0 ? ~1 : ~0);
+	uint32_t blkCnt = blockSize >> 2u;
+	while (blkCnt--)
+	{
+		int32x4_t q = vandq_s32(vqdmulhq_s32(vld1q_s32(pSrc), scale), mask);
+		vst1q_s32(pDst, vqshlq_s32(q, count));
+		pSrc += 4;
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	int8_t kShift = shift + 1;
+	while (blkCnt--)
+	{
+		q31_t in = (q31_t) (((q63_t) *pSrc++ * scaleFract) >> 32);
+		*pDst++ = (kShift >= 0) ?
+			clip_q63_to_q31((q63_t) in << kShift) :
+			in >> -kShift;
+	}
+}
+
+
+void arm_scale_q15(
+	q15_t * pSrc,
+	q15_t scaleFract,
+	int8_t shift,
+	q15_t * pDst,
+	uint32_t blockSize)
+{
+	int16x4_t scale = vdup_n_s16(scaleFract);
+	int32x4_t count = vdupq_n_s32(shift - 15);
+	uint32_t blkCnt = blockSize >> 3u;
+	while (blkCnt--)
+	{
+		int16x8_t in = vld1q_s16(pSrc);
+		int32x4_t lo = vqshlq_s32(vmull_s16(vget_low_s16(in), scale), count);
+		int32x4_t hi = vqshlq_s32(vmull_s16(vget_high_s16(in), scale), count);
+		vst1q_s16(pDst, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+		pSrc += 8;
+		pDst += 8;
+	}
+	blkCnt = blockSize & 7u;
+	while (blkCnt--)
+		*pDst++ = (q15_t) __SSAT(((q31_t) *pSrc++ * scaleFract) >> (15 - shift), 16);
+}
+
+
+void arm_mult_q31(
+	q31_t * pSrcA,
+	q31_t * pSrcB,
+	q31_t * pDst,
+	uint32_t blockSize)
+	// CMSIS is (a*b) >> 32, saturated to 31 bits, << 1
+{
+	int32x4_t mask = vdupq_n_s32(~1);
+	uint32_t blkCnt = blockSize >> 2u;
+	while (blkCnt--)
+	{
+		int32x4_t q = vqdmulhq_s32(vld1q_s32(pSrcA), vld1q_s32(pSrcB));
+		vst1q_s32(pDst, vandq_s32(q, mask));
+		pSrcA += 4;
+		pSrcB += 4;
+		pDst += 4;
+	}
+	blkCnt = blockSize & 3u;
+	while (blkCnt--)
+	{
+		q31_t out = (q31_t) (((q63_t) *pSrcA++ * *pSrcB++) >> 32);
+		*pDst++ = __SSAT(out, 31) << 1u;
+	}
+}
+
+
+void arm_mult_q15(
+	q15_t * pSrcA,
+	q15_t * pSrcB,
+	q15_t * pDst,
+	uint32_t blockSize)
+{
+	uint32_t blkCnt = blockSize >> 3u;
+	while (blkCnt--)
+	{
+		vst1q_s16(pDst, vqdmulhq_s16(vld1q_s16(pSrcA), vld1q_s16(pSrcB)));
+		pSrcA += 8;
+		pSrcB += 8;
+		pDst += 8;
+	}
+	blkCnt = blockSize & 7u;
+	while (blkCnt--)
+		*pDst++ = (q15_t) __SSAT(((q31_t) *pSrcA++ * *pSrcB++) >> 15, 16);
+}
+
+
+#else	// !ARM_MATH_NEON
+
+//------------------------------------------
+// plain C versions of the additional kernels
+//------------------------------------------
+
+void arm_fill_q31(q31_t value, q31_t * pDst, uint32_t blockSize)
+{
+	while (blockSize--)
+		*pDst++ = value;
+}
+
+
+void arm_fill_q15(q15_t value, q15_t * pDst, uint32_t blockSize)
+{
+	while (blockSize--)
+		*pDst++ = value;
+}
+
+
+void arm_fill_f32(float32_t value, float32_t * pDst, uint32_t blockSize)
+{
+	while (blockSize--)
+		*pDst++ = value;
+}
+
+
+void arm_copy_q31(q31_t * pSrc, q31_t * pDst, uint32_t blockSize)
+{
+	memcpy(pDst, pSrc, blockSize * sizeof(q31_t));
+}
+
+
+void arm_copy_q15(q15_t * pSrc, q15_t * pDst, uint32_t blockSize)
+{
+	memcpy(pDst, pSrc, blockSize * sizeof(q15_t));
+}
+
+
+void arm_copy_f32(float32_t * pSrc, float32_t * pDst, uint32_t blockSize)
+{
+	memcpy(pDst, pSrc, blockSize * sizeof(float32_t));
+}
+
+
+void arm_scale_q31(
+	q31_t * pSrc,
+	q31_t scaleFract,
+	int8_t shift,
+	q31_t * pDst,
+	uint32_t blockSize)
+{
+	int8_t kShift = shift + 1;
+	while (blockSize--)
+	{
+		q31_t in = (q31_t) (((q63_t) *pSrc++ * scaleFract) >> 32);
+		*pDst++ = (kShift >= 0) ?
+			clip_q63_to_q31((q63_t) in << kShift) :
+			in >> -kShift;
+	}
+}
+
+
+void arm_scale_q15(
+	q15_t * pSrc,
+	q15_t scaleFract,
+	int8_t shift,
+	q15_t * pDst,
+	uint32_t blockSize)
+{
+	while (blockSize--)
+		*pDst++ = (q15_t) __SSAT(((q31_t) *pSrc++ * scaleFract) >> (15 - shift), 16);
+}
+
+
+void arm_mult_q31(
+	q31_t * pSrcA,
+	q31_t * pSrcB,
+	q31_t * pDst,
+	uint32_t blockSize)
+{
+	while (blockSize--)
+	{
+		q31_t out = (q31_t) (((q63_t) *pSrcA++ * *pSrcB++) >> 32);
+		*pDst++ = __SSAT(out, 31) << 1u;
+	}
+}
+
+
+void arm_mult_q15(
+	q15_t * pSrcA,
+	q15_t * pSrcB,
+	q15_t * pDst,
+	uint32_t blockSize)
+{
+	while (blockSize--)
+		*pDst++ = (q15_t) __SSAT(((q31_t) *pSrcA++ * *pSrcB++) >> 15, 16);
+}
+
+
+#endif	// !ARM_MATH_NEON
@@ -40,6 +40,8 @@
 
 #include "arm_math.h"
 
+#ifndef ARM_MATH_NEON    // see arm_math_neon.cpp
+
 /**    
  * @ingroup groupSupport    
  */
@@ -154,3 +156,5 @@ void arm_q15_to_q31(
 /**    
  * @} end of q15_to_x group    
  */
+
+#endif  // !ARM_MATH_NEON
@@ -40,6 +40,8 @@
 
 #include "arm_math.h"
 
+#ifndef ARM_MATH_NEON    // see arm_math_neon.cpp
+
 /**    
  * @ingroup groupSupport    
  */
@@ -143,3 +145,5 @@ void arm_q31_to_q15(
 /**    
  * @} end of q31_to_x group    
  */
+
+#endif  // !ARM_MATH_NEON
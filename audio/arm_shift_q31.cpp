@@ -40,6 +40,8 @@
 
 #include "arm_math.h"
 
+#ifndef ARM_MATH_NEON    // see arm_math_neon.cpp
+
 /**        
  * @ingroup groupMath        
  */
@@ -201,3 +203,5 @@ void arm_shift_q31(
 /**        
  * @} end of shift group        
  */
+
+#endif  // !ARM_MATH_NEON
@@ -0,0 +1,310 @@
+#include "effect_asrc.h"
+#include <circle/logger.h>
+#include <circle/timer.h>
+#include <math.h>
+
+
+#define log_name "asrc"
+
+#define FILL_SMOOTHING      0.05
+	// one pole smoothing of the fifo level, as it jumps
+	// by a block whenever the source skips or doubles up
+#define FF_MIN_BLOCKS       256
+	// number of timestamped blocks on each side before
+	// the feed-forward ratio estimate is updated
+#define FF_SMOOTHING        0.1
+
+u16 AudioEffectASRC::s_nextInstance = 0;
+bool AudioEffectASRC::s_tableBuilt = 0;
+int16_t AudioEffectASRC::s_coef[ASRC_PHASES + 1][ASRC_TAPS];
+
+
+
+AudioEffectASRC::AudioEffectASRC() :
+	AudioStream(ASRC_CHANNELS,ASRC_CHANNELS,inputQueueArray)
+{
+	m_instance = s_nextInstance++;
+
+	if (!s_tableBuilt)
+		buildTable();
+
+	memset(m_fifo,0,sizeof(m_fifo));
+
+	// start with the fifo primed with silence at the target fill
+
+	m_writePos   = ASRC_TARGET_FILL;
+	m_readPos    = 0;
+	m_frac       = 0;
+
+	m_locked     = true;
+	m_ratio      = 1.0;
+	m_ratioFF    = 1.0;
+	m_integral   = 0.0;
+	m_fillAvg    = ASRC_TARGET_FILL;
+	m_kp         = 0.001;
+	m_ki         = 0.000002;
+
+	m_srcLast    = 0;
+	m_srcTime    = 0;
+	m_srcCount   = 0;
+	m_sinkLast   = 0;
+	m_sinkTime   = 0;
+	m_sinkCount  = 0;
+
+	m_srcTimeRef   = 0;
+	m_srcCountRef  = 0;
+	m_sinkTimeRef  = 0;
+	m_sinkCountRef = 0;
+
+	m_underruns  = 0;
+	m_overruns   = 0;
+}
+
+
+void AudioEffectASRC::buildTable()
+	// Blackman windowed sinc with the cutoff at 0.45 fs.
+	// Row p is the kernel for a fractional position of p/ASRC_PHASES.
+	// The extra row at the end lets update() always interpolate
+	// between row p and p+1.  Each row is normalized to unity DC gain.
+{
+	const double half = ASRC_TAPS / 2;
+	const double fc = 0.9;
+
+	for (u16 p=0; p<=ASRC_PHASES; p++)
+	{
+		double h[ASRC_TAPS];
+		double sum = 0.0;
+		double frac = ((double) p) / ASRC_PHASES;
+
+		for (u16 k=0; k<ASRC_TAPS; k++)
+		{
+			double t = ((double) k) - (half - 1.0) - frac;
+			double x = M_PI * fc * t;
+			double sinc = (t == 0.0) ? fc : fc * sin(x) / x;
+			double w = (fabs(t) >= half) ? 0.0 :
+				0.42 + 0.5 * cos(M_PI * t / half) + 0.08 * cos(2.0 * M_PI * t / half);
+			h[k] = sinc * w;
+			sum += h[k];
+		}
+
+		for (u16 k=0; k<ASRC_TAPS; k++)
+		{
+			s32 c = (s32) floor(h[k] / sum * 32768.0 + 0.5);
+			if (c > 32767) c = 32767;
+			if (c < -32768) c = -32768;
+			s_coef[p][k] = c;
+		}
+	}
+
+	s_tableBuilt = true;
+}
+
+
+void AudioEffectASRC::setRatio(float ratio)
+	// Fixes the ratio and opens the loop.
+	// Call setLocked(true) to resume tracking.
+{
+	if (ratio < 1.0 - ASRC_MAX_DEVIATION)
+		ratio = 1.0 - ASRC_MAX_DEVIATION;
+	if (ratio > 1.0 + ASRC_MAX_DEVIATION)
+		ratio = 1.0 + ASRC_MAX_DEVIATION;
+	m_ratio = ratio;
+	m_locked = false;
+}
+
+
+//------------------------------------------
+// timestamps (ISR context)
+//------------------------------------------
+
+void AudioEffectASRC::markSourceBlock()
+{
+	u32 now = CTimer::GetClockTicks();
+	if (m_srcLast)
+	{
+		m_srcTime += now - m_srcLast;
+		m_srcCount++;
+	}
+	m_srcLast = now;
+}
+
+
+void AudioEffectASRC::markSinkBlock()
+{
+	u32 now = CTimer::GetClockTicks();
+	if (m_sinkLast)
+	{
+		m_sinkTime += now - m_sinkLast;
+		m_sinkCount++;
+	}
+	m_sinkLast = now;
+}
+
+
+//------------------------------------------
+// ratio control
+//------------------------------------------
+
+void AudioEffectASRC::updateRatio()
+{
+	// feed forward from the dma timestamps: the ratio of input
+	// samples per output sample is the ratio of the block periods.
+	// The counters are monotonic and only ever read here, so a
+	// torn read merely costs one block of accuracy in the average.
+
+	u32 src_count = m_srcCount - m_srcCountRef;
+	u32 sink_count = m_sinkCount - m_sinkCountRef;
+	if (src_count >= FF_MIN_BLOCKS && sink_count >= FF_MIN_BLOCKS)
+	{
+		u32 src_time = m_srcTime - m_srcTimeRef;
+		u32 sink_time = m_sinkTime - m_sinkTimeRef;
+		if (src_time && sink_time)
+		{
+			float meas =
+				(((float) sink_time) / sink_count) /
+				(((float) src_time) / src_count);
+			if (meas > 1.0 - ASRC_MAX_DEVIATION &&
+				meas < 1.0 + ASRC_MAX_DEVIATION)
+				m_ratioFF += (meas - m_ratioFF) * FF_SMOOTHING;
+		}
+		m_srcTimeRef   += src_time;
+		m_srcCountRef  += src_count;
+		m_sinkTimeRef  += sink_time;
+		m_sinkCountRef += sink_count;
+	}
+
+	// PI loop on the smoothed fifo level
+
+	s32 fill = m_writePos - m_readPos;
+	m_fillAvg += (fill - m_fillAvg) * FILL_SMOOTHING;
+	float err = (m_fillAvg - ASRC_TARGET_FILL) / ASRC_TARGET_FILL;
+
+	m_integral += m_ki * err;
+	if (m_integral > ASRC_MAX_DEVIATION)
+		m_integral = ASRC_MAX_DEVIATION;
+	if (m_integral < -ASRC_MAX_DEVIATION)
+		m_integral = -ASRC_MAX_DEVIATION;
+
+	float ratio = m_ratioFF * (1.0 + m_kp * err + m_integral);
+	if (ratio < 1.0 - ASRC_MAX_DEVIATION)
+		ratio = 1.0 - ASRC_MAX_DEVIATION;
+	if (ratio > 1.0 + ASRC_MAX_DEVIATION)
+		ratio = 1.0 + ASRC_MAX_DEVIATION;
+	m_ratio = ratio;
+}
+
+
+//------------------------------------------
+// update
+//------------------------------------------
+
+void AudioEffectASRC::update(void)
+{
+	// push any input that arrived.  If only some of the
+	// channels transmitted, the others are written as silence
+	// so that the channels stay in step.
+
+	audio_block_t *in[ASRC_CHANNELS];
+	bool any = false;
+	for (u16 ch=0; ch<ASRC_CHANNELS; ch++)
+	{
+		in[ch] = receiveReadOnly(ch);
+		if (in[ch])
+			any = true;
+	}
+
+	if (any)
+	{
+		if (m_writePos - m_readPos + AUDIO_BLOCK_SAMPLES > ASRC_FIFO_SIZE - ASRC_TAPS)
+		{
+			m_overruns++;
+			m_readPos += AUDIO_BLOCK_SAMPLES;
+		}
+
+		for (u16 ch=0; ch<ASRC_CHANNELS; ch++)
+		{
+			int16_t *fifo = m_fifo[ch];
+			const int16_t *src = in[ch] ? in[ch]->data : 0;
+			u32 pos = m_writePos;
+			for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+			{
+				u32 idx = pos++ & ASRC_FIFO_MASK;
+				int16_t val = src ? src[i] : 0;
+				fifo[idx] = val;
+				if (idx < ASRC_TAPS)
+					fifo[idx + ASRC_FIFO_SIZE] = val;
+			}
+			if (in[ch])
+				AudioSystem::release(in[ch]);
+		}
+		m_writePos += AUDIO_BLOCK_SAMPLES;
+	}
+
+	if (m_locked)
+		updateRatio();
+
+	// make sure there is enough input for a whole output block,
+	// otherwise transmit nothing (silence) and let the fifo refill
+
+	u64 step = (u64) (((double) m_ratio) * 4294967296.0);
+	u32 step_int = (u32) (step >> 32);
+	u32 step_frac = (u32) step;
+	u32 needed = (u32) ((((u64) m_frac) + step * AUDIO_BLOCK_SAMPLES) >> 32) + ASRC_TAPS;
+	if (m_writePos - m_readPos < needed)
+	{
+		m_underruns++;
+		return;
+	}
+
+	audio_block_t *out[ASRC_CHANNELS];
+	for (u16 ch=0; ch<ASRC_CHANNELS; ch++)
+	{
+		out[ch] = AudioSystem::allocate();
+		if (!out[ch])
+		{
+			while (ch--)
+				AudioSystem::release(out[ch]);
+			return;
+		}
+	}
+
+	// fixed cost: two 16 tap dot products per sample per channel,
+	// blended by the fraction between the adjacent phases
+
+	u32 pos = m_readPos;
+	u32 frac = m_frac;
+	for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+	{
+		const int16_t *c0 = s_coef[frac >> (32 - ASRC_PHASE_BITS)];
+		const int16_t *c1 = c0 + ASRC_TAPS;
+		s32 alpha = (frac >> (32 - ASRC_PHASE_BITS - 16)) & 0xffff;
+
+		for (u16 ch=0; ch<ASRC_CHANNELS; ch++)
+		{
+			const int16_t *x = &m_fifo[ch][pos & ASRC_FIFO_MASK];
+			s32 acc0 = 0;
+			s32 acc1 = 0;
+			for (u16 k=0; k<ASRC_TAPS; k++)
+			{
+				acc0 += c0[k] * x[k];
+				acc1 += c1[k] * x[k];
+			}
+			s64 y = ((s64) acc0 * (65536 - alpha) + (s64) acc1 * alpha) >> 31;
+			if (y > 32767) y = 32767;
+			if (y < -32768) y = -32768;
+			out[ch]->data[i] = y;
+		}
+
+		u64 next = ((u64) frac) + step_frac;
+		frac = (u32) next;
+		pos += step_int + (u32) (next >> 32);
+	}
+	m_readPos = pos;
+	m_frac = frac;
+
+	for (u16 ch=0; ch<ASRC_CHANNELS; ch++)
+	{
+		transmit(out[ch],ch);
+		AudioSystem::release(out[ch]);
+	}
+}
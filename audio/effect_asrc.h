@@ -0,0 +1,110 @@
+#ifndef effect_asrc_h_
+#define effect_asrc_h_
+
+#include "Arduino.h"
+#include "AudioStream.h"
+
+// Asynchronous sample rate converter.
+//
+// Sits between two clock domains, i.e. when the Pi is generating the
+// master clock for a codec (with its attendant drift) and blocks arrive
+// from a source running off a different crystal.  Input blocks are
+// pushed into a per-channel fifo as they arrive (a source that misses
+// an update simply does not transmit), and exactly one block per channel
+// is produced on every update().
+//
+// The resampler is a 16 tap polyphase windowed-sinc with 64 phases,
+// linearly interpolated between adjacent phases, so the cost per
+// block is fixed regardless of the ratio.
+//
+// The ratio (input samples consumed per output sample) is the product
+// of a feed-forward estimate from the DMA block timestamps, if the
+// clients call markSourceBlock() and markSinkBlock() from their ISRs,
+// and a PI controller that holds the fifo at its target fill level.
+// Without timestamps the PI loop alone tracks the drift.
+
+#define ASRC_CHANNELS           2
+#define ASRC_TAPS               16
+#define ASRC_PHASE_BITS         6
+#define ASRC_PHASES             (1 << ASRC_PHASE_BITS)
+#define ASRC_FIFO_SIZE          2048        // per channel, power of two
+#define ASRC_FIFO_MASK          (ASRC_FIFO_SIZE - 1)
+#define ASRC_TARGET_FILL        (2 * AUDIO_BLOCK_SAMPLES + ASRC_TAPS)
+#define ASRC_MAX_DEVIATION      0.01        // +/- 1% pull range
+
+
+class AudioEffectASRC : public AudioStream
+{
+public:
+
+	AudioEffectASRC();
+
+	virtual const char *getName() 	{ return "asrc"; }
+	virtual u16   getType()  		{ return AUDIO_DEVICE_EFFECT; }
+
+	// called from the ISR of each clock domain once per dma block
+
+	void markSourceBlock();
+	void markSinkBlock();
+
+	// controller tuning, and a fixed ratio for open loop use
+
+	void setGains(float kp, float ki)	{ m_kp = kp; m_ki = ki; }
+	void setLocked(bool locked)			{ m_locked = locked; }
+	void setRatio(float ratio);
+
+	float getRatio()					{ return m_ratio; }
+	u32   getFill()						{ return m_writePos - m_readPos; }
+	u32   getUnderruns()				{ return m_underruns; }
+	u32   getOverruns()					{ return m_overruns; }
+	void  clearErrors()					{ m_underruns = 0; m_overruns = 0; }
+
+private:
+
+	static u16 s_nextInstance;
+	static bool s_tableBuilt;
+	static int16_t s_coef[ASRC_PHASES + 1][ASRC_TAPS];
+
+	static void buildTable();
+
+	audio_block_t *inputQueueArray[ASRC_CHANNELS];
+
+	int16_t  m_fifo[ASRC_CHANNELS][ASRC_FIFO_SIZE + ASRC_TAPS];
+		// the first ASRC_TAPS samples are mirrored past the end
+		// so that the filter can always read contiguous taps
+	u32      m_writePos;
+	u32      m_readPos;
+	u32      m_frac;
+
+	bool     m_locked;
+	float    m_ratio;
+	float    m_ratioFF;
+	float    m_integral;
+	float    m_fillAvg;
+	float    m_kp;
+	float    m_ki;
+
+	// accumulated by the isrs, consumed by update()
+
+	volatile u32 m_srcLast;
+	volatile u32 m_srcTime;
+	volatile u32 m_srcCount;
+	volatile u32 m_sinkLast;
+	volatile u32 m_sinkTime;
+	volatile u32 m_sinkCount;
+
+	u32      m_srcTimeRef;
+	u32      m_srcCountRef;
+	u32      m_sinkTimeRef;
+	u32      m_sinkCountRef;
+
+	u32      m_underruns;
+	u32      m_overruns;
+
+	void updateRatio();
+	virtual void update(void);
+
+};
+
+
+#endif	// !effect_asrc_h_
@@ -0,0 +1,504 @@
+#include "effect_convolution.h"
+#include <circle/logger.h>
+#include <circle/alloc.h>
+#include <circle/synchronize.h>
+#include <fatfs/ff.h>
+#include <math.h>
+
+#ifdef __ARM_NEON
+	#include <arm_neon.h>
+#endif
+
+
+#define log_name "convolve"
+
+#define CFFT_SIZE       (CONV_FFT_SIZE / 2)     // complex points
+#define CFFT_BITS       7
+
+u16 AudioEffectConvolution::s_nextInstance = 0;
+
+
+//------------------------------------------
+// fft
+//------------------------------------------
+// A real FFT of CONV_FFT_SIZE points is done as a complex FFT of
+// half the size on the even/odd samples packed as re/im, followed
+// by a split step.  The spectra are CONV_BINS interleaved complex
+// values, with the (purely real) nyquist bin packed into the
+// imaginary part of the DC bin.
+
+static bool  s_fftInited = 0;
+static float s_twiddle[2 * CFFT_SIZE];          // complex fft, e^-2pi*i*k/CFFT_SIZE
+static float s_split[2 * CONV_BINS];            // split step, e^-2pi*i*k/CONV_FFT_SIZE
+static u8    s_bitrev[CFFT_SIZE];
+
+
+static void fftInit()
+{
+	for (u32 k=0; k<CFFT_SIZE; k++)
+	{
+		double a = -2.0 * M_PI * k / CFFT_SIZE;
+		s_twiddle[2*k]   = cos(a);
+		s_twiddle[2*k+1] = sin(a);
+
+		u32 r = 0;
+		for (u32 b=0; b<CFFT_BITS; b++)
+			if (k & (1 << b))
+				r |= 1 << (CFFT_BITS - 1 - b);
+		s_bitrev[k] = r;
+	}
+	for (u32 k=0; k<CONV_BINS; k++)
+	{
+		double a = -2.0 * M_PI * k / CONV_FFT_SIZE;
+		s_split[2*k]   = cos(a);
+		s_split[2*k+1] = sin(a);
+	}
+	s_fftInited = 1;
+}
+
+
+static void cfft(float *z, bool inverse)
+	// in place radix-2 complex fft of CFFT_SIZE points, unscaled
+{
+	for (u32 i=0; i<CFFT_SIZE; i++)
+	{
+		u32 j = s_bitrev[i];
+		if (j > i)
+		{
+			float t;
+			t = z[2*i];   z[2*i]   = z[2*j];   z[2*j]   = t;
+			t = z[2*i+1]; z[2*i+1] = z[2*j+1]; z[2*j+1] = t;
+		}
+	}
+
+	float sign = inverse ? -1.0 : 1.0;
+	for (u32 len=2; len<=CFFT_SIZE; len<<=1)
+	{
+		u32 half = len >> 1;
+		u32 step = CFFT_SIZE / len;
+		for (u32 i=0; i<CFFT_SIZE; i+=len)
+		{
+			for (u32 j=0; j<half; j++)
+			{
+				float wr = s_twiddle[2*j*step];
+				float wi = sign * s_twiddle[2*j*step+1];
+				float *a = &z[2*(i+j)];
+				float *b = &z[2*(i+j+half)];
+				float tr = b[0]*wr - b[1]*wi;
+				float ti = b[0]*wi + b[1]*wr;
+				b[0] = a[0] - tr;
+				b[1] = a[1] - ti;
+				a[0] += tr;
+				a[1] += ti;
+			}
+		}
+	}
+}
+
+
+static void rfft(const float *x, float *X)
+	// CONV_FFT_SIZE real points to CONV_BINS packed complex bins
+{
+	float z[2 * CFFT_SIZE];
+	memcpy(z, x, sizeof(z));
+	cfft(z, false);
+
+	X[0] = z[0] + z[1];
+	X[1] = z[0] - z[1];
+	for (u32 k=1; k<CONV_BINS; k++)
+	{
+		u32 n = CFFT_SIZE - k;
+		float er = 0.5 * (z[2*k]   + z[2*n]);
+		float ei = 0.5 * (z[2*k+1] - z[2*n+1]);
+		float or_ = 0.5 * (z[2*k+1] + z[2*n+1]);
+		float oi = -0.5 * (z[2*k]   - z[2*n]);
+		float wr = s_split[2*k];
+		float wi = s_split[2*k+1];
+		X[2*k]   = er + or_*wr - oi*wi;
+		X[2*k+1] = ei + or_*wi + oi*wr;
+	}
+}
+
+
+static void irfft(const float *X, float *x)
+	// CONV_BINS packed complex bins to CONV_FFT_SIZE real points, scaled
+{
+	float *z = x;
+	z[0] = 0.5 * (X[0] + X[1]);
+	z[1] = 0.5 * (X[0] - X[1]);
+	for (u32 k=1; k<CONV_BINS; k++)
+	{
+		u32 n = CONV_BINS - k;
+		float er = 0.5 * (X[2*k]   + X[2*n]);
+		float ei = 0.5 * (X[2*k+1] - X[2*n+1]);
+		float dr = 0.5 * (X[2*k]   - X[2*n]);
+		float di = 0.5 * (X[2*k+1] + X[2*n+1]);
+		// O = D / W, and W is on the unit circle
+		float wr = s_split[2*k];
+		float wi = s_split[2*k+1];
+		float or_ = dr*wr + di*wi;
+		float oi = di*wr - dr*wi;
+		z[2*k]   = er - oi;
+		z[2*k+1] = ei + or_;
+	}
+	cfft(z, true);
+	float scale = 1.0 / CFFT_SIZE;
+	for (u32 i=0; i<CONV_FFT_SIZE; i++)
+		z[i] *= scale;
+}
+
+
+static void cmac(float *acc, const float *a, const float *b)
+	// acc += a * b over CONV_BINS packed complex bins.
+	// Bin 0 holds two real values and is fixed up separately.
+{
+	float dc = acc[0] + a[0] * b[0];
+	float ny = acc[1] + a[1] * b[1];
+
+	#ifdef __ARM_NEON
+		for (u32 k=0; k<CONV_BINS; k+=4)
+		{
+			float32x4x2_t va = vld2q_f32(a + 2*k);
+			float32x4x2_t vb = vld2q_f32(b + 2*k);
+			float32x4x2_t vc = vld2q_f32(acc + 2*k);
+			vc.val[0] = vmlaq_f32(vc.val[0], va.val[0], vb.val[0]);
+			vc.val[0] = vmlsq_f32(vc.val[0], va.val[1], vb.val[1]);
+			vc.val[1] = vmlaq_f32(vc.val[1], va.val[0], vb.val[1]);
+			vc.val[1] = vmlaq_f32(vc.val[1], va.val[1], vb.val[0]);
+			vst2q_f32(acc + 2*k, vc);
+		}
+	#else
+		for (u32 k=0; k<CONV_BINS; k++)
+		{
+			float ar = a[2*k], ai = a[2*k+1];
+			float br = b[2*k], bi = b[2*k+1];
+			acc[2*k]   += ar*br - ai*bi;
+			acc[2*k+1] += ar*bi + ai*br;
+		}
+	#endif
+
+	acc[0] = dc;
+	acc[1] = ny;
+}
+
+
+//------------------------------------------
+// AudioEffectConvolution
+//------------------------------------------
+
+AudioEffectConvolution::AudioEffectConvolution(float max_ms) :
+	AudioStream(1,1,inputQueueArray)
+{
+	m_instance = s_nextInstance++;
+	m_priority = AUDIO_PRIORITY_LOW;
+	m_degraded = 0;
+
+	u32 samples = (u32) (max_ms * (AUDIO_SAMPLE_RATE / 1000.0));
+	m_maxPartitions = (samples + CONV_PARTITION - 1) / CONV_PARTITION;
+	m_numPartitions = 0;
+	m_gain = 1.0;
+
+	m_pIR = 0;
+	m_pFDL = 0;
+	m_fdlPos = 0;
+
+	m_ready = 0;
+	m_inUpdate = 0;
+	m_tailState = CONV_TAIL_IDLE;
+	m_tailGen = 0;
+	m_tailArmGen = 0;
+	m_tailSlot = 0;
+	m_tailNum = 0;
+	m_tailWrap = 0;
+	m_tailDoneGen = ~0;
+	m_externalTail = 0;
+	m_tailLate = 0;
+
+	memset(m_input,0,sizeof(m_input));
+	memset(m_tail,0,sizeof(m_tail));
+
+	if (!s_fftInited)
+		fftInit();
+}
+
+
+bool AudioEffectConvolution::allocate(u32 num_partitions)
+{
+	if (m_pIR)
+		free(m_pIR);
+	if (m_pFDL)
+		free(m_pFDL);
+	u32 bytes = num_partitions * 2 * CONV_BINS * sizeof(float);
+	m_pIR = (float *) malloc(bytes);
+	m_pFDL = (float *) malloc(bytes);
+	if (!m_pIR || !m_pFDL)
+	{
+		LOG_ERROR("could not allocate %d partitions (2 x %d bytes)",num_partitions,bytes);
+		return false;
+	}
+	memset(m_pFDL,0,bytes);
+	return true;
+}
+
+
+bool AudioEffectConvolution::loadImpulse(const char *filename)
+{
+	// stop the update() and wait for it to get out, then take
+	// back an unclaimed tail and wait for one that is running,
+	// as allocate() frees the spectra they use
+
+	m_ready = 0;
+	DataMemBarrier();
+	while (m_inUpdate) {}
+	u8 state = CONV_TAIL_PENDING;
+	__atomic_compare_exchange_n(&m_tailState, &state, CONV_TAIL_IDLE,
+		false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	while (m_tailState == CONV_TAIL_BUSY) {}
+	DataMemBarrier();
+	m_numPartitions = 0;
+
+	FIL file;
+	if (FR_OK != f_open(&file, filename, FA_READ | FA_OPEN_EXISTING))
+	{
+		LOG_ERROR("Could not open %s",filename);
+		return false;
+	}
+
+	// walk the riff chunks for the format and the data
+
+	u8  hdr[12];
+	u32 got;
+	if (FR_OK != f_read(&file, hdr, 12, &got) || got != 12 ||
+		memcmp(hdr,"RIFF",4) || memcmp(&hdr[8],"WAVE",4))
+	{
+		f_close(&file);
+		LOG_ERROR("%s is not a WAV file",filename);
+		return false;
+	}
+
+	u16 format = 0;
+	u16 channels = 0;
+	u32 rate = 0;
+	u16 bits = 0;
+	u32 data_bytes = 0;
+
+	while (1)
+	{
+		u8 chunk[8];
+		if (FR_OK != f_read(&file, chunk, 8, &got) || got != 8)
+			break;
+		u32 len = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | (chunk[7] << 24);
+		if (!memcmp(chunk,"fmt ",4))
+		{
+			u8 fmt[16];
+			if (len < 16 || FR_OK != f_read(&file, fmt, 16, &got) || got != 16)
+				break;
+			format   = fmt[0] | (fmt[1] << 8);
+			channels = fmt[2] | (fmt[3] << 8);
+			rate     = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | (fmt[7] << 24);
+			bits     = fmt[14] | (fmt[15] << 8);
+			f_lseek(&file, f_tell(&file) + len - 16 + (len & 1));
+		}
+		else if (!memcmp(chunk,"data",4))
+		{
+			data_bytes = len;
+			break;
+		}
+		else
+		{
+			f_lseek(&file, f_tell(&file) + len + (len & 1));
+		}
+	}
+
+	bool is_pcm16 = format == 1 && bits == 16;
+	bool is_float = format == 3 && bits == 32;
+	if (!data_bytes || !channels || channels > 2 || (!is_pcm16 && !is_float))
+	{
+		f_close(&file);
+		LOG_ERROR("%s unsupported WAV format(%d) bits(%d) channels(%d)",filename,format,bits,channels);
+		return false;
+	}
+	if (rate != AUDIO_SAMPLE_RATE)
+		LOG_WARNING("%s sample rate %d is not %d",filename,rate,AUDIO_SAMPLE_RATE);
+
+	u32 frame_bytes = channels * bits / 8;
+	u32 frames = data_bytes / frame_bytes;
+	u32 num_partitions = (frames + CONV_PARTITION - 1) / CONV_PARTITION;
+	if (num_partitions > m_maxPartitions)
+	{
+		LOG_WARNING("%s truncated from %d to %d partitions",filename,num_partitions,m_maxPartitions);
+		num_partitions = m_maxPartitions;
+	}
+	if (!allocate(num_partitions))
+	{
+		f_close(&file);
+		return false;
+	}
+
+	// read a partition of frames at a time, zero padded to the
+	// fft size, and keep its spectrum
+
+	u8 raw[CONV_PARTITION * 8];
+	u32 frames_per_read = sizeof(raw) / frame_bytes;
+	for (u32 p=0; p<num_partitions; p++)
+	{
+		float *x = m_work;
+		memset(x,0,sizeof(m_work));
+		u32 n = 0;
+		while (n < CONV_PARTITION && frames)
+		{
+			u32 want = CONV_PARTITION - n;
+			if (want > frames_per_read) want = frames_per_read;
+			if (want > frames) want = frames;
+			if (FR_OK != f_read(&file, raw, want * frame_bytes, &got) || got != want * frame_bytes)
+			{
+				frames = 0;
+				break;
+			}
+			for (u32 i=0; i<want; i++)
+			{
+				const u8 *f = &raw[i * frame_bytes];
+				if (is_pcm16)
+					x[n++] = ((s16) (f[0] | (f[1] << 8))) / 32768.0;
+				else
+				{
+					float v;
+					memcpy(&v, f, sizeof(float));
+					x[n++] = v;
+				}
+			}
+			frames -= want;
+		}
+		rfft(x, &m_pIR[p * 2 * CONV_BINS]);
+	}
+	f_close(&file);
+
+	LOG("loaded %s %d partitions",filename,num_partitions);
+
+	memset(m_input,0,sizeof(m_input));
+	memset(m_tail,0,sizeof(m_tail));
+	m_fdlPos = 0;
+	m_tailDoneGen = m_tailGen;
+		// the zeroed tail is good for the first block
+	m_numPartitions = num_partitions;
+	DataMemBarrier();
+	m_ready = 1;
+	return true;
+}
+
+
+void AudioEffectConvolution::processTail()
+	// Sum the contributions of partitions 1..n-1 for the next block,
+	// from the slot update() armed it with.  It is only published if
+	// update() has not moved on to another block in the meantime.
+{
+	u8 state = CONV_TAIL_PENDING;
+	if (!__atomic_compare_exchange_n(&m_tailState, &state, CONV_TAIL_BUSY,
+			false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		return;
+
+	u32 gen = m_tailArmGen;
+	u32 slot = m_tailSlot;
+	u32 num = m_tailNum;
+	u32 wrap = m_tailWrap;
+
+	memset(m_tail,0,sizeof(m_tail));
+	for (u32 p=1; p<num; p++)
+	{
+		slot = slot ? slot - 1 : wrap - 1;
+		cmac(m_tail, &m_pIR[p * 2 * CONV_BINS], &m_pFDL[slot * 2 * CONV_BINS]);
+	}
+
+	DataMemBarrier();
+	if (m_tailGen == gen)
+		m_tailDoneGen = gen;
+	__atomic_store_n(&m_tailState, CONV_TAIL_IDLE, __ATOMIC_RELEASE);
+}
+
+
+void AudioEffectConvolution::update(void)
+{
+	audio_block_t *in = receiveReadOnly(0);
+	m_inUpdate = 1;
+	DataMemBarrier();
+	if (!m_ready)
+	{
+		m_inUpdate = 0;
+		if (in)
+			AudioSystem::release(in);
+		return;
+	}
+
+	// slide the input window and transform it into the FDL
+
+	memcpy(m_input, &m_input[CONV_PARTITION], CONV_PARTITION * sizeof(float));
+	float *x = &m_input[CONV_PARTITION];
+	if (in)
+	{
+		for (u16 i=0; i<CONV_PARTITION; i++)
+			x[i] = in->data[i] * (1.0 / 32768.0);
+		AudioSystem::release(in);
+	}
+	else
+		memset(x, 0, CONV_PARTITION * sizeof(float));
+
+	float *X = &m_pFDL[m_fdlPos * 2 * CONV_BINS];
+	rfft(m_input, X);
+
+	// head partition on top of the precomputed tail
+
+	if (__atomic_load_n(&m_tailState, __ATOMIC_ACQUIRE) != CONV_TAIL_BUSY &&
+		m_tailDoneGen == m_tailGen)
+		memcpy(m_acc, m_tail, sizeof(m_acc));
+	else
+	{
+		m_tailLate++;
+		memset(m_acc, 0, sizeof(m_acc));
+	}
+	cmac(m_acc, m_pIR, X);
+	irfft(m_acc, m_work);
+
+	// overlap-save keeps the second half
+
+	audio_block_t *out = AudioSystem::allocate();
+	if (out)
+	{
+		float scale = m_gain * 32768.0;
+		const float *y = &m_work[CONV_PARTITION];
+		for (u16 i=0; i<CONV_PARTITION; i++)
+		{
+			s32 v = (s32) (y[i] * scale);
+			if (v > 32767) v = 32767;
+			if (v < -32768) v = -32768;
+			out->data[i] = v;
+		}
+		transmit(out);
+		AudioSystem::release(out);
+	}
+
+	if (++m_fdlPos >= m_numPartitions)
+		m_fdlPos = 0;
+
+	// arm the tail for the next block, taking back one that was
+	// never claimed.  If a late one is still busy this block goes
+	// without, and the late one is not used as its generation is old.
+
+	m_tailGen++;
+	u8 state = CONV_TAIL_PENDING;
+	__atomic_compare_exchange_n(&m_tailState, &state, CONV_TAIL_IDLE,
+		false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	if (state != CONV_TAIL_BUSY)
+	{
+		m_tailArmGen = m_tailGen;
+		m_tailSlot = m_fdlPos;
+		m_tailWrap = m_numPartitions;
+		m_tailNum = m_degraded ?
+			(m_numPartitions + CONV_DEGRADED_DIVISOR - 1) / CONV_DEGRADED_DIVISOR :
+			m_numPartitions;
+		__atomic_store_n(&m_tailState, CONV_TAIL_PENDING, __ATOMIC_RELEASE);
+		if (!m_externalTail)
+			processTail();
+	}
+
+	m_inUpdate = 0;
+}
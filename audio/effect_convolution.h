@@ -0,0 +1,107 @@
+#ifndef effect_convolution_h_
+#define effect_convolution_h_
+
+#include "Arduino.h"
+#include "AudioStream.h"
+
+// Convolution reverb.
+//
+// Uniformly partitioned overlap-save FFT convolution with a frequency
+// domain delay line (FDL).  The impulse response is cut into
+// AUDIO_BLOCK_SAMPLES partitions, each of which is transformed once
+// at load time.  Every update() does one 256 point real FFT of the
+// last two input blocks, one complex multiply-accumulate per partition
+// and one inverse FFT, so there is no added latency.
+//
+// The "tail" (every partition but the first) only depends on past
+// input, so it is computed after the output has been transmitted,
+// ready for the next block.  By default that happens at the end of
+// update().  With setExternalTail(true) it is left for the client to
+// call processTail() from a spare core; if the tail is not ready in
+// time the block is output without it and getTailLate() counts it.
+//
+// The hand off is a tail state (idle, pending, busy) changed with
+// atomic compare-exchange, plus generation numbers.  update() arms a
+// tail with the slot and partition count to use, but never while a
+// late one is still busy, and only uses a tail whose generation is
+// the one it armed for this block.
+//
+// The impulse response is loaded from a mono or stereo (first channel
+// used) 16 bit PCM or 32 bit float WAV file.  At 44.1khz a 2 second
+// response is 690 partitions and about 1.4MB of spectra.
+//
+// The degraded mode, used by the overload governor, only sums the
+// first 1/CONV_DEGRADED_DIVISOR of the partitions, truncating the
+// response to a quarter of its length.
+
+#define CONV_PARTITION          AUDIO_BLOCK_SAMPLES
+#define CONV_FFT_SIZE           (2 * CONV_PARTITION)    // real points
+#define CONV_BINS               (CONV_FFT_SIZE / 2)     // packed complex bins
+#define CONV_DEGRADED_DIVISOR   4
+
+#define CONV_TAIL_IDLE          0
+#define CONV_TAIL_PENDING       1       // armed by update()
+#define CONV_TAIL_BUSY          2       // claimed by processTail()
+
+
+class AudioEffectConvolution : public AudioStream
+{
+public:
+
+	AudioEffectConvolution(float max_ms = 2000.0);
+
+	virtual const char *getName() 	{ return "convolve"; }
+	virtual u16   getType()  		{ return AUDIO_DEVICE_EFFECT; }
+
+	bool loadImpulse(const char *filename);
+		// may be called while running; output stops until it is loaded
+	void setGain(float gain)		{ m_gain = gain; }
+
+	void setExternalTail(bool external)		{ m_externalTail = external; }
+	void processTail();
+
+	u32  getNumPartitions()			{ return m_numPartitions; }
+	u32  getTailLate()				{ return m_tailLate; }
+
+	virtual bool hasFallback()		{ return true; }
+
+private:
+
+	static u16 s_nextInstance;
+
+	audio_block_t *inputQueueArray[1];
+
+	u32      m_maxPartitions;
+	u32      m_numPartitions;
+	float    m_gain;
+
+	float   *m_pIR;             // spectra, m_numPartitions * CONV_BINS complex
+	float   *m_pFDL;            // spectra of past input, same size
+	u32      m_fdlPos;
+
+	float    m_input[CONV_FFT_SIZE];
+	float    m_work[CONV_FFT_SIZE];
+	float    m_acc[2 * CONV_BINS];
+	float    m_tail[2 * CONV_BINS];
+
+	volatile bool m_ready;
+	volatile bool m_inUpdate;
+	volatile u8   m_tailState;      // CONV_TAIL_IDLE, PENDING or BUSY
+	volatile u32  m_tailGen;        // bumped for every block
+	u32      m_tailArmGen;          // the generation, slot and number of
+	u32      m_tailSlot;            // partitions for the armed tail, only
+	u32      m_tailNum;             // written while it is not busy
+	u32      m_tailWrap;
+	volatile u32 m_tailDoneGen;     // of the tail in m_tail
+	bool     m_externalTail;
+	u32      m_tailLate;
+	volatile bool m_degraded;
+
+	bool allocate(u32 num_partitions);
+	virtual void setDegraded(bool degraded)	{ m_degraded = degraded; }
+	virtual void update(void);
+
+};
+
+
+#endif	// !effect_convolution_h_
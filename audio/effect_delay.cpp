@@ -0,0 +1,169 @@
+#include "effect_delay.h"
+#include "utility/dspinst.h"
+#include <circle/logger.h>
+
+
+#define log_name "delay"
+
+#define FEEDBACK_UNITY      65536
+
+u16 AudioEffectDelay::s_nextInstance = 0;
+
+
+AudioEffectDelay::AudioEffectDelay(float max_ms) :
+	AudioStream(1,AUDIO_DELAY_TAPS,inputQueueArray)
+{
+	m_instance = s_nextInstance++;
+
+	// one extra block so that the longest tap never
+	// reads the block that is being written
+
+	u32 samples = (u32) (max_ms * (AUDIO_SAMPLE_RATE / 1000.0));
+	m_lineBlocks  = (samples + AUDIO_BLOCK_SAMPLES - 1) / AUDIO_BLOCK_SAMPLES + 1;
+	m_lineSamples = m_lineBlocks * AUDIO_BLOCK_SAMPLES;
+	m_line        = 0;
+	m_writeBlock  = 0;
+	m_frozen      = 0;
+	m_activeMask  = 0;
+
+	for (u8 i=0; i<AUDIO_DELAY_TAPS; i++)
+	{
+		m_tapDelay[i] = 0;
+		m_tapFeedback[i] = 0;
+	}
+}
+
+
+void AudioEffectDelay::start()
+{
+	if (!m_line)
+		m_line = AudioSystem::allocateDelayLine(m_lineBlocks);
+	if (!m_line)
+		LOG_ERROR("%s%d could not get %d delay blocks",getName(),getInstance(),m_lineBlocks);
+}
+
+
+void AudioEffectDelay::setDelay(u8 tap, float milliseconds)
+{
+	if (tap >= AUDIO_DELAY_TAPS)
+		return;
+	if (milliseconds < 0.0)
+		milliseconds = 0.0;
+	u32 samples = (u32) (milliseconds * (AUDIO_SAMPLE_RATE / 1000.0) + 0.5);
+	if (samples > m_lineSamples - AUDIO_BLOCK_SAMPLES)
+		samples = m_lineSamples - AUDIO_BLOCK_SAMPLES;
+	m_tapDelay[tap] = samples;
+	m_activeMask |= (1 << tap);
+}
+
+
+void AudioEffectDelay::disableTap(u8 tap)
+{
+	if (tap >= AUDIO_DELAY_TAPS)
+		return;
+	m_activeMask &= ~(1 << tap);
+}
+
+
+void AudioEffectDelay::setFeedback(u8 tap, float gain)
+{
+	if (tap >= AUDIO_DELAY_TAPS)
+		return;
+	if (gain < 0.0)
+		gain = 0.0;
+	else if (gain > 1.0)
+		gain = 1.0;
+	m_tapFeedback[tap] = gain * FEEDBACK_UNITY;
+}
+
+
+void AudioEffectDelay::readTap(u8 tap, int16_t *dest)
+	// The newest block in the line is m_writeBlock.  The tap reads
+	// the AUDIO_BLOCK_SAMPLES ending m_tapDelay samples before the
+	// end of it, which is at most two contiguous pieces.
+{
+	u32 start = m_writeBlock * AUDIO_BLOCK_SAMPLES + m_lineSamples - m_tapDelay[tap];
+	if (start >= m_lineSamples)
+		start -= m_lineSamples;
+	u32 first = m_lineSamples - start;
+	if (first > AUDIO_BLOCK_SAMPLES)
+		first = AUDIO_BLOCK_SAMPLES;
+	memcpy(dest, &m_line[start], first * sizeof(int16_t));
+	if (first < AUDIO_BLOCK_SAMPLES)
+		memcpy(dest + first, m_line, (AUDIO_BLOCK_SAMPLES - first) * sizeof(int16_t));
+}
+
+
+void AudioEffectDelay::update(void)
+{
+	audio_block_t *in = receiveReadOnly(0);
+	if (!m_line)
+	{
+		if (in)
+			AudioSystem::release(in);
+		return;
+	}
+
+	// write the input (or silence) into the newest block
+
+	if (++m_writeBlock >= m_lineBlocks)
+		m_writeBlock = 0;
+	int16_t *cur = &m_line[m_writeBlock * AUDIO_BLOCK_SAMPLES];
+
+	if (!m_frozen)
+	{
+		if (in)
+			memcpy(cur, in->data, AUDIO_BLOCK_BYTES);
+		else
+			memset(cur, 0, AUDIO_BLOCK_BYTES);
+	}
+	else
+	{
+		// the looper recirculates only what is fed back
+		memset(cur, 0, AUDIO_BLOCK_BYTES);
+	}
+	if (in)
+		AudioSystem::release(in);
+
+	// read and transmit the taps, accumulating feedback into a
+	// separate buffer so that later taps still see the original
+
+	int32_t fb[AUDIO_BLOCK_SAMPLES];
+	int16_t spare[AUDIO_BLOCK_SAMPLES];
+	bool any_feedback = false;
+
+	for (u8 tap=0; tap<AUDIO_DELAY_TAPS; tap++)
+	{
+		if (!(m_activeMask & (1 << tap)))
+			continue;
+
+		// if we are out of blocks the tap is not transmitted,
+		// but it still has to be read for its feedback
+
+		audio_block_t *out = AudioSystem::allocate();
+		int16_t *data = out ? out->data : spare;
+		readTap(tap, data);
+
+		int32_t mult = m_tapFeedback[tap];
+		if (mult)
+		{
+			if (!any_feedback)
+				memset(fb, 0, sizeof(fb));
+			any_feedback = true;
+			for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+				fb[i] += (data[i] * mult) >> 16;
+		}
+
+		if (out)
+		{
+			transmit(out, tap);
+			AudioSystem::release(out);
+		}
+	}
+
+	if (any_feedback)
+	{
+		for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+			cur[i] = signed_saturate_rshift(cur[i] + fb[i], 16, 0);
+	}
+}
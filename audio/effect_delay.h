@@ -0,0 +1,67 @@
+#ifndef effect_delay_h_
+#define effect_delay_h_
+
+#include "Arduino.h"
+#include "AudioStream.h"
+
+// Multi-tap delay with per-tap feedback.
+//
+// The delay line is carved out of the AudioSystem delay arena in
+// start(), so AudioSystem::initialize() must be given enough
+// num_delay_blocks for all of the delays in the graph.  The line
+// is a whole number of blocks long and each update() writes one
+// whole block, so every tap read is at most two straight copies.
+//
+// Each tap can feed back into the line.  Feedback is summed into
+// the block written on this update, so a tap shorter than one block
+// recirculates with a period of one block.
+//
+// freeze() stops writing the input into the line.  Together with a
+// feedback of 1.0 on a tap, that turns the delay into a looper of
+// the tap's length.
+
+#define AUDIO_DELAY_TAPS        8
+
+
+class AudioEffectDelay : public AudioStream
+{
+public:
+
+	AudioEffectDelay(float max_ms = 1000.0);
+
+	virtual const char *getName() 	{ return "delay"; }
+	virtual u16   getType()  		{ return AUDIO_DEVICE_EFFECT; }
+
+	virtual void start();
+
+	void setDelay(u8 tap, float milliseconds);
+	void disableTap(u8 tap);
+	void setFeedback(u8 tap, float gain);
+	void freeze(bool frozen)		{ m_frozen = frozen; }
+
+	bool isFrozen()					{ return m_frozen; }
+	u32  getLineBlocks()			{ return m_lineBlocks; }
+
+private:
+
+	static u16 s_nextInstance;
+
+	audio_block_t *inputQueueArray[1];
+
+	int16_t *m_line;
+	u32      m_lineBlocks;
+	u32      m_lineSamples;
+	u32      m_writeBlock;
+	bool     m_frozen;
+
+	u8       m_activeMask;
+	u32      m_tapDelay[AUDIO_DELAY_TAPS];		// samples
+	int32_t  m_tapFeedback[AUDIO_DELAY_TAPS];	// 65536 == 1.0
+
+	void readTap(u8 tap, int16_t *dest);
+	virtual void update(void);
+
+};
+
+
+#endif	// !effect_delay_h_
@@ -0,0 +1,279 @@
+#include "effect_dynamics.h"
+#include <math.h>
+
+#ifdef __ARM_NEON
+	#include <arm_neon.h>
+#endif
+
+
+#define RING_MASK       (DYNAMICS_RING - 1)
+#define TARGET_MASK     (DYNAMICS_TARGETS - 1)
+
+u16 AudioEffectDynamics::s_nextInstance = 0;
+
+
+AudioEffectDynamics::AudioEffectDynamics() :
+	AudioStream(DYNAMICS_CHANNELS,DYNAMICS_CHANNELS,inputQueueArray)
+{
+	m_instance = s_nextInstance++;
+
+	m_mode      = DYNAMICS_LIMITER;
+	m_detectRMS = 0;
+	m_threshold = dbToGain(-20.0);
+	m_ratio     = 4.0;
+	m_ceiling   = dbToGain(-0.3);
+	m_makeup    = 1.0;
+	m_range     = dbToGain(-80.0);
+	m_envelope  = 0.0;
+	m_gain      = 1.0;
+	m_subblock  = 0;
+	m_writePos  = 0;
+
+	setAttack(1.0);
+	setRelease(100.0);
+	setLookahead(2.0);
+
+	for (u16 i=0; i<DYNAMICS_TARGETS; i++)
+		m_target[i] = 1.0;
+	memset(m_ring,0,sizeof(m_ring));
+}
+
+
+float AudioEffectDynamics::dbToGain(float db)
+{
+	return powf(10.0, db / 20.0);
+}
+
+
+static float timeToCoef(float ms)
+	// one pole coefficient per sub-block for a time constant in ms
+{
+	if (ms <= 0.0)
+		return 1.0;
+	return 1.0 - expf(-DYNAMICS_SUBBLOCK / (ms * (AUDIO_SAMPLE_RATE / 1000.0)));
+}
+
+
+void AudioEffectDynamics::setAttack(float ms)
+{
+	m_attack = timeToCoef(ms);
+}
+
+
+void AudioEffectDynamics::setRelease(float ms)
+{
+	m_release = timeToCoef(ms);
+}
+
+
+void AudioEffectDynamics::setLookahead(float ms)
+{
+	s32 n = (s32) (ms * (AUDIO_SAMPLE_RATE / 1000.0) / DYNAMICS_SUBBLOCK + 0.5);
+	if (n < 0) n = 0;
+	if (n > DYNAMICS_MAX_LOOKAHEAD) n = DYNAMICS_MAX_LOOKAHEAD;
+	m_lookahead = n;
+}
+
+
+//------------------------------------------
+// detector
+//------------------------------------------
+
+static void detect(const int16_t *x, s32 *peak, s64 *sum_squares)
+	// one DYNAMICS_SUBBLOCK (16) samples of one channel
+{
+	#ifdef __ARM_NEON
+		int16x8_t a = vld1q_s16(x);
+		int16x8_t b = vld1q_s16(x + 8);
+		// the max and min are reduced separately and the min is
+		// negated in s32, as vqabsq_s16 would saturate -32768 to
+		// 32767 and read one lsb low against the scalar path
+
+		int16x8_t hi = vmaxq_s16(a, b);
+		int16x8_t lo = vminq_s16(a, b);
+		int16x4_t hi4 = vmax_s16(vget_low_s16(hi), vget_high_s16(hi));
+		int16x4_t lo4 = vmin_s16(vget_low_s16(lo), vget_high_s16(lo));
+		hi4 = vpmax_s16(hi4, hi4);
+		hi4 = vpmax_s16(hi4, hi4);
+		lo4 = vpmin_s16(lo4, lo4);
+		lo4 = vpmin_s16(lo4, lo4);
+		s32 p = vget_lane_s16(hi4, 0);
+		s32 n = -((s32) vget_lane_s16(lo4, 0));
+		if (n > p)
+			p = n;
+		if (p > *peak)
+			*peak = p;
+
+		int64x2_t acc = vdupq_n_s64(0);
+		acc = vpadalq_s32(acc, vmull_s16(vget_low_s16(a), vget_low_s16(a)));
+		acc = vpadalq_s32(acc, vmull_s16(vget_high_s16(a), vget_high_s16(a)));
+		acc = vpadalq_s32(acc, vmull_s16(vget_low_s16(b), vget_low_s16(b)));
+		acc = vpadalq_s32(acc, vmull_s16(vget_high_s16(b), vget_high_s16(b)));
+		*sum_squares += vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1);
+	#else
+		s32 p = *peak;
+		s64 sum = 0;
+		for (u16 i=0; i<DYNAMICS_SUBBLOCK; i++)
+		{
+			s32 v = x[i];
+			sum += v * v;
+			if (v < 0) v = -v;
+			if (v > p) p = v;
+		}
+		*peak = p;
+		*sum_squares += sum;
+	#endif
+}
+
+
+float AudioEffectDynamics::computeTarget(float peak, float mean_square)
+	// the gain wanted for one sub-block, before makeup
+{
+	if (m_mode == DYNAMICS_LIMITER)
+	{
+		float need = peak * m_makeup;
+		return need > m_ceiling ? m_ceiling / need : 1.0;
+	}
+
+	float level = m_detectRMS ? sqrtf(mean_square) : peak;
+	float coef = level > m_envelope ? m_attack : m_release;
+	m_envelope += (level - m_envelope) * coef;
+
+	if (m_mode == DYNAMICS_GATE)
+		return m_envelope < m_threshold ? m_range : 1.0;
+
+	if (m_envelope <= m_threshold)
+		return 1.0;
+	return powf(m_envelope / m_threshold, 1.0 / m_ratio - 1.0);
+}
+
+
+float AudioEffectDynamics::boundaryGain(u32 k)
+	// The gain at the start of sub-block k.  Each target from k-1 to
+	// k+lookahead pulls it down, linearly less the further ahead it
+	// is, so reductions ramp in over the look-ahead.  Targets k-1 and
+	// k (the sub-blocks on either side of the boundary) count fully.
+	// Increases are then slowed by the release.
+{
+	u32 span = m_lookahead + 1;
+	float want = 1.0;
+	for (u32 m=k-1; m!=k+span; m++)
+	{
+		float t = m_target[m & TARGET_MASK];
+		u32 d = (m > k && m - k < span) ? m - k : 0;
+		float r = t + (1.0 - t) * d / span;
+		if (r < want)
+			want = r;
+	}
+	if (want < m_gain)
+		return want;
+	return m_gain + (want - m_gain) * m_release;
+}
+
+
+//------------------------------------------
+// update
+//------------------------------------------
+
+void AudioEffectDynamics::update(void)
+{
+	audio_block_t *in[DYNAMICS_CHANNELS];
+	audio_block_t *out[DYNAMICS_CHANNELS];
+	u8 present = 0;
+
+	// write the inputs into the delay ring
+
+	u32 base = (m_subblock * DYNAMICS_SUBBLOCK) & RING_MASK;
+	for (u8 ch=0; ch<DYNAMICS_CHANNELS; ch++)
+	{
+		in[ch] = receiveReadOnly(ch);
+		out[ch] = 0;
+		if (in[ch])
+		{
+			present |= 1 << ch;
+			memcpy(&m_ring[ch][base], in[ch]->data, AUDIO_BLOCK_BYTES);
+			AudioSystem::release(in[ch]);
+		}
+		else
+			memset(&m_ring[ch][base], 0, AUDIO_BLOCK_BYTES);
+	}
+
+	// With no input at all the sub-blocks still advance and the
+	// gain keeps tracking, so that the tail of the audio before a
+	// gap drains out of the ring, but no output is produced.
+
+	for (u8 ch=0; ch<DYNAMICS_CHANNELS; ch++)
+	{
+		if (present & (1 << ch))
+			out[ch] = AudioSystem::allocate();
+	}
+
+	for (u16 j=0; j<DYNAMICS_SUBBLOCKS; j++)
+	{
+		// detect the newest sub-block, linked across the channels
+
+		u32 pos = (m_subblock * DYNAMICS_SUBBLOCK) & RING_MASK;
+		s32 peak = 0;
+		s64 sum_squares = 0;
+		u8 num = 0;
+		for (u8 ch=0; ch<DYNAMICS_CHANNELS; ch++)
+		{
+			if (present & (1 << ch))
+			{
+				detect(&m_ring[ch][pos], &peak, &sum_squares);
+				num++;
+			}
+		}
+		float mean_square = !num ? 0.0 : ((float) sum_squares) /
+			(num * DYNAMICS_SUBBLOCK * 32768.0 * 32768.0);
+		m_target[m_subblock & TARGET_MASK] = computeTarget(peak / 32768.0, mean_square);
+
+		// apply the interpolated gain to the sub-block that is now
+		// lookahead+1 behind, which is the newest whose end boundary
+		// has all of its look-ahead targets
+
+		u32 k = m_subblock - m_lookahead - 1;
+		float g0 = m_gain;
+		float g1 = boundaryGain(k + 1);
+		m_gain = g1;
+		m_subblock++;
+
+		float gain[DYNAMICS_SUBBLOCK];
+		float step = (g1 - g0) / DYNAMICS_SUBBLOCK;
+		for (u16 i=0; i<DYNAMICS_SUBBLOCK; i++)
+		{
+			// never above either end, so float rounding of the
+			// ramp cannot poke past the ceiling
+			float g = g0 + step * i;
+			if (g > g0 && g > g1)
+				g = g0 > g1 ? g0 : g1;
+			gain[i] = g * m_makeup;
+		}
+
+		u32 src = (k * DYNAMICS_SUBBLOCK) & RING_MASK;
+		for (u8 ch=0; ch<DYNAMICS_CHANNELS; ch++)
+		{
+			if (!out[ch])
+				continue;
+			const int16_t *x = &m_ring[ch][src];
+			int16_t *y = &out[ch]->data[j * DYNAMICS_SUBBLOCK];
+			for (u16 i=0; i<DYNAMICS_SUBBLOCK; i++)
+			{
+				// truncation toward zero keeps |y| <= ceiling
+				s32 v = (s32) (x[i] * gain[i]);
+				if (v > 32767) v = 32767;
+				if (v < -32768) v = -32768;
+				y[i] = v;
+			}
+		}
+	}
+
+	for (u8 ch=0; ch<DYNAMICS_CHANNELS; ch++)
+	{
+		if (out[ch])
+		{
+			transmit(out[ch], ch);
+			AudioSystem::release(out[ch]);
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef effect_dynamics_h_
+#define effect_dynamics_h_
+
+#include "Arduino.h"
+#include "AudioStream.h"
+
+// Look-ahead compressor / limiter / gate.
+//
+// All connected channels are linked: one gain, derived from the
+// loudest channel, is applied to all of them, so the stereo image
+// (or the TDM bus balance) does not shift.
+//
+// The detector runs over sub-blocks of DYNAMICS_SUBBLOCK samples,
+// taking the peak and the mean square of every channel in one pass.
+// A gain target is computed per sub-block at that control rate, and
+// the applied gain is interpolated per sample between sub-block
+// boundaries.
+//
+// The audio is delayed by the look-ahead (plus one sub-block) so that
+// gain reductions can ramp down before the peak arrives.  In limiter
+// mode the gain at both ends of a sub-block is never above what that
+// sub-block's peak requires, so no output sample exceeds the ceiling.
+
+#define DYNAMICS_CHANNELS           8
+#define DYNAMICS_SUBBLOCK           16
+#define DYNAMICS_SUBBLOCKS          (AUDIO_BLOCK_SAMPLES / DYNAMICS_SUBBLOCK)
+#define DYNAMICS_MAX_LOOKAHEAD      32      // sub-blocks, about 11.6ms
+#define DYNAMICS_RING               1024    // samples per channel, power of 2
+#define DYNAMICS_TARGETS            64      // target history, power of 2
+
+#define DYNAMICS_COMPRESSOR         0
+#define DYNAMICS_LIMITER            1
+#define DYNAMICS_GATE               2
+
+
+class AudioEffectDynamics : public AudioStream
+{
+public:
+
+	AudioEffectDynamics();
+
+	virtual const char *getName() 	{ return "dynamics"; }
+	virtual u16   getType()  		{ return AUDIO_DEVICE_EFFECT; }
+
+	void setMode(u8 mode)				{ m_mode = mode; }
+	void setDetectRMS(bool rms)			{ m_detectRMS = rms; }
+	void setThreshold(float db)			{ m_threshold = dbToGain(db); }
+	void setRatio(float ratio)			{ m_ratio = ratio < 1.0 ? 1.0 : ratio; }
+	void setCeiling(float db)			{ m_ceiling = dbToGain(db); }
+	void setMakeup(float db)			{ m_makeup = dbToGain(db); }
+	void setRange(float db)				{ m_range = dbToGain(db); }
+	void setAttack(float ms);
+	void setRelease(float ms);
+	void setLookahead(float ms);
+
+	float getGain()						{ return m_gain; }
+		// the gain currently being applied, before makeup
+
+private:
+
+	static u16 s_nextInstance;
+	static float dbToGain(float db);
+
+	audio_block_t *inputQueueArray[DYNAMICS_CHANNELS];
+
+	u8    m_mode;
+	bool  m_detectRMS;
+	float m_threshold;
+	float m_ratio;
+	float m_ceiling;
+	float m_makeup;
+	float m_range;
+	float m_attack;         // per sub-block coefficients
+	float m_release;
+	u16   m_lookahead;      // sub-blocks
+
+	float m_envelope;
+	float m_gain;
+
+	u32   m_subblock;       // count of sub-blocks received
+	float m_target[DYNAMICS_TARGETS];
+
+	u32     m_writePos;
+	int16_t m_ring[DYNAMICS_CHANNELS][DYNAMICS_RING];
+
+	float computeTarget(float peak, float mean_square);
+	float boundaryGain(u32 k);
+	virtual void update(void);
+
+};
+
+
+#endif	// !effect_dynamics_h_
@@ -40,6 +40,7 @@ AudioEffectFreeverb::AudioEffectFreeverb() :
 	AudioStream(1, 1, inputQueueArray)
 {
     m_instance = s_nextInstance++;
+	m_priority = AUDIO_PRIORITY_LOW;
 	
 	memset(comb1buf, 0, sizeof(comb1buf));
 	memset(comb2buf, 0, sizeof(comb2buf));
@@ -97,33 +98,11 @@ static int16_t sat16(int32_t n, int rshift)
 
 // TODO: move this to one of the data files, use in output_adat.cpp, output_tdm.cpp, etc
 
+static int16_t zerodata[AUDIO_BLOCK_SAMPLES] __attribute__ ((aligned (AUDIO_BLOCK_ALIGN)));
+
 static const audio_block_t zeroblock =
 {
-	0, 0, 0,
-	{
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		#if AUDIO_BLOCK_SAMPLES > 16
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		#endif
-		#if AUDIO_BLOCK_SAMPLES > 32
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		#endif
-		#if AUDIO_BLOCK_SAMPLES > 48
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		#endif
-		#if AUDIO_BLOCK_SAMPLES > 64
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		#endif
-		#if AUDIO_BLOCK_SAMPLES > 80
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		#endif
-		#if AUDIO_BLOCK_SAMPLES > 96
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		#endif
-		#if AUDIO_BLOCK_SAMPLES > 112
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		#endif
-	}
+	0, AUDIO_BLOCK_CLASS_16, 1, AUDIO_BLOCK_NONE, AUDIO_BLOCK_NONE, zerodata
 };
 
 
@@ -260,6 +239,7 @@ AudioEffectFreeverbStereo::AudioEffectFreeverbStereo() :
 	AudioStream(1, 2, inputQueueArray)
 {
     m_instance = s_nextInstance++;
+	m_priority = AUDIO_PRIORITY_LOW;
 	
 	memset(comb1bufL, 0, sizeof(comb1bufL));
 	memset(comb2bufL, 0, sizeof(comb2bufL));
@@ -62,6 +62,7 @@ public:
     AudioEffectReverb(void) : AudioStream(1,1,inputQueueArray)
     {
 		m_instance = s_nextInstance++;
+		m_priority = AUDIO_PRIORITY_LOW;
 		init_comb_filters();
 		clear_buffers();
 		reverbTime(5.0);
@@ -0,0 +1,340 @@
+#include "filter_biquad_bank.h"
+#include <math.h>
+
+#ifdef __ARM_NEON
+	#include <arm_neon.h>
+#endif
+
+
+#define TRIPLE_FRESH    0x80
+#define TRIPLE_INDEX    0x03
+
+u16 AudioFilterBiquadBank::s_nextInstance = 0;
+
+
+AudioFilterBiquadBank::AudioFilterBiquadBank() :
+	AudioStream(BIQUAD_BANK_CHANNELS,BIQUAD_BANK_CHANNELS,inputQueueArray)
+{
+	m_instance = s_nextInstance++;
+
+	memset(&m_ctrl,0,sizeof(m_ctrl));
+	for (u8 ch=0; ch<BIQUAD_BANK_CHANNELS; ch++)
+		for (u8 st=0; st<BIQUAD_BANK_STAGES; st++)
+			m_ctrl.coef[st][0][ch] = 1.0f;
+	for (u8 i=0; i<3; i++)
+		memcpy(&m_set[i],&m_ctrl,sizeof(m_ctrl));
+
+	m_back   = 0;
+	m_front  = 1;
+	m_middle = 2;
+
+	memset(m_s1,0,sizeof(m_s1));
+	memset(m_s2,0,sizeof(m_s2));
+}
+
+
+//------------------------------------------
+// control side
+//------------------------------------------
+
+void AudioFilterBiquadBank::publish()
+{
+	memcpy(&m_set[m_back],&m_ctrl,sizeof(m_ctrl));
+	u8 old = __atomic_exchange_n(&m_middle, (u8) (m_back | TRIPLE_FRESH), __ATOMIC_ACQ_REL);
+	m_back = old & TRIPLE_INDEX;
+}
+
+
+void AudioFilterBiquadBank::setStage(u8 channel, u8 stage, const double *coefs)
+{
+	if (channel >= BIQUAD_BANK_CHANNELS || stage >= BIQUAD_BANK_STAGES)
+		return;
+	for (u8 i=0; i<BIQUAD_NUM_COEFS; i++)
+		m_ctrl.coef[stage][i][channel] = coefs[i];
+
+	// skip the trailing stages that are pass-through on every channel
+
+	m_ctrl.num_stages = 0;
+	for (u8 st=0; st<BIQUAD_BANK_STAGES; st++)
+	{
+		for (u8 ch=0; ch<BIQUAD_BANK_CHANNELS; ch++)
+		{
+			float *c = &m_ctrl.coef[st][0][ch];
+			if (c[0] != 1.0f ||
+				c[1*BIQUAD_BANK_CHANNELS] != 0.0f ||
+				c[2*BIQUAD_BANK_CHANNELS] != 0.0f ||
+				c[3*BIQUAD_BANK_CHANNELS] != 0.0f ||
+				c[4*BIQUAD_BANK_CHANNELS] != 0.0f)
+			{
+				m_ctrl.num_stages = st + 1;
+				break;
+			}
+		}
+	}
+
+	publish();
+}
+
+
+void AudioFilterBiquadBank::setCoefficients(u8 channel, u8 stage, const double *coefs)
+{
+	setStage(channel,stage,coefs);
+}
+
+
+void AudioFilterBiquadBank::setPassThru(u8 channel, u8 stage)
+{
+	const double coefs[BIQUAD_NUM_COEFS] = { 1.0, 0.0, 0.0, 0.0, 0.0 };
+	setStage(channel,stage,coefs);
+}
+
+
+// The rest are the usual RBJ cookbook formulas
+
+static void normalize(double *c, double b0, double b1, double b2, double a0, double a1, double a2)
+{
+	c[0] = b0 / a0;
+	c[1] = b1 / a0;
+	c[2] = b2 / a0;
+	c[3] = a1 / a0;
+	c[4] = a2 / a0;
+}
+
+
+void AudioFilterBiquadBank::setLowpass(u8 channel, u8 stage, float frequency, float q)
+{
+	double c[BIQUAD_NUM_COEFS];
+	double w0 = frequency * (2.0 * M_PI / AUDIO_SAMPLE_RATE);
+	double sinW0 = sin(w0);
+	double cosW0 = cos(w0);
+	double alpha = sinW0 / ((double) q * 2.0);
+	normalize(c,
+		(1.0 - cosW0) / 2.0, 1.0 - cosW0, (1.0 - cosW0) / 2.0,
+		1.0 + alpha, -2.0 * cosW0, 1.0 - alpha);
+	setStage(channel,stage,c);
+}
+
+
+void AudioFilterBiquadBank::setHighpass(u8 channel, u8 stage, float frequency, float q)
+{
+	double c[BIQUAD_NUM_COEFS];
+	double w0 = frequency * (2.0 * M_PI / AUDIO_SAMPLE_RATE);
+	double sinW0 = sin(w0);
+	double cosW0 = cos(w0);
+	double alpha = sinW0 / ((double) q * 2.0);
+	normalize(c,
+		(1.0 + cosW0) / 2.0, -(1.0 + cosW0), (1.0 + cosW0) / 2.0,
+		1.0 + alpha, -2.0 * cosW0, 1.0 - alpha);
+	setStage(channel,stage,c);
+}
+
+
+void AudioFilterBiquadBank::setBandpass(u8 channel, u8 stage, float frequency, float q)
+{
+	double c[BIQUAD_NUM_COEFS];
+	double w0 = frequency * (2.0 * M_PI / AUDIO_SAMPLE_RATE);
+	double sinW0 = sin(w0);
+	double cosW0 = cos(w0);
+	double alpha = sinW0 / ((double) q * 2.0);
+	normalize(c,
+		alpha, 0.0, -alpha,
+		1.0 + alpha, -2.0 * cosW0, 1.0 - alpha);
+	setStage(channel,stage,c);
+}
+
+
+void AudioFilterBiquadBank::setNotch(u8 channel, u8 stage, float frequency, float q)
+{
+	double c[BIQUAD_NUM_COEFS];
+	double w0 = frequency * (2.0 * M_PI / AUDIO_SAMPLE_RATE);
+	double sinW0 = sin(w0);
+	double cosW0 = cos(w0);
+	double alpha = sinW0 / ((double) q * 2.0);
+	normalize(c,
+		1.0, -2.0 * cosW0, 1.0,
+		1.0 + alpha, -2.0 * cosW0, 1.0 - alpha);
+	setStage(channel,stage,c);
+}
+
+
+void AudioFilterBiquadBank::setPeaking(u8 channel, u8 stage, float frequency, float q, float gain_db)
+{
+	double c[BIQUAD_NUM_COEFS];
+	double a = pow(10.0, gain_db / 40.0);
+	double w0 = frequency * (2.0 * M_PI / AUDIO_SAMPLE_RATE);
+	double sinW0 = sin(w0);
+	double cosW0 = cos(w0);
+	double alpha = sinW0 / ((double) q * 2.0);
+	normalize(c,
+		1.0 + alpha * a, -2.0 * cosW0, 1.0 - alpha * a,
+		1.0 + alpha / a, -2.0 * cosW0, 1.0 - alpha / a);
+	setStage(channel,stage,c);
+}
+
+
+void AudioFilterBiquadBank::setLowShelf(u8 channel, u8 stage, float frequency, float gain_db, float slope)
+{
+	double c[BIQUAD_NUM_COEFS];
+	double a = pow(10.0, gain_db / 40.0);
+	double w0 = frequency * (2.0 * M_PI / AUDIO_SAMPLE_RATE);
+	double sinW0 = sin(w0);
+	double cosW0 = cos(w0);
+	double alpha = sinW0 / 2.0 * sqrt((a + 1.0 / a) * (1.0 / slope - 1.0) + 2.0);
+	double s = 2.0 * sqrt(a) * alpha;
+	normalize(c,
+		a * ((a + 1.0) - (a - 1.0) * cosW0 + s),
+		2.0 * a * ((a - 1.0) - (a + 1.0) * cosW0),
+		a * ((a + 1.0) - (a - 1.0) * cosW0 - s),
+		(a + 1.0) + (a - 1.0) * cosW0 + s,
+		-2.0 * ((a - 1.0) + (a + 1.0) * cosW0),
+		(a + 1.0) + (a - 1.0) * cosW0 - s);
+	setStage(channel,stage,c);
+}
+
+
+void AudioFilterBiquadBank::setHighShelf(u8 channel, u8 stage, float frequency, float gain_db, float slope)
+{
+	double c[BIQUAD_NUM_COEFS];
+	double a = pow(10.0, gain_db / 40.0);
+	double w0 = frequency * (2.0 * M_PI / AUDIO_SAMPLE_RATE);
+	double sinW0 = sin(w0);
+	double cosW0 = cos(w0);
+	double alpha = sinW0 / 2.0 * sqrt((a + 1.0 / a) * (1.0 / slope - 1.0) + 2.0);
+	double s = 2.0 * sqrt(a) * alpha;
+	normalize(c,
+		a * ((a + 1.0) + (a - 1.0) * cosW0 + s),
+		-2.0 * a * ((a - 1.0) + (a + 1.0) * cosW0),
+		a * ((a + 1.0) + (a - 1.0) * cosW0 - s),
+		(a + 1.0) - (a - 1.0) * cosW0 + s,
+		2.0 * ((a - 1.0) - (a + 1.0) * cosW0),
+		(a + 1.0) - (a - 1.0) * cosW0 - s);
+	setStage(channel,stage,c);
+}
+
+
+//------------------------------------------
+// update
+//------------------------------------------
+
+static void processStage(
+	float *buf,                 // [AUDIO_BLOCK_SAMPLES][BIQUAD_BANK_CHANNELS]
+	const float *coef,          // [BIQUAD_NUM_COEFS][BIQUAD_BANK_CHANNELS]
+	float *s1,
+	float *s2)
+	// one stage of all the channels over a block, in place,
+	// four lanes at a time
+{
+	for (u8 lane=0; lane<BIQUAD_BANK_CHANNELS; lane+=4)
+	{
+		float *p = buf + lane;
+
+		#ifdef __ARM_NEON
+			float32x4_t b0 = vld1q_f32(coef + 0*BIQUAD_BANK_CHANNELS + lane);
+			float32x4_t b1 = vld1q_f32(coef + 1*BIQUAD_BANK_CHANNELS + lane);
+			float32x4_t b2 = vld1q_f32(coef + 2*BIQUAD_BANK_CHANNELS + lane);
+			float32x4_t a1 = vld1q_f32(coef + 3*BIQUAD_BANK_CHANNELS + lane);
+			float32x4_t a2 = vld1q_f32(coef + 4*BIQUAD_BANK_CHANNELS + lane);
+			float32x4_t z1 = vld1q_f32(s1 + lane);
+			float32x4_t z2 = vld1q_f32(s2 + lane);
+
+			for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+			{
+				float32x4_t x = vld1q_f32(p);
+				float32x4_t y = vmlaq_f32(z1, b0, x);
+				z1 = vmlsq_f32(vmlaq_f32(z2, b1, x), a1, y);
+				z2 = vmlsq_f32(vmulq_f32(b2, x), a2, y);
+				vst1q_f32(p, y);
+				p += BIQUAD_BANK_CHANNELS;
+			}
+
+			vst1q_f32(s1 + lane, z1);
+			vst1q_f32(s2 + lane, z2);
+		#else
+			for (u8 l=lane; l<lane+4; l++)
+			{
+				float b0 = coef[0*BIQUAD_BANK_CHANNELS + l];
+				float b1 = coef[1*BIQUAD_BANK_CHANNELS + l];
+				float b2 = coef[2*BIQUAD_BANK_CHANNELS + l];
+				float a1 = coef[3*BIQUAD_BANK_CHANNELS + l];
+				float a2 = coef[4*BIQUAD_BANK_CHANNELS + l];
+				float z1 = s1[l];
+				float z2 = s2[l];
+				float *q = buf + l;
+				for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+				{
+					float x = *q;
+					float y = b0 * x + z1;
+					z1 = b1 * x - a1 * y + z2;
+					z2 = b2 * x - a2 * y;
+					*q = y;
+					q += BIQUAD_BANK_CHANNELS;
+				}
+				s1[l] = z1;
+				s2[l] = z2;
+			}
+		#endif
+	}
+}
+
+
+void AudioFilterBiquadBank::update(void)
+{
+	// pick up a freshly published coefficient set
+
+	if (m_middle & TRIPLE_FRESH)
+	{
+		u8 old = __atomic_exchange_n(&m_middle, m_front, __ATOMIC_ACQ_REL);
+		m_front = old & TRIPLE_INDEX;
+	}
+	const biquadBankCoefs_t *set = &m_set[m_front];
+
+	// gather the inputs into lanes.  Missing inputs are
+	// filtered as silence so their state rings down.
+
+	audio_block_t *in[BIQUAD_BANK_CHANNELS];
+	u8 present = 0;
+	for (u8 ch=0; ch<BIQUAD_BANK_CHANNELS; ch++)
+	{
+		in[ch] = receiveReadOnly(ch);
+		if (in[ch])
+		{
+			present |= 1 << ch;
+			const int16_t *src = in[ch]->data;
+			for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+				m_buf[i][ch] = src[i] * (1.0f / 32768.0f);
+			AudioSystem::release(in[ch]);
+		}
+		else
+		{
+			for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+				m_buf[i][ch] = 0.0f;
+		}
+	}
+
+	// the stages are run even when every input is missing,
+	// so the state does not freeze and click when input resumes
+
+	for (u8 st=0; st<set->num_stages; st++)
+		processStage(&m_buf[0][0], &set->coef[st][0][0], m_s1[st], m_s2[st]);
+
+	// scatter back out, saturating
+
+	for (u8 ch=0; ch<BIQUAD_BANK_CHANNELS; ch++)
+	{
+		if (!(present & (1 << ch)))
+			continue;
+		audio_block_t *out = AudioSystem::allocate();
+		if (!out)
+			return;
+		int16_t *dst = out->data;
+		for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+		{
+			s32 v = (s32) (m_buf[i][ch] * 32768.0f);
+			if (v > 32767) v = 32767;
+			if (v < -32768) v = -32768;
+			dst[i] = v;
+		}
+		transmit(out, ch);
+		AudioSystem::release(out);
+	}
+}
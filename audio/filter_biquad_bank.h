@@ -0,0 +1,80 @@
+#ifndef filter_biquad_bank_h_
+#define filter_biquad_bank_h_
+
+#include "Arduino.h"
+#include "AudioStream.h"
+
+// A bank of cascaded biquads for up to BIQUAD_BANK_CHANNELS channels,
+// i.e. per-track EQ on the 8 TDM channels.
+//
+// The filters are float transposed direct form II.  The channels are
+// processed side by side, one per SIMD lane, so that a stage of all
+// eight channels is two NEON vectors.  Every channel has its own
+// coefficients for every stage.  Unset stages are pass-through, and
+// stages past the highest one set on any channel are skipped.
+//
+// The setters run on the control (UI) side.  They build a complete
+// coefficient set and publish it through a triple buffer, which
+// update() picks up at the start of the next block, so a block is
+// never filtered with a half written set and neither side waits.
+
+#define BIQUAD_BANK_CHANNELS    8
+#define BIQUAD_BANK_STAGES      4
+#define BIQUAD_NUM_COEFS        5       // b0 b1 b2 a1 a2, normalized by a0
+
+
+typedef struct
+{
+	u8    num_stages;
+	float coef[BIQUAD_BANK_STAGES][BIQUAD_NUM_COEFS][BIQUAD_BANK_CHANNELS];
+} biquadBankCoefs_t;
+
+
+class AudioFilterBiquadBank : public AudioStream
+{
+public:
+
+	AudioFilterBiquadBank();
+
+	virtual const char *getName() 	{ return "biquads"; }
+	virtual u16   getType()  		{ return AUDIO_DEVICE_EFFECT; }
+
+	void setLowpass(u8 channel, u8 stage, float frequency, float q = 0.7071);
+	void setHighpass(u8 channel, u8 stage, float frequency, float q = 0.7071);
+	void setBandpass(u8 channel, u8 stage, float frequency, float q = 1.0);
+	void setNotch(u8 channel, u8 stage, float frequency, float q = 1.0);
+	void setPeaking(u8 channel, u8 stage, float frequency, float q, float gain_db);
+	void setLowShelf(u8 channel, u8 stage, float frequency, float gain_db, float slope = 1.0);
+	void setHighShelf(u8 channel, u8 stage, float frequency, float gain_db, float slope = 1.0);
+	void setCoefficients(u8 channel, u8 stage, const double *coefs);
+		// b0 b1 b2 a1 a2, already normalized by a0
+	void setPassThru(u8 channel, u8 stage);
+
+private:
+
+	static u16 s_nextInstance;
+
+	audio_block_t *inputQueueArray[BIQUAD_BANK_CHANNELS];
+
+	// m_ctrl is the control side's master copy.  The triple buffer
+	// is m_set[], with m_back owned by the control side, m_front by
+	// update(), and m_middle exchanged between them with a fresh bit.
+
+	biquadBankCoefs_t m_ctrl;
+	biquadBankCoefs_t m_set[3];
+	u8 m_back;
+	u8 m_front;
+	volatile u8 m_middle;
+
+	float m_s1[BIQUAD_BANK_STAGES][BIQUAD_BANK_CHANNELS];
+	float m_s2[BIQUAD_BANK_STAGES][BIQUAD_BANK_CHANNELS];
+	float m_buf[AUDIO_BLOCK_SAMPLES][BIQUAD_BANK_CHANNELS];
+
+	void setStage(u8 channel, u8 stage, const double *coefs);
+	void publish();
+	virtual void update(void);
+
+};
+
+
+#endif	// !filter_biquad_bank_h_
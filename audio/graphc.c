@@ -0,0 +1,404 @@
+/*
+ * graphc.c
+ *
+ * Compiles a text audio graph description into the binary
+ * descriptor read by AudioGraph::load().  Builds on the host
+ * with "make graphc" in this directory.
+ *
+ *     graphc input.txt output.bin
+ *
+ * The input is one statement per line, # starts a comment:
+ *
+ *     blocks  <audio> [<32bit> [<raw> [<delay>]]]
+ *     device  <name> <type> [<constructor arg>]
+ *     param   <name> <param>[[<index>]] <value>
+ *     connect <name>[:<output>] <name>[:<input>]
+ *
+ * i.e.
+ *
+ *     blocks  200 0 0 512
+ *     device  codec cs42448
+ *     device  in tdmi
+ *     device  echo delay 750
+ *     device  out tdmo
+ *     param   echo delay[0] 250
+ *     param   echo feedback[0] 0.4
+ *     connect in:0 echo
+ *     connect echo:0 out:0
+ *
+ * The index is the channel, tap, etc.  For the biquads it is
+ * [<channel>.<stage>], and a q for a stage is given before the
+ * lowpass or highpass it applies to:
+ *
+ *     param   eq q[1.0] 0.5
+ *     param   eq lowpass[1.0] 8000
+ *
+ * The types and params are listed in AudioGraphFormat.h.  Every
+ * device gets an update depth one more than the deepest device
+ * feeding it, and they are written sorted by that depth, so the
+ * Pi does not have to sort the graph.  Cycles are an error.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AudioGraphFormat.h"
+
+#define MAX_LINE    256
+#define MAX_NAME    32
+#define MAX_CONS    1024
+#define MAX_PARAMS  1024
+
+#define X(id, name, in, out, params)    name,
+static const char *type_name[] = { AUDIO_GRAPH_TYPES };
+#undef X
+#define X(id, name, in, out, params)    in,
+static const int type_inputs[] = { AUDIO_GRAPH_TYPES };
+#undef X
+#define X(id, name, in, out, params)    out,
+static const int type_outputs[] = { AUDIO_GRAPH_TYPES };
+#undef X
+#define X(id, name, in, out, params)    params,
+static const unsigned long type_params[] = { AUDIO_GRAPH_TYPES };
+#undef X
+#define X(id, name)     name,
+static const char *param_name[] = { AUDIO_GRAPH_PARAMS };
+#undef X
+
+static char device_name[AUDIO_GRAPH_MAX_DEVICES][MAX_NAME];
+static audio_graph_device_t devices[AUDIO_GRAPH_MAX_DEVICES];
+static audio_graph_connection_t cons[MAX_CONS];
+static audio_graph_param_t params[MAX_PARAMS];
+static audio_graph_header_t hdr;
+
+static const char *pFileName;
+static int nLine;
+
+
+static int error (const char *pMsg, const char *pArg)
+{
+	fprintf (stderr, "%s(%d): %s %s\n", pFileName, nLine, pMsg, pArg ? pArg : "");
+	return 1;
+}
+
+
+static int findDevice (const char *pName)
+{
+	int i;
+	for (i = 0; i < hdr.num_devices; i++)
+	{
+		if (strcmp (device_name[i], pName) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+static int parseEnd (char *pArg, int *pDevice, int *pPort)
+	/* name[:port] */
+{
+	char *pColon = strchr (pArg, ':');
+	*pPort = 0;
+	if (pColon)
+	{
+		*pColon = 0;
+		*pPort = atoi (pColon + 1);
+	}
+	*pDevice = findDevice (pArg);
+	if (*pDevice < 0)
+	{
+		return error ("unknown device", pArg);
+	}
+	return 0;
+}
+
+
+static int parseLine (char *pLine)
+{
+	char *pArgs[8];
+	int nArgs = 0;
+	char *pTok;
+
+	char *pComment = strchr (pLine, '#');
+	if (pComment)
+	{
+		*pComment = 0;
+	}
+	for (pTok = strtok (pLine, " \t\r\n"); pTok && nArgs < 8; pTok = strtok (NULL, " \t\r\n"))
+	{
+		pArgs[nArgs++] = pTok;
+	}
+	if (nArgs == 0)
+	{
+		return 0;
+	}
+
+	if (strcmp (pArgs[0], "blocks") == 0 && nArgs >= 2)
+	{
+		hdr.num_audio_blocks = atoi (pArgs[1]);
+		hdr.num_blocks32 = nArgs > 2 ? atoi (pArgs[2]) : 0;
+		hdr.num_raw_blocks = nArgs > 3 ? atoi (pArgs[3]) : 0;
+		hdr.num_delay_blocks = nArgs > 4 ? atoi (pArgs[4]) : 0;
+		return 0;
+	}
+
+	if (strcmp (pArgs[0], "device") == 0 && nArgs >= 3)
+	{
+		int nType;
+		if (hdr.num_devices >= AUDIO_GRAPH_MAX_DEVICES)
+		{
+			return error ("too many devices", NULL);
+		}
+		if (strlen (pArgs[1]) >= MAX_NAME || findDevice (pArgs[1]) >= 0)
+		{
+			return error ("bad or duplicate device name", pArgs[1]);
+		}
+		for (nType = 0; nType < AUDIO_GRAPH_NUM_TYPES; nType++)
+		{
+			if (strcmp (type_name[nType], pArgs[2]) == 0)
+			{
+				break;
+			}
+		}
+		if (nType == AUDIO_GRAPH_NUM_TYPES)
+		{
+			return error ("unknown device type", pArgs[2]);
+		}
+		strcpy (device_name[hdr.num_devices], pArgs[1]);
+		devices[hdr.num_devices].type = nType;
+		devices[hdr.num_devices].arg = nArgs > 3 ? atof (pArgs[3]) : 0.0;
+		hdr.num_devices++;
+		return 0;
+	}
+
+	if (strcmp (pArgs[0], "param") == 0 && nArgs == 4)
+	{
+		audio_graph_param_t *p = &params[hdr.num_params];
+		char *pBracket = strchr (pArgs[2], '[');
+		int nDevice = findDevice (pArgs[1]);
+		int nParam;
+		if (hdr.num_params >= MAX_PARAMS)
+		{
+			return error ("too many params", NULL);
+		}
+		if (nDevice < 0)
+		{
+			return error ("unknown device", pArgs[1]);
+		}
+		p->index = 0;
+		if (pBracket)
+		{
+			char *pDot = strchr (pBracket + 1, '.');
+			*pBracket = 0;
+			p->index = atoi (pBracket + 1);
+			if (pDot)
+			{
+				int nChannel = atoi (pBracket + 1);
+				int nStage = atoi (pDot + 1);
+				if (nChannel > 15 || nStage > 15)
+				{
+					return error ("bad channel.stage for", pArgs[2]);
+				}
+				p->index = nChannel * 16 + nStage;
+			}
+		}
+		for (nParam = 0; nParam < AUDIO_GRAPH_NUM_PARAMS; nParam++)
+		{
+			if (strcmp (param_name[nParam], pArgs[2]) == 0)
+			{
+				break;
+			}
+		}
+		if (nParam == AUDIO_GRAPH_NUM_PARAMS ||
+		    !(type_params[devices[nDevice].type] & (1UL << nParam)))
+		{
+			return error ("not a param of this device", pArgs[2]);
+		}
+		p->device = nDevice;
+		p->param = nParam;
+		p->value = atof (pArgs[3]);
+		hdr.num_params++;
+		return 0;
+	}
+
+	if (strcmp (pArgs[0], "connect") == 0 && nArgs == 3)
+	{
+		audio_graph_connection_t *c = &cons[hdr.num_connections];
+		int nSrc, nSrcPort, nDest, nDestPort;
+		if (hdr.num_connections >= MAX_CONS)
+		{
+			return error ("too many connections", NULL);
+		}
+		if (   parseEnd (pArgs[1], &nSrc, &nSrcPort)
+		    || parseEnd (pArgs[2], &nDest, &nDestPort))
+		{
+			return 1;
+		}
+		if (nSrcPort < 0 || nSrcPort >= type_outputs[devices[nSrc].type])
+		{
+			return error ("no such output on", pArgs[1]);
+		}
+		if (nDestPort < 0 || nDestPort >= type_inputs[devices[nDest].type])
+		{
+			return error ("no such input on", pArgs[2]);
+		}
+		c->src = nSrc;
+		c->src_port = nSrcPort;
+		c->dest = nDest;
+		c->dest_port = nDestPort;
+		c->reserved = 0;
+		hdr.num_connections++;
+		return 0;
+	}
+
+	return error ("syntax error", pArgs[0]);
+}
+
+
+static int computeDepths (void)
+	/*
+	 * Longest path from the sources.  Codecs are 0, everything
+	 * else starts at 1.  If anything still changes after as many
+	 * passes as there are devices, there is a cycle.
+	 */
+{
+	int nPass, i, bChanged = 1;
+	for (i = 0; i < hdr.num_devices; i++)
+	{
+		int nType = devices[i].type;
+		devices[i].depth = (type_inputs[nType] || type_outputs[nType]) ? 1 : 0;
+	}
+	for (nPass = 0; bChanged && nPass <= hdr.num_devices; nPass++)
+	{
+		bChanged = 0;
+		for (i = 0; i < hdr.num_connections; i++)
+		{
+			audio_graph_device_t *pSrc = &devices[cons[i].src];
+			audio_graph_device_t *pDest = &devices[cons[i].dest];
+			if (pDest->depth <= pSrc->depth)
+			{
+				pDest->depth = pSrc->depth + 1;
+				bChanged = 1;
+			}
+		}
+	}
+	if (bChanged)
+	{
+		nLine = 0;
+		return error ("the graph has a cycle", NULL);
+	}
+	return 0;
+}
+
+
+static int sortDevices (void)
+	/* stable sort by depth, renumbering the connections and params */
+{
+	static audio_graph_device_t sorted[AUDIO_GRAPH_MAX_DEVICES];
+	static char sorted_name[AUDIO_GRAPH_MAX_DEVICES][MAX_NAME];
+	int map[AUDIO_GRAPH_MAX_DEVICES];
+	int nDepth, i, n = 0;
+	int nMaxDepth = 0;
+
+	for (i = 0; i < hdr.num_devices; i++)
+	{
+		if (devices[i].depth > nMaxDepth)
+		{
+			nMaxDepth = devices[i].depth;
+		}
+	}
+	for (nDepth = 0; nDepth <= nMaxDepth; nDepth++)
+	{
+		for (i = 0; i < hdr.num_devices; i++)
+		{
+			if (devices[i].depth == nDepth)
+			{
+				map[i] = n;
+				sorted[n] = devices[i];
+				strcpy (sorted_name[n], device_name[i]);
+				n++;
+			}
+		}
+	}
+	memcpy (devices, sorted, sizeof devices);
+	memcpy (device_name, sorted_name, sizeof device_name);
+
+	for (i = 0; i < hdr.num_connections; i++)
+	{
+		cons[i].src = map[cons[i].src];
+		cons[i].dest = map[cons[i].dest];
+	}
+	for (i = 0; i < hdr.num_params; i++)
+	{
+		params[i].device = map[params[i].device];
+	}
+	return 0;
+}
+
+
+int main (int nArgC, char **ppArgV)
+{
+	char line[MAX_LINE];
+	FILE *pFile;
+	int i;
+
+	if (nArgC != 3)
+	{
+		fprintf (stderr, "\nUsage: %s input.txt output.bin\n\n", ppArgV[0]);
+		return 1;
+	}
+
+	pFileName = ppArgV[1];
+	pFile = fopen (pFileName, "r");
+	if (pFile == NULL)
+	{
+		fprintf (stderr, "File not found: %s\n", pFileName);
+		return 1;
+	}
+	while (fgets (line, sizeof line, pFile))
+	{
+		nLine++;
+		if (parseLine (line))
+		{
+			fclose (pFile);
+			return 1;
+		}
+	}
+	fclose (pFile);
+
+	if (hdr.num_devices == 0)
+	{
+		nLine = 0;
+		return error ("no devices", NULL);
+	}
+	if (computeDepths () || sortDevices ())
+	{
+		return 1;
+	}
+
+	hdr.magic = AUDIO_GRAPH_MAGIC;
+	hdr.version = AUDIO_GRAPH_VERSION;
+
+	pFile = fopen (ppArgV[2], "wb");
+	if (pFile == NULL)
+	{
+		fprintf (stderr, "Could not create %s\n", ppArgV[2]);
+		return 1;
+	}
+	fwrite (&hdr, sizeof hdr, 1, pFile);
+	fwrite (devices, sizeof devices[0], hdr.num_devices, pFile);
+	fwrite (cons, sizeof cons[0], hdr.num_connections, pFile);
+	fwrite (params, sizeof params[0], hdr.num_params, pFile);
+	fclose (pFile);
+
+	for (i = 0; i < hdr.num_devices; i++)
+	{
+		printf ("%3d  depth %-3d %-12s %s\n", i, devices[i].depth,
+			type_name[devices[i].type], device_name[i]);
+	}
+	printf ("%d devices, %d connections, %d params\n",
+		hdr.num_devices, hdr.num_connections, hdr.num_params);
+
+	return 0;
+}
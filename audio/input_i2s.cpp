@@ -66,53 +66,57 @@ void AudioInputI2S::start(void)
 
 void AudioInputI2S::isr(void)
 {
-	// get the uint32 'ready' input dma buffer from the bcm_pcm
-	
-	u16 len = AUDIO_BLOCK_SAMPLES;
-	uint32_t *src = bcm_pcm.getInBuffer();
-	
-	// get pointers to the destination (client) int16's and loop
-	// moving pairs of u32's from the dma buffer into pairs
-	// of int16's in the "client" teensy audio blocks
+	// move the uint32 'ready' input dma buffer from the bcm_pcm
+	// into the "client" teensy audio blocks
 
 	audio_block_t *left = s_block_left;
 	audio_block_t *right = s_block_right;
-	int16_t *dest_left = left ? left->data : 0;
-	int16_t *dest_right = right ? right->data : 0;
+	deinterleave(
+		bcm_pcm.getInBuffer(),
+		left ? left->data : 0,
+		right ? right->data : 0);
+	
+	// buffer is ready: call the client update method.
+	
+	if (s_update_responsibility)
+		AudioSystem::startUpdate();
+			
+	// this routine MUST complete before the DMA issues
+	// the next interrupt!! 
+	
+}
+
+
+void AudioInputI2S::deinterleave(const uint32_t *src, int16_t *dest_left, int16_t *dest_right)
+	// loop moving pairs of u32's from the dma buffer
+	// into pairs of int16's
+{
+	u16 len = AUDIO_BLOCK_SAMPLES;
 	
-	if (left && right)
+	if (dest_left && dest_right)
 	{
 		while (len--)
 		{
-			*dest_left++ = *(int16_t *) src++;
-			*dest_right++ = *(int16_t *) src++;
+			*dest_left++ = *(const int16_t *) src++;
+			*dest_right++ = *(const int16_t *) src++;
 		}
 	}
-	else if (left)
+	else if (dest_left)
 	{
 		while (len--)
 		{
-			*dest_left++ = *(int16_t *) src++;
+			*dest_left++ = *(const int16_t *) src++;
 			src++;
 		}
 	}
-	else if (right)
+	else if (dest_right)
 	{
 		while (len--)
 		{
 			src++;
-			*dest_right++ = *(int16_t *) src++;
+			*dest_right++ = *(const int16_t *) src++;
 		}
 	}
-	
-	// buffer is ready: call the client update method.
-	
-	if (s_update_responsibility)
-		AudioSystem::startUpdate();
-			
-	// this routine MUST complete before the DMA issues
-	// the next interrupt!! 
-	
 }
 
 
@@ -46,6 +46,9 @@ public:
 
 	virtual const char *getName() 	{ return "i2si"; }
 	virtual u16   getType()  		{ return AUDIO_DEVICE_INPUT; }
+
+	static void deinterleave(const uint32_t *src, int16_t *dest_left, int16_t *dest_right);
+		// one dma buffer into a left and right block, either may be NULL
 	
 protected:
 
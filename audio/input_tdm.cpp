@@ -73,14 +73,7 @@ void AudioInputTDM::isr(void)
 		// get the uint32 'ready' input dma buffer from the bcm_pcm
 		// and move interleaved bytes from it to the incoming blocks
 		
-		u16 len = AUDIO_BLOCK_SAMPLES;
-		uint32_t *src = bcm_pcm.getInBuffer();
-		
-		while (len--)
-		{
-			for (u8 i=0; i<NUM_TDM_CHANNELS; i++)
-				*(dest[i])++ = *(int16_t *) src++;
-		}
+		deinterleave(bcm_pcm.getInBuffer(), dest);
 	}
 
 	if (s_update_responsibility)
@@ -89,6 +82,21 @@ void AudioInputTDM::isr(void)
 }
 
 
+void AudioInputTDM::deinterleave(const uint32_t *src, int16_t **dest)
+{
+	int16_t *ptr[NUM_TDM_CHANNELS];
+	for (u8 i=0; i<NUM_TDM_CHANNELS; i++)
+		ptr[i] = dest[i];
+	
+	u16 len = AUDIO_BLOCK_SAMPLES;
+	while (len--)
+	{
+		for (u8 i=0; i<NUM_TDM_CHANNELS; i++)
+			*(ptr[i])++ = *(const int16_t *) src++;
+	}
+}
+
+
 void AudioInputTDM::update(void)
 {
 	unsigned int i, j;
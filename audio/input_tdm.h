@@ -49,6 +49,9 @@ public:
 	virtual const char *getName() 	{ return "tdmi"; }
 	virtual u16   getType()  		{ return AUDIO_DEVICE_INPUT; }
 
+	static void deinterleave(const uint32_t *src, int16_t **dest);
+		// one dma buffer into NUM_TDM_CHANNELS blocks
+
 
 private:
 
@@ -63,7 +63,6 @@ void AudioOutputI2S::isr(void)
 	// get a pointer to the buffer that we need to fill in
 	// before the next DMA interrupt
 	
-	u16 len = AUDIO_BLOCK_SAMPLES;
 	uint32_t *dest = bcm_pcm.getOutBuffer();
 	
 	// if we have update responsibility, call the client update methods
@@ -80,59 +79,66 @@ void AudioOutputI2S::isr(void)
 	
 	audio_block_t *blockL = s_block_left_1st;
 	audio_block_t *blockR = s_block_right_1st;
+	interleave(
+		blockL ? blockL->data : 0,
+		blockR ? blockR->data : 0,
+		dest);
 	
-	if (blockL && blockR)
+	if (blockL)
 	{
-		int16_t *lptr = blockL->data;
-		int16_t *rptr = blockR->data;
-		while (len--)
-		{
-			*dest++ = *(uint32_t *) lptr++;
-			*dest++ = *(uint32_t *) rptr++;
-		}
 		s_block_left_1st = s_block_left_2nd;
-		s_block_right_1st = s_block_right_2nd;
 		s_block_left_2nd = NULL;
-		s_block_right_2nd = NULL;
 		AudioSystem::release(blockL);
+	}
+	if (blockR)
+	{
+		s_block_right_1st = s_block_right_2nd;
+		s_block_right_2nd = NULL;
 		AudioSystem::release(blockR);
 	}
-	else if (blockL)
+
+	// this routine MUST complete before the DMA issues
+	// the next interrupt!! 
+}
+
+
+
+void AudioOutputI2S::interleave(int16_t *left, int16_t *right, uint32_t *dest)
+{
+	u16 len = AUDIO_BLOCK_SAMPLES;
+	
+	if (left && right)
 	{
-		int16_t *lptr = blockL->data;
 		while (len--)
 		{
-			*dest++ = *(uint32_t *) lptr++;
+			*dest++ = *(uint32_t *) left++;
+			*dest++ = *(uint32_t *) right++;
+		}
+	}
+	else if (left)
+	{
+		while (len--)
+		{
+			*dest++ = *(uint32_t *) left++;
 			*dest++ = 0;
 		}
-		s_block_left_1st = s_block_left_2nd;
-		s_block_left_2nd = NULL;
-		AudioSystem::release(blockL);
 	}
-	else if (blockR)
+	else if (right)
 	{
-		int16_t *rptr = blockR->data;
 		while (len--)
 		{
 			*dest++ = 0;
-			*dest++ = *(uint32_t *) rptr++;
+			*dest++ = *(uint32_t *) right++;
 		}
-		s_block_right_1st = s_block_right_2nd;
-		s_block_right_2nd = NULL;
-		AudioSystem::release(blockR);
 	}
 	else
 	{
 		memset(dest,0,AUDIO_BLOCK_SAMPLES * 4);
 	}
-
-	// this routine MUST complete before the DMA issues
-	// the next interrupt!! 
 }
 
 
 
-
 void AudioOutputI2S::update(void)
 {
 	audio_block_t *block;
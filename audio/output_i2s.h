@@ -47,6 +47,9 @@ public:
 	
 	virtual const char *getName() 	{ return "i2so"; }
 	virtual u16   getType()  	  	{ return AUDIO_DEVICE_OUTPUT; }
+
+	static void interleave(int16_t *left, int16_t *right, uint32_t *dest);
+		// a left and right block, either may be NULL, into one dma buffer
 	
 protected:
 	
@@ -72,16 +72,24 @@ void AudioOutputTDM::isr(void)
 	for (u8 i=0; i<NUM_TDM_CHANNELS; i++)
 		src[i] = s_block_input[i] ? s_block_input[i]->data : 0;
 
-	// get the uint32 'ready' input dma buffer from the bcm_pcm
-	// and move interleaved bytes from it to the incoming blocks
+	// get the uint32 'ready' output dma buffer from the bcm_pcm
+	// and move the interleaved samples into it
 	
-	u16 len = AUDIO_BLOCK_SAMPLES;
-	uint32_t *dest = bcm_pcm.getOutBuffer();
+	interleave(src, bcm_pcm.getOutBuffer());
+}
+
+
+void AudioOutputTDM::interleave(int16_t **src, uint32_t *dest)
+{
+	int16_t *ptr[NUM_TDM_CHANNELS];
+	for (u8 i=0; i<NUM_TDM_CHANNELS; i++)
+		ptr[i] = src[i];
 	
+	u16 len = AUDIO_BLOCK_SAMPLES;
 	while (len--)
 	{
 		for (u8 i=0; i<NUM_TDM_CHANNELS; i++)
-			*dest++ = src[i] ? *(uint32_t *) (src[i]++) : 0;
+			*dest++ = ptr[i] ? *(uint32_t *) (ptr[i]++) : 0;
 	}
 }
 
@@ -48,6 +48,10 @@ public:
     
 	virtual const char *getName() 	{ return "tdmo"; }
 	virtual u16   getType()  	  	{ return AUDIO_DEVICE_OUTPUT; }
+
+	static void interleave(int16_t **src, uint32_t *dest);
+		// NUM_TDM_CHANNELS blocks, any of which may be NULL,
+		// into one dma buffer
 	
 private:
 
@@ -20,7 +20,11 @@ AudioRecorder::AudioRecorder() :
     m_record_mask  = 0;
     m_play_mask    = 0xffff;
     for (int i=0; i<RECORD_CHANNELS; i++)
+    {
         m_buffer[i] = 0;
+        for (int level=0; level<RECORD_SUMMARY_LEVELS; level++)
+            m_summary[i][level] = 0;
+    }
 }    
 
 
@@ -33,6 +37,15 @@ void AudioRecorder::start()
             m_buffer[i] = (int16_t *) malloc(RECORD_BUFFER_BYTES);
             assert(m_buffer[i]);
         }
+        for (int level=0; level<RECORD_SUMMARY_LEVELS; level++)
+        {
+            if (!m_summary[i][level])
+            {
+                m_summary[i][level] = (recorder_minmax_t *) malloc(
+                    RECORD_SUMMARY_BLOCKS(level) * sizeof(recorder_minmax_t));
+                assert(m_summary[i][level]);
+            }
+        }
     }
     clearRecording();
 }
@@ -47,6 +60,12 @@ void AudioRecorder::clearRecording()
     {
         if (m_buffer[i])
             memset(m_buffer[i],0,RECORD_BUFFER_BYTES);
+        for (int level=0; level<RECORD_SUMMARY_LEVELS; level++)
+        {
+            if (m_summary[i][level])
+                memset(m_summary[i][level],0,
+                    RECORD_SUMMARY_BLOCKS(level) * sizeof(recorder_minmax_t));
+        }
     }
 }
 
@@ -101,10 +120,15 @@ void AudioRecorder::update(void)
                     if (m_record_mask & mask(j))
                     {
                         m_buffer[j][offset+i] =
-                            ip ? *ip[j]++ : 0;
+                            ip[j] ? *ip[j]++ : 0;
                     }                
                 }
             }
+            for (u16 j=0; j<RECORD_CHANNELS; j++)
+            {
+                if (m_record_mask & mask(j))
+                    updateSummary(j,m_cur_block);
+            }
         }
         
         // replace any other playing channels with previously recorded data
@@ -141,7 +165,131 @@ void AudioRecorder::update(void)
             AudioSystem::release(in[j]);
         }
     }
+    
+    recorder_position_t pos;
+    pos.location = m_cur_block;
+    pos.length   = m_num_blocks;
+    pos.running  = m_running;
+    m_position.publish(pos);
+}
+
+
+
+
+
+
+//--------------------------------------
+// waveform summaries
+//--------------------------------------
+
+static inline void merge(recorder_minmax_t *pOut, const recorder_minmax_t *p)
+{
+    if (p->min < pOut->min) pOut->min = p->min;
+    if (p->max > pOut->max) pOut->max = p->max;
 }
 
 
+void AudioRecorder::updateSummary(int channel, u32 block)
+    // Called from update() after a block has been recorded.
+    // The upper levels are rebuilt from the eight entries below
+    // them, rather than merged into, so that recording over part
+    // of an old take leaves the rest of the group correct.
+{
+    const s16 *p = &m_buffer[channel][block * AUDIO_BLOCK_SAMPLES];
+    recorder_minmax_t mm;
+    mm.min = 32767;
+    mm.max = -32768;
+    for (u32 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+    {
+        s16 s = p[i];
+        if (s < mm.min) mm.min = s;
+        if (s > mm.max) mm.max = s;
+    }
+    m_summary[channel][0][block] = mm;
 
+    for (int level=1; level<RECORD_SUMMARY_LEVELS; level++)
+    {
+        u32 first = (block >> (RECORD_SUMMARY_SHIFT * level)) << RECORD_SUMMARY_SHIFT;
+        u32 last = first + (1 << RECORD_SUMMARY_SHIFT);
+        if (last > RECORD_SUMMARY_BLOCKS(level-1))
+            last = RECORD_SUMMARY_BLOCKS(level-1);
+        const recorder_minmax_t *below = m_summary[channel][level-1];
+        mm = below[first];
+        for (u32 i=first+1; i<last; i++)
+            merge(&mm,&below[i]);
+        m_summary[channel][level][first >> RECORD_SUMMARY_SHIFT] = mm;
+    }
+}
+
+
+void AudioRecorder::blockRange(int channel, u32 bs, u32 be, recorder_minmax_t *pOut)
+    // merge blocks bs..be-1 into pOut, using the largest
+    // aligned summary that fits at each step
+{
+    u32 b = bs;
+    while (b < be)
+    {
+        int level = RECORD_SUMMARY_LEVELS-1;
+        while (level)
+        {
+            u32 size = 1 << (RECORD_SUMMARY_SHIFT * level);
+            if (!(b & (size-1)) && b + size <= be)
+                break;
+            level--;
+        }
+        merge(pOut,&m_summary[channel][level][b >> (RECORD_SUMMARY_SHIFT * level)]);
+        b += 1 << (RECORD_SUMMARY_SHIFT * level);
+    }
+}
+
+
+void AudioRecorder::getEnvelope(
+    int channel,
+    u32 start_sample,
+    u32 samples_per_pixel,
+    u16 num_pixels,
+    recorder_minmax_t *pOut)
+{
+    if (!m_buffer[channel] || !m_summary[channel][0])
+    {
+        memset(pOut,0,num_pixels * sizeof(recorder_minmax_t));
+        return;
+    }
+    if (!samples_per_pixel)
+        samples_per_pixel = 1;
+
+    for (u16 x=0; x<num_pixels; x++)
+    {
+        recorder_minmax_t *pPixel = &pOut[x];
+        pPixel->min = 32767;
+        pPixel->max = -32768;
+
+        u32 s = start_sample + x * samples_per_pixel;
+        u32 e = s + samples_per_pixel;
+        if (e > RECORD_BUFFER_SAMPLES)
+            e = RECORD_BUFFER_SAMPLES;
+        if (s >= e)
+        {
+            pPixel->min = pPixel->max = 0;
+            continue;
+        }
+
+        if (samples_per_pixel >= AUDIO_BLOCK_SAMPLES)
+        {
+            u32 bs = s / AUDIO_BLOCK_SAMPLES;
+            u32 be = e / AUDIO_BLOCK_SAMPLES;
+            if (be <= bs)
+                be = bs + 1;
+            blockRange(channel,bs,be,pPixel);
+        }
+        else
+        {
+            const s16 *p = m_buffer[channel];
+            for (u32 i=s; i<e; i++)
+            {
+                if (p[i] < pPixel->min) pPixel->min = p[i];
+                if (p[i] > pPixel->max) pPixel->max = p[i];
+            }
+        }
+    }
+}
@@ -3,6 +3,7 @@
 
 #include "Arduino.h"
 #include "AudioStream.h"
+#include "AudioSnapshot.h"
 
 // this device just samples the stream into a buffer
 // the buffer is public for the UI to display it
@@ -17,6 +18,37 @@
 #define RECORD_BUFFER_BYTES     (RECORD_BUFFER_SAMPLES * sizeof(s16))
 
 
+// While recording, update() keeps a pyramid of min/max summaries
+// of each channel, one entry per block (128 samples), per 8 blocks
+// (1K samples), and per 64 blocks (8K samples), so that the UI can
+// get the envelope of any range of the recording by merging a
+// handful of summaries per pixel, rather than scanning the buffer.
+// The UI reads these as they are being written, so a column may
+// briefly show a half updated entry, which is harmless.
+
+#define RECORD_SUMMARY_LEVELS   3
+#define RECORD_SUMMARY_SHIFT    3       // 8 entries per entry at the next level
+
+#define RECORD_SUMMARY_BLOCKS(level) \
+    ((RECORD_BUFFER_BLOCKS >> (RECORD_SUMMARY_SHIFT * (level))) + 1)
+
+
+typedef struct
+{
+    s16 min;
+    s16 max;
+}   recorder_minmax_t;
+
+
+typedef struct
+    // published by update() once per block for the UI
+{
+    u32  location;
+    u32  length;
+    bool running;
+}   recorder_position_t;
+
+
 class AudioRecorder : public AudioStream
 {
 public:
@@ -34,6 +66,8 @@ public:
     
     u32 getLength()                 { return m_num_blocks; }
     u32 getLocation()               { return m_cur_block; }
+    void getPosition(recorder_position_t *pPos)    { m_position.read(pPos); }
+        // a consistent copy for UI code on another core
     
 	void start(void);
     bool isRunning()                { return m_running; }
@@ -44,6 +78,18 @@ public:
 
     int16_t *getBuffer(int channel)            { return m_buffer[channel]; }
     
+    void getEnvelope(
+        int channel,
+        u32 start_sample,
+        u32 samples_per_pixel,
+        u16 num_pixels,
+        recorder_minmax_t *pOut);
+        // Fills in the min and max sample for each of num_pixels
+        // columns starting at start_sample.  When there are at least
+        // AUDIO_BLOCK_SAMPLES per pixel the columns are snapped to
+        // whole blocks and built from the summaries, otherwise from
+        // the samples themselves.
+    
 private:
 
     u16     m_record_mask;
@@ -53,10 +99,15 @@ private:
     u32     m_num_blocks;
     u32     m_cur_block;
     
+    AudioSnapshot<recorder_position_t> m_position;
+    
 	audio_block_t *inputQueueArray[RECORD_CHANNELS];
     int16_t *m_buffer[RECORD_CHANNELS];
+    recorder_minmax_t *m_summary[RECORD_CHANNELS][RECORD_SUMMARY_LEVELS];
 
     void update(void);
+    void updateSummary(int channel, u32 block);
+    void blockRange(int channel, u32 bs, u32 be, recorder_minmax_t *pOut);
     
 };
 
@@ -100,38 +100,29 @@ static int32_t taylor(uint32_t ph)
 
 
 void AudioSynthWaveformSineHires::update(void)
+	// transmits a single 32 bit block rather than
+	// the teensy's separate msw and lsw 16 bit blocks
 {
-	audio_block_t *msw, *lsw;
+	audio_block32_t *block;
 	uint32_t i, ph, inc;
-	int32_t val;
 
 	if (magnitude)
 	{
-		msw = AudioSystem::allocate();
-		lsw = AudioSystem::allocate();
-		if (msw && lsw)
+		block = AudioSystem::allocate32();
+		if (block)
 		{
 			ph = phase_accumulator;
 			inc = phase_increment;
 			for (i=0; i < AUDIO_BLOCK_SAMPLES; i++)
 			{
-				val = taylor(ph);
-				msw->data[i] = val >> 16;
-				lsw->data[i] = val & 0xFFFF;
+				block->data[i] = taylor(ph);
 				ph += inc;
 			}
 			phase_accumulator = ph;
-			transmit(msw, 0);
-			AudioSystem::release(msw);
-			transmit(lsw, 1);
-			AudioSystem::release(lsw);
+			transmit(block);
+			AudioSystem::release(block);
 			return;
 		}
-		else
-		{
-			if (msw) AudioSystem::release(msw);
-			if (lsw) AudioSystem::release(lsw);
-		}
 	}
 	phase_accumulator += phase_increment * AUDIO_BLOCK_SAMPLES;
 }
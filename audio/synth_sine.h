@@ -86,6 +86,8 @@ private:
 
 
 class AudioSynthWaveformSineHires : public AudioStream
+	// Outputs a single 32 bit block (AUDIO_BLOCK_CLASS_32), so
+	// AudioSystem::initialize() must be given some num_blocks32.
 {
 public:
 	
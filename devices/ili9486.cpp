@@ -133,3 +133,16 @@ void ILI9846::color565ToBuf(u16 color, u8 *buf)
 	buf[0] = color >> 8;
 	buf[1] = color & 0xff;
 }
+
+
+// virtual
+void ILI9846::colors565ToBuf(const u16 *colors, u32 count, u8 *buf)
+	// the same, big endian, for a span of pixels
+{
+	for (u32 i=0; i<count; i++)
+	{
+		u16 color = *colors++;
+		*buf++ = color >> 8;
+		*buf++ = color & 0xff;
+	}
+}
@@ -18,6 +18,7 @@ private:
 	CGPIOPin    m_pinRESET;
 
 	virtual void color565ToBuf(u16 color, u8 *buf) override;
+	virtual void colors565ToBuf(const u16 *colors, u32 count, u8 *buf) override;
 
 };
 
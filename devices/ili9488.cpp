@@ -36,6 +36,18 @@
 	// on by default, the screen displays a distinct pattern
 	// of squares to verify basic functionality at boot ...
 
+#define BENCHMARK_CONVERT		0
+	// log the per pixel vs span color conversion times at boot
+
+#define USE_NEON_CONVERT		0
+	// convert spans of colors eight at a time with NEON.
+	// Off until it has been built for, and checked on, a Pi,
+	// with BENCHMARK_CONVERT and OUTPUT_TEST_PATTERN.
+
+#if USE_NEON_CONVERT && defined(__ARM_NEON)
+	#include <arm_neon.h>
+#endif
+
 
 //---------------------------------------------------------------
 // initialization sequence - MOSTLY COMMENTS REALLY
@@ -248,6 +260,10 @@ boolean ILI9488::Initialize()
 		distinctivePattern();
     #endif
 
+	#if BENCHMARK_CONVERT
+		benchmarkConvert();
+	#endif
+
 	return true;
 }
 
@@ -264,3 +280,36 @@ void ILI9488::color565ToBuf(u16 color, u8 *buf)
 	buf[2] = color & 0x1f;
 	buf[2] <<= 3;
 }
+
+
+// virtual
+void ILI9488::colors565ToBuf(const u16 *colors, u32 count, u8 *buf)
+	// The same conversion for a span of pixels.  With USE_NEON_CONVERT,
+	// eight pixels at a time are split into their r, g, and b bytes, which
+	// vst3 interleaves into the 24 output bytes.  A lookup table does
+	// not pay for itself here, as each byte is one shift and mask.
+{
+	u32 i = 0;
+
+	#if USE_NEON_CONVERT && defined(__ARM_NEON)
+		const uint8x8_t mask_r = vdup_n_u8(0xf8);
+		const uint8x8_t mask_g = vdup_n_u8(0xfc);
+		for (; i + 8 <= count; i += 8, buf += 24)
+		{
+			uint16x8_t c = vld1q_u16(&colors[i]);
+			uint8x8x3_t rgb;
+			rgb.val[0] = vand_u8(vshrn_n_u16(c,8),mask_r);
+			rgb.val[1] = vand_u8(vshrn_n_u16(c,3),mask_g);
+			rgb.val[2] = vshl_n_u8(vmovn_u16(c),3);
+			vst3_u8(buf,rgb);
+		}
+	#endif
+
+	for (; i<count; i++, buf += 3)
+	{
+		u16 color = colors[i];
+		buf[0] = (color >> 8) & 0xf8;
+		buf[1] = (color >> 3) & 0xfc;
+		buf[2] = color << 3;
+	}
+}
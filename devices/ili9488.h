@@ -16,6 +16,7 @@ public:
 private:
 
 	virtual void color565ToBuf(u16 color, u8 *buf) override;
+	virtual void colors565ToBuf(const u16 *colors, u32 count, u8 *buf) override;
 
 };
 
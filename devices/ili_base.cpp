@@ -6,6 +6,7 @@
 #include <circle/logger.h>
 // #include <circle/gpiomanager.h>
 #include <circle/util.h>
+#include <circle/synchronize.h>
 #include <utils/myUtils.h>
 
 
@@ -115,6 +116,11 @@
 
 ILIBASE::~ILIBASE()
 {
+	#if USE_ILI_SHADOW
+		delete [] m_shadow;
+		delete [] m_tile_dirty;
+		delete [] m_tile_hash;
+	#endif
 }
 
 
@@ -128,7 +134,7 @@ ILIBASE::ILIBASE(u16 fixed_width,
 	m_fixed_width(fixed_width),
 	m_fixed_height(fixed_height),
 	m_pixel_bytes(pixel_bytes),
-    m_pSPI(pSPI),
+    m_bus(pSPI),
 	m_write_freq(spi_write_freq),
 	m_read_freq(spi_read_freq),
     m_pinCD(PIN_CD,GPIOModeOutput)
@@ -137,10 +143,28 @@ ILIBASE::ILIBASE(u16 fixed_width,
 	#endif
 {
 	m_rotation = 0;
+	m_pixels_left = 0;
+	m_buf_len = 0;
+	m_buf_num = 0;
+	m_buf_serial[0] = 0;
+	m_buf_serial[1] = 0;
 	m_pinCD.Write(1);
 	#if WITH_TRIGGER_PIN
 		m_trigger_pin.Write(1);
 	#endif
+	m_bus_id = m_bus.addDevice("ili",0,m_write_freq);
+	#if USE_ILI_SHADOW
+		u32 num_tiles =
+			((fixed_width + ILI_TILE_SIZE - 1) / ILI_TILE_SIZE) *
+			((fixed_height + ILI_TILE_SIZE - 1) / ILI_TILE_SIZE);
+		m_shadow = new u16[fixed_width * fixed_height];
+		m_tile_dirty = new u8[num_tiles];
+		m_tile_hash = new u32[num_tiles];
+		memset(m_shadow,0,fixed_width * fixed_height * sizeof(u16));
+		m_area_xs = m_area_xe = 0;
+		m_area_x = m_area_y = 0;
+		resetTiles();
+	#endif
 }
 
 
@@ -150,23 +174,22 @@ void ILIBASE::InitializeUI(void *pUI, DriverRegisterFxn registerFxn)
 	LOG("InitializeUI()",0);
 	registerFxn(pUI, this, SCREEN_OPT_FILL_FRAME, (void *) staticFillFrame );
 	registerFxn(pUI, this, SCREEN_OPT_FILL_AREA, (void *) staticFillArea );
+	registerFxn(pUI, this, SCREEN_OPT_FLUSH, (void *) staticFlush );
+	registerFxn(pUI, this, SCREEN_OPT_BLIT, (void *) staticBlit );
 }
 
 
 void ILIBASE::write(u8 *data, u16 len)
+	// short synchronous writes of commands and their parameters
 {
-    CTimer::Get()->usDelay(1);
-	while (len--)
-	{
-		m_pSPI->SetClock(m_write_freq);
-		m_pSPI->WriteRead(0,data++,0,1);
-		CTimer::Get()->usDelay(1);
-	}
+	m_bus.transfer(m_bus_id,data,0,len);
 }
 
 
 void ILIBASE::writeCommand(u8 command, u8 *data, u16 len)
 {
+	waitIdle();
+		// the CD pin cannot change until the last pixels are out
     m_pinCD.Write(0);
     write(&command,1);
     m_pinCD.Write(1);
@@ -194,11 +217,13 @@ void ILIBASE::dbgRead(const char *what, u8 command, u8 reply_bytes)
 
 	u8 extra_byte = reply_bytes > 1 ? 1 : 0;
 
-    m_pSPI->SetClock(m_read_freq);
+	waitIdle();
+	m_bus.setClock(m_bus_id,m_read_freq);
 	m_pinCD.Write(0);
 	CTimer::Get()->usDelay(1);
-	m_pSPI->WriteRead(0,buf,buf,reply_bytes + 1 + extra_byte);
+	m_bus.transfer(m_bus_id,buf,buf,reply_bytes + 1 + extra_byte);
 	m_pinCD.Write(1);
+	m_bus.setClock(m_bus_id,m_write_freq);
 
 	// for the bytes AFTER the command byte (+1)
 	// shift the higher order bit of the NEXT (+2)
@@ -245,6 +270,7 @@ void ILIBASE::distinctivePattern()
 	fillRect(GetWidth()-1-50,GetHeight()-1-50,GetWidth()-1,GetHeight()-1,RGB565_WHITE);
 
 	printString(30,30,"This is a TEST",RGB565_YELLOW,RGB565_BLUE,2);
+	flush();
 }
 
 
@@ -334,6 +360,10 @@ void ILIBASE::setRotation(u8 rotation)
 
 	writeCommand(0x36,buf,1);	// MADCTL
 	CTimer::Get()->usDelay(5);
+
+	#if USE_ILI_SHADOW
+		resetTiles();
+	#endif
 }
 
 
@@ -358,37 +388,336 @@ void ILIBASE::setWindow(int xs, int ys, int xe, int ye)
 
 
 void ILIBASE::fillRect(int xs, int ys, int xe, int ye, u16 color)
+	// The buffer is filled with the color once, and
+	// then sent as many times as needed.
 {
 	// LOG("fillRect(%d,%d,%d,%d,0x%04x)",xs,ys,xe,ye,color);
 
-	u8 buf[m_pixel_bytes];
-	color565ToBuf(color,buf);
-    u32 pixels = (xe-xs+1) * (ye-ys+1);
+	if (xe < xs || ye < ys)
+		return;
+
+	#if USE_ILI_SHADOW
+		int width = GetWidth();
+		int height = GetHeight();
+		if (xs < 0) xs = 0;
+		if (ys < 0) ys = 0;
+		if (xe >= width) xe = width - 1;
+		if (ye >= height) ye = height - 1;
+		if (xe < xs || ye < ys)
+			return;
+		for (int y=ys; y<=ye; y++)
+		{
+			u16 *p = &m_shadow[y * width + xs];
+			for (int x=xs; x<=xe; x++)
+				*p++ = color;
+		}
+		setDirty(xs,ys,xe,ye);
+		return;
+	#endif
 
+	sendPixels();
 	setWindow(xs,ys,xe,ye);
-    while (pixels--)
+
+    u32 pixels = (xe-xs+1) * (ye-ys+1);
+	u32 num = pixels < ILI_BUFFER_PIXELS ? pixels : ILI_BUFFER_PIXELS;
+	u8 *buf = m_buf[m_buf_num];
+	for (u32 i=0; i<num; i++)
+		color565ToBuf(color,&buf[i * m_pixel_bytes]);
+
+    while (pixels)
     {
-		m_pSPI->SetClock(m_write_freq);
-        m_pSPI->WriteRead(0,buf,0,m_pixel_bytes);
+		num = pixels < ILI_BUFFER_PIXELS ? pixels : ILI_BUFFER_PIXELS;
+		sendBuffer(buf,num * m_pixel_bytes);
+		pixels -= num;
     }
+	nextBuffer();
 }
 
 
 // virtual
 void ILIBASE::SetPixel(unsigned x, unsigned y, u16 color)
 {
-	if (x>GetWidth()) return;
-	if (y>GetHeight()) return;
+	if (x>=GetWidth()) return;
+	if (y>=GetHeight()) return;
+
+	#if USE_ILI_SHADOW
+		m_shadow[y * GetWidth() + x] = color;
+		setDirty(x,y,x,y);
+	#else
+		startPixels(x,y,x,y);
+		pushPixel(color);
+	#endif
+}
 
-	u8 buf[m_pixel_bytes];
-	color565ToBuf(color,buf);
 
-    setWindow(x,y,x,y);
-    m_pSPI->SetClock(m_write_freq);
-    m_pSPI->Write(0,buf,m_pixel_bytes);
+// virtual
+u16 ILIBASE::GetPixel(unsigned x, unsigned y)
+{
+	#if USE_ILI_SHADOW
+		if (x < GetWidth() && y < GetHeight())
+			return m_shadow[y * GetWidth() + x];
+	#endif
+	return 0;
 }
 
 
+//------------------------------------------
+// pixel pipeline
+//------------------------------------------
+
+void ILIBASE::startPixels(int xs, int ys, int xe, int ye)
+{
+	sendPixels();
+	setWindow(xs,ys,xe,ye);
+	m_pixels_left = (xe-xs+1) * (ye-ys+1);
+}
+
+
+void ILIBASE::pushPixel(u16 color)
+{
+	color565ToBuf(color,&m_buf[m_buf_num][m_buf_len]);
+	m_buf_len += m_pixel_bytes;
+	if (m_pixels_left)
+		m_pixels_left--;
+	if (!m_pixels_left || m_buf_len + m_pixel_bytes > ILI_BUFFER_BYTES)
+		sendPixels();
+}
+
+
+void ILIBASE::pushPixels(const u16 *colors, u32 count)
+	// Converts as much of the span as fits in the buffer at
+	// a time, and sends full buffers just like pushPixel().
+{
+	while (count)
+	{
+		u32 num = (ILI_BUFFER_BYTES - m_buf_len) / m_pixel_bytes;
+		if (num > count)
+			num = count;
+		colors565ToBuf(colors,num,&m_buf[m_buf_num][m_buf_len]);
+		m_buf_len += num * m_pixel_bytes;
+		colors += num;
+		count -= num;
+
+		m_pixels_left = num < m_pixels_left ? m_pixels_left - num : 0;
+		if (!m_pixels_left || m_buf_len + m_pixel_bytes > ILI_BUFFER_BYTES)
+			sendPixels();
+	}
+}
+
+
+// virtual
+void ILIBASE::colors565ToBuf(const u16 *colors, u32 count, u8 *buf)
+{
+	for (u32 i=0; i<count; i++, buf += m_pixel_bytes)
+		color565ToBuf(colors[i],buf);
+}
+
+
+void ILIBASE::benchmarkConvert()
+{
+	u16 line[ILI_BUFFER_PIXELS];
+	for (u32 i=0; i<ILI_BUFFER_PIXELS; i++)
+		line[i] = i * 40503;
+
+	sendPixels();
+	waitIdle();
+	u8 *buf = m_buf[m_buf_num];
+	u32 lines = m_fixed_width * m_fixed_height / ILI_BUFFER_PIXELS;
+
+	u32 start = CTimer::GetClockTicks();
+	for (u32 l=0; l<lines; l++)
+	{
+		for (u32 i=0; i<ILI_BUFFER_PIXELS; i++)
+			color565ToBuf(line[i],&buf[i * m_pixel_bytes]);
+	}
+	u32 per_pixel = CTimer::GetClockTicks() - start;
+
+	start = CTimer::GetClockTicks();
+	for (u32 l=0; l<lines; l++)
+		colors565ToBuf(line,ILI_BUFFER_PIXELS,buf);
+	u32 span = CTimer::GetClockTicks() - start;
+
+	LOG("convert %d pixels: per pixel %d us, span %d us",
+		lines * ILI_BUFFER_PIXELS,
+		per_pixel,
+		span);
+}
+
+
+void ILIBASE::sendPixels()
+	// queue the current buffer, if any, and switch to the other
+	// one, so it can be filled while this one is being sent.
+{
+	if (m_buf_len)
+	{
+		sendBuffer(m_buf[m_buf_num],m_buf_len);
+		nextBuffer();
+		m_buf_len = 0;
+	}
+}
+
+
+void ILIBASE::sendBuffer(u8 *buf, u32 len)
+	// the buffer must not be changed until it has been sent
+{
+	#if USE_SPI_DMA
+		u32 serial = m_bus.start(m_bus_id,buf,m_rx_buf,len);
+	#else
+		u32 serial = m_bus.start(m_bus_id,buf,0,len);
+	#endif
+	m_buf_serial[buf == m_buf[1] ? 1 : 0] = serial;
+}
+
+
+void ILIBASE::nextBuffer()
+{
+	m_buf_num ^= 1;
+	m_bus.waitDone(m_bus_id,m_buf_serial[m_buf_num]);
+}
+
+
+void ILIBASE::waitIdle()
+{
+	m_bus.waitIdle(m_bus_id);
+}
+
+
+//------------------------------------------
+// shadow frame buffer
+//------------------------------------------
+
+void ILIBASE::flush()
+	// For each row of tiles, the tiles that were drawn to are
+	// hashed and compared to the hash of what was last sent.
+	// Runs of adjacent changed tiles are sent as one window.
+{
+	#if USE_ILI_SHADOW
+		for (u16 ty=0; ty<m_tiles_y; ty++)
+		{
+			int run_start = -1;
+			for (u16 tx=0; tx<=m_tiles_x; tx++)
+			{
+				bool changed = false;
+				if (tx < m_tiles_x)
+				{
+					u32 tile = ty * m_tiles_x + tx;
+					if (m_tile_dirty[tile])
+					{
+						u32 hash = tileHash(tx,ty);
+						if (m_tile_dirty[tile] == 2 ||
+							hash != m_tile_hash[tile])
+						{
+							m_tile_hash[tile] = hash;
+							changed = true;
+						}
+						m_tile_dirty[tile] = 0;
+					}
+				}
+				if (changed && run_start < 0)
+				{
+					run_start = tx;
+				}
+				else if (!changed && run_start >= 0)
+				{
+					sendTiles(run_start,tx-1,ty);
+					run_start = -1;
+				}
+			}
+		}
+	#endif
+
+	sendPixels();
+}
+
+
+#if USE_ILI_SHADOW
+
+	void ILIBASE::resetTiles()
+		// after a rotation the screen has to be sent in full
+	{
+		m_tiles_x = (GetWidth() + ILI_TILE_SIZE - 1) / ILI_TILE_SIZE;
+		m_tiles_y = (GetHeight() + ILI_TILE_SIZE - 1) / ILI_TILE_SIZE;
+		memset(m_tile_dirty,2,m_tiles_x * m_tiles_y);
+	}
+
+
+	void ILIBASE::setDirty(int xs, int ys, int xe, int ye)
+		// expects coordinates clipped to the screen
+	{
+		for (int ty=ys/ILI_TILE_SIZE; ty<=ye/ILI_TILE_SIZE; ty++)
+		{
+			u8 *p = &m_tile_dirty[ty * m_tiles_x + xs/ILI_TILE_SIZE];
+			for (int tx=xs/ILI_TILE_SIZE; tx<=xe/ILI_TILE_SIZE; tx++, p++)
+			{
+				if (!*p)
+					*p = 1;
+			}
+		}
+	}
+
+
+	u32 ILIBASE::tileHash(u16 tx, u16 ty)
+		// FNV-1a over the pixels of the tile
+	{
+		int width = GetWidth();
+		int xs = tx * ILI_TILE_SIZE;
+		int ys = ty * ILI_TILE_SIZE;
+		int xe = xs + ILI_TILE_SIZE;
+		int ye = ys + ILI_TILE_SIZE;
+		if (xe > width) xe = width;
+		if (ye > (int) GetHeight()) ye = GetHeight();
+
+		u32 hash = 2166136261;
+		for (int y=ys; y<ye; y++)
+		{
+			const u16 *p = &m_shadow[y * width + xs];
+			for (int x=xs; x<xe; x++)
+			{
+				hash ^= *p++;
+				hash *= 16777619;
+			}
+		}
+		return hash;
+	}
+
+
+	void ILIBASE::sendTiles(u16 tx0, u16 tx1, u16 ty)
+	{
+		int width = GetWidth();
+		int xs = tx0 * ILI_TILE_SIZE;
+		int ys = ty * ILI_TILE_SIZE;
+		int xe = (tx1 + 1) * ILI_TILE_SIZE - 1;
+		int ye = ys + ILI_TILE_SIZE - 1;
+		if (xe >= width) xe = width - 1;
+		if (ye >= (int) GetHeight()) ye = GetHeight() - 1;
+
+		startPixels(xs,ys,xe,ye);
+		for (int y=ys; y<=ye; y++)
+			pushPixels(&m_shadow[y * width + xs],xe - xs + 1);
+	}
+
+
+	// static
+	void ILIBASE::staticShadowPixel(void *pThis, u16 color)
+	{
+		assert(pThis);
+		ILIBASE *self = (ILIBASE*) pThis;
+		int x = self->m_area_x;
+		int y = self->m_area_y;
+		if (x >= 0 && y >= 0 &&
+			x < (int) self->GetWidth() &&
+			y < (int) self->GetHeight())
+			self->m_shadow[y * self->GetWidth() + x] = color;
+		if (++self->m_area_x > self->m_area_xe)
+		{
+			self->m_area_x = self->m_area_xs;
+			self->m_area_y++;
+		}
+	}
+
+#endif	// USE_ILI_SHADOW
+
+
 //------------------------------------------
 // optimized callback (ugui) routines
 //------------------------------------------
@@ -406,12 +735,28 @@ s8 ILIBASE::staticFillFrame(void *pThis, s16 x1, s16 y1, s16 x2, s16 y2, u16 col
 // static
 void *ILIBASE::staticFillArea(void *pThis, s16 x1, s16 y1, s16 x2, s16 y2)
 	// FillArea sets up the window and returns a pointer to pushPixel
-	// which is then called for each pixel to write it.
+	// which is then called for each pixel to write it.  The last
+	// partial buffer is sent when the window has been filled.
 {
 	assert(pThis);
 	ILIBASE *self = (ILIBASE*) pThis;
-	self->setWindow(x1,y1,x2,y2);
-	return (void *) &staticPushPixel;
+
+	#if USE_ILI_SHADOW
+		self->m_area_xs = self->m_area_x = x1;
+		self->m_area_xe = x2;
+		self->m_area_y = y1;
+
+		int xs = x1 < 0 ? 0 : x1;
+		int ys = y1 < 0 ? 0 : y1;
+		int xe = x2 >= (int) self->GetWidth() ? self->GetWidth() - 1 : x2;
+		int ye = y2 >= (int) self->GetHeight() ? self->GetHeight() - 1 : y2;
+		if (xe >= xs && ye >= ys)
+			self->setDirty(xs,ys,xe,ye);
+		return (void *) &staticShadowPixel;
+	#else
+		self->startPixels(x1,y1,x2,y2);
+		return (void *) &staticPushPixel;
+	#endif
 }
 
 
@@ -420,8 +765,36 @@ void ILIBASE::staticPushPixel(void *pThis, u16 color)
 {
 	assert(pThis);
 	ILIBASE *self = (ILIBASE*) pThis;
-	u8 buf[self->m_pixel_bytes];
-	self->color565ToBuf(color,buf);
-	self->m_pSPI->SetClock(self->m_write_freq);
-	self->m_pSPI->Write(0,buf,self->m_pixel_bytes);
+	self->pushPixel(color);
+}
+
+
+// static
+void ILIBASE::staticFlush(void *pThis)
+{
+	assert(pThis);
+	ILIBASE *self = (ILIBASE*) pThis;
+	self->flush();
+}
+
+
+// static
+void ILIBASE::staticBlit(void *pThis, s16 x1, s16 y1, s16 x2, s16 y2, const u16 *pixels, s32 stride)
+{
+	assert(pThis);
+	ILIBASE *self = (ILIBASE*) pThis;
+	if (x2 < x1 || y2 < y1)
+		return;
+
+	#if USE_ILI_SHADOW
+		u32 width = self->GetWidth();
+		u32 bytes = (x2 - x1 + 1) * sizeof(u16);
+		for (s16 y=y1; y<=y2; y++, pixels += stride)
+			memcpy(&self->m_shadow[y * width + x1],pixels,bytes);
+		self->setDirty(x1,y1,x2,y2);
+	#else
+		self->startPixels(x1,y1,x2,y2);
+		for (s16 y=y1; y<=y2; y++, pixels += stride)
+			self->pushPixels(pixels,x2 - x1 + 1);
+	#endif
 }
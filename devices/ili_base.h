@@ -2,15 +2,20 @@
 #define __ilibase_h__
 
 #include <circle/gpiopin.h>
+#include "spibus.h"
+	// which chooses the ILISPI_CLASS
 
-#define USE_BITBANG_SPI	0
+#define USE_ILI_SHADOW	1
+	// Draw into a RAM copy of the screen and only send the
+	// tiles that changed when flush() is called at the end
+	// of each UI frame.  Also gives us a working GetPixel().
+#define ILI_TILE_SIZE	16
 
-#if USE_BITBANG_SPI
-	#include "bangspi.h"
-	#define ILISPI_CLASS CBangSPI
-#else
-	#include <circle/spimaster.h>
-	#define ILISPI_CLASS CSPIMaster
+#ifndef SCREEN_OPT_FLUSH
+	#define SCREEN_OPT_FLUSH	3
+#endif
+#ifndef SCREEN_OPT_BLIT
+	#define SCREEN_OPT_BLIT		4
 #endif
 
 #include <circle/screen.h>
@@ -31,6 +36,11 @@
 #define RGB565_WHITE     0xFFFF
 
 
+#define ILI_BUFFER_PIXELS	1024
+#define ILI_BUFFER_BYTES	(ILI_BUFFER_PIXELS * 3)
+	// sized for the 3 byte 9488, 64 byte aligned for DMA
+
+
 
 class ILIBASE : public CScreenDeviceBase
 	// Base class of ILE TFT devices that take RGB565 colors.
@@ -55,12 +65,21 @@ public:
     /* virtual */ virtual unsigned GetWidth(void) const override;
     /* virtual */ virtual unsigned GetHeight(void) const override;
     /* virtual */ virtual void SetPixel(unsigned x, unsigned y, u16 color) override;
-    /* virtual */ virtual u16 GetPixel(unsigned x, unsigned y)  override { return 0; }
+    /* virtual */ virtual u16 GetPixel(unsigned x, unsigned y)  override;
 
     u8 getRotation() { return m_rotation; }
     void setRotation(u8 rotation);
     void fillRect(int xs, int ys, int xe, int ye, u16 color);
 
+	void waitIdle();
+		// waits for any pending pixel transfer to finish.
+	CSPIBus *getBus()	{ return &m_bus; }
+		// The display owns the SPI bus.  Other devices on it,
+		// i.e. the XPT2046, add themselves and go through it.
+	void flush();
+		// sends the changed tiles of the shadow frame buffer,
+		// or just the last partial buffer, without the shadow
+
     // static methods that can be registered with ugui
     // FillArea sets up the window and returns a pointer to pushPixel
     // which is then called for each pixel to write it.
@@ -68,6 +87,9 @@ public:
     static s8 staticFillFrame(void *pThis, s16 x1, s16 y1, s16 x2, s16 y2, u16 color);
     static void *staticFillArea(void *pThis, s16 x1, s16 y1, s16 x2, s16 y2);
     static void staticPushPixel(void *pThis, u16 color);
+    static void staticFlush(void *pThis);
+    static void staticBlit(void *pThis, s16 x1, s16 y1, s16 x2, s16 y2, const u16 *pixels, s32 stride);
+		// copies a clipped rectangle of RGB565 pixels
 
 	void distinctivePattern();
 		// outputs 20 pixel red square in upper left corner
@@ -88,7 +110,8 @@ protected:
 	u16			m_fixed_width;
 	u16			m_fixed_height;
 	u8			m_pixel_bytes;
-	ILISPI_CLASS *m_pSPI;
+	CSPIBus		m_bus;
+	u8			m_bus_id;
 	u32 		m_write_freq;
 	u32 		m_read_freq;
 	CGPIOPin    m_pinCD;
@@ -103,11 +126,65 @@ protected:
     void writeCommand(u8 command, u8 *data, u16 len);
     void setWindow(int xs, int ys, int xe, int ye);
 
+	// the pixel pipeline: startPixels() sets the window,
+	// and the buffer is sent when it is full, or when the
+	// last pixel of the window has been pushed.
+
+	void startPixels(int xs, int ys, int xe, int ye);
+	void pushPixel(u16 color);
+	void pushPixels(const u16 *colors, u32 count);
+		// a span of pixels, i.e. a line, converted in one pass
+	void sendPixels();
+	void sendBuffer(u8 *buf, u32 len);
+	void nextBuffer();
+		// switches to the other buffer, waiting for it
+		// to be sent if it is still queued on the bus
+
 	void dbgRead(const char *what, u8 command, u8 num_reply_bytes);
 
 	virtual void color565ToBuf(u16 color, u8 *buf) = 0;
 		// must be provided by derived class
 		// to provide m_pixel_bytes in buf
+	virtual void colors565ToBuf(const u16 *colors, u32 count, u8 *buf);
+		// count * m_pixel_bytes to buf.  The default calls
+		// color565ToBuf() for each pixel; derived classes
+		// should provide a faster one.
+
+	void benchmarkConvert();
+		// logs the time to convert a screen full of pixels
+		// with color565ToBuf() and with colors565ToBuf()
+
+private:
+
+	u32			m_pixels_left;
+	u32			m_buf_len;
+	u8			m_buf_num;
+	u8			m_buf[2][ILI_BUFFER_BYTES] __attribute__ ((aligned (64)));
+	u32			m_buf_serial[2];		// of the last bus transfer from the buffer
+
+	#if USE_ILI_SHADOW
+		u16			*m_shadow;
+		u8			*m_tile_dirty;		// 1=touched, 2=send regardless
+		u32			*m_tile_hash;		// of the tile as last sent
+		u16			m_tiles_x;
+		u16			m_tiles_y;
+		int			m_area_xs;			// staticFillArea() window
+		int			m_area_xe;
+		int			m_area_x;			// and where the next pixel goes
+		int			m_area_y;
+
+		void resetTiles();
+		void setDirty(int xs, int ys, int xe, int ye);
+		u32 tileHash(u16 tx, u16 ty);
+		void sendTiles(u16 tx0, u16 tx1, u16 ty);
+		static void staticShadowPixel(void *pThis, u16 color);
+	#endif
+
+	#if USE_SPI_DMA
+		u8		m_rx_buf[ILI_BUFFER_BYTES] __attribute__ ((aligned (64)));
+			// the DMA version needs somewhere to put the
+			// bytes it reads back, which we throw away
+	#endif
 
 };
 
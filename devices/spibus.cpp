@@ -0,0 +1,267 @@
+//---------------------------------------------------------
+// spibus.cpp
+//---------------------------------------------------------
+
+#include "spibus.h"
+#include <circle/logger.h>
+#include <circle/timer.h>
+#include <circle/synchronize.h>
+#include <circle/util.h>
+#include <utils/myUtils.h>
+
+
+#define log_name "spibus"
+
+
+
+CSPIBus::CSPIBus(ILISPI_CLASS *pSPI) :
+	m_pSPI(pSPI),
+	m_lock(IRQ_LEVEL)
+{
+	m_clock = 0;
+	m_num_clock_changes = 0;
+	m_num_devices = 0;
+	m_num_queued = 0;
+	m_hold = 0;
+	m_active = 0;
+	m_last_device = 0;
+	m_burst = 0;
+	m_start_time = 0;
+	memset(m_device,0,sizeof(m_device));
+	memset(&m_current,0,sizeof(m_current));
+	#if USE_SPI_DMA
+		m_pSPI->SetCompletionRoutine(dmaComplete,this);
+	#endif
+}
+
+
+u8 CSPIBus::addDevice(const char *name, u8 chip_select, u32 clock)
+{
+	assert(m_num_devices < SPI_BUS_MAX_DEVICES);
+	spiBusDevice_t *dev = &m_device[m_num_devices];
+	dev->name = name;
+	dev->chip_select = chip_select;
+	dev->clock = clock;
+	return m_num_devices++;
+}
+
+
+void CSPIBus::setClock(u8 device, u32 clock)
+{
+	m_device[device].clock = clock;
+}
+
+
+void CSPIBus::select(u8 device)
+	// only called when nothing is on the bus
+{
+	u32 clock = m_device[device].clock;
+	if (clock != m_clock)
+	{
+		m_pSPI->SetClock(clock);
+		m_clock = clock;
+		m_num_clock_changes++;
+	}
+}
+
+
+int CSPIBus::transfer(u8 device, const void *tx, void *rx, u32 len)
+{
+	spiBusDevice_t *dev = &m_device[device];
+
+	// stop the completion routine from starting anything
+	// else and wait for the transfer in progress, if any
+
+	m_lock.Acquire();
+	m_hold = 1;
+	while (m_active)
+	{
+		m_lock.Release();
+		m_lock.Acquire();
+	}
+	m_lock.Release();
+
+	select(device);
+	u32 start = CTimer::GetClockTicks();
+	#if USE_SPI_DMA
+		int rslt = m_pSPI->WriteReadSync(dev->chip_select,tx,rx,len);
+	#else
+		int rslt = rx ?
+			m_pSPI->WriteRead(dev->chip_select,tx,rx,len) :
+			m_pSPI->Write(dev->chip_select,tx,len);
+	#endif
+	dev->bus_time += CTimer::GetClockTicks() - start;
+	dev->num_transfers++;
+
+	m_lock.Acquire();
+	m_hold = 0;
+	m_last_device = device;
+	m_burst = 1;
+	startNext();
+	m_lock.Release();
+
+	return rslt;
+}
+
+
+u32 CSPIBus::start(u8 device, const void *tx, void *rx, u32 len,
+	spiBusCallback *callback, void *param)
+{
+	spiBusDevice_t *dev = &m_device[device];
+
+	#if USE_SPI_DMA
+
+		assert(rx);
+		m_lock.Acquire();
+		while (m_num_queued == SPI_BUS_QUEUE_SIZE)
+		{
+			m_lock.Release();
+			m_lock.Acquire();
+		}
+
+		spiBusTransfer_t *xfer = &m_queue[m_num_queued++];
+		xfer->device = device;
+		xfer->tx = tx;
+		xfer->rx = rx;
+		xfer->len = len;
+		xfer->callback = callback;
+		xfer->param = param;
+		u32 serial = ++dev->num_started;
+		startNext();
+		m_lock.Release();
+
+	#else
+
+		u32 serial = ++dev->num_started;
+		transfer(device,tx,rx,len);
+		if (callback)
+			(*callback)(param);
+		dev->num_done = serial;
+
+	#endif
+
+	return serial;
+}
+
+
+void CSPIBus::startNext()
+	// Does nothing if a transfer is in progress or being held for.
+	// Otherwise takes the oldest transfer for the last device, if it
+	// has not had its SPI_BUS_MAX_BURST turns yet, or else the oldest.
+{
+	if (m_active || m_hold || !m_num_queued)
+		return;
+
+	u8 i = 0;
+	if (m_burst < SPI_BUS_MAX_BURST)
+	{
+		for (u8 j=0; j<m_num_queued; j++)
+		{
+			if (m_queue[j].device == m_last_device)
+			{
+				i = j;
+				break;
+			}
+		}
+	}
+
+	m_current = m_queue[i];
+	m_num_queued--;
+	for (; i<m_num_queued; i++)
+		m_queue[i] = m_queue[i+1];
+
+	if (m_current.device == m_last_device)
+	{
+		m_burst++;
+	}
+	else
+	{
+		m_last_device = m_current.device;
+		m_burst = 1;
+	}
+
+	#if USE_SPI_DMA
+		select(m_current.device);
+		m_active = 1;
+		m_start_time = CTimer::GetClockTicks();
+		m_pSPI->StartWriteRead(
+			m_device[m_current.device].chip_select,
+			m_current.tx,
+			m_current.rx,
+			m_current.len);
+	#endif
+}
+
+
+#if USE_SPI_DMA
+	// static
+	void CSPIBus::dmaComplete(boolean bStatus, void *pParam)
+		// called at interrupt time
+	{
+		assert(pParam);
+		CSPIBus *self = (CSPIBus *) pParam;
+		if (!bStatus)
+			LOG_ERROR("SPI DMA transfer failed",0);
+
+		spiBusTransfer_t done = self->m_current;
+		if (done.callback)
+			(*done.callback)(done.param);
+
+		// the next transfer is claimed before this one is counted
+		// as done, so that a waiter cannot queue into a bus that
+		// it thinks is idle while we are starting it
+
+		self->m_lock.Acquire();
+		spiBusDevice_t *dev = &self->m_device[done.device];
+		dev->bus_time += CTimer::GetClockTicks() - self->m_start_time;
+		dev->num_transfers++;
+		self->m_active = 0;
+		self->startNext();
+		dev->num_done++;
+		self->m_lock.Release();
+	}
+#endif
+
+
+void CSPIBus::waitDone(u8 device, u32 serial)
+{
+	spiBusDevice_t *dev = &m_device[device];
+	while ((s32) (dev->num_done - serial) < 0)
+	{
+	}
+	DataMemBarrier();
+}
+
+
+void CSPIBus::waitIdle(u8 device)
+{
+	waitDone(device,m_device[device].num_started);
+}
+
+
+void CSPIBus::waitIdle()
+{
+	m_lock.Acquire();
+	while (m_num_queued || m_active)
+	{
+		m_lock.Release();
+		m_lock.Acquire();
+	}
+	m_lock.Release();
+}
+
+
+void CSPIBus::logStats()
+{
+	for (u8 i=0; i<m_num_devices; i++)
+	{
+		spiBusDevice_t *dev = &m_device[i];
+		LOG("%-8s cs(%d) clock(%d) transfers(%d) bus_time(%d us)",
+			dev->name,
+			dev->chip_select,
+			dev->clock,
+			dev->num_transfers,
+			dev->bus_time);
+	}
+	LOG("clock changes(%d)",m_num_clock_changes);
+}
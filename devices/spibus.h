@@ -0,0 +1,160 @@
+//---------------------------------------------------------
+// spibus.h
+//---------------------------------------------------------
+// The ILI display and the XPT2046 touch controller share one
+// SPI master, at very different clock rates, on chip selects 0
+// and 1.  CSPIBus owns the master and all traffic goes through it.
+//
+// The UI core queues the transfers, but the DMA completion interrupt
+// happens on core 0, so the queue and the flags that are handed back
+// and forth are only touched while holding an IRQ level spin lock.
+//
+// Asynchronous (DMA) transfers are queued with start(), and the
+// completion interrupt starts the next one, preferring another
+// transfer for the same device, up to SPI_BUS_MAX_BURST in a row,
+// so that the clock is not changed back and forth.  A synchronous
+// transfer() holds the queue, waits for the transfer in progress
+// (at most one ILI_BUFFER_BYTES sized burst) and goes next, so a
+// touch read never waits behind a whole frame of pixels.
+//
+// The bus keeps the time it spent on each device, in microseconds,
+// along with the number of transfers, and the number of times the
+// clock had to be changed.
+//
+// All methods are to be called from the same core as the UI,
+// as the SPI master is not otherwise protected.
+
+#ifndef __spibus_h__
+#define __spibus_h__
+
+#include <circle/types.h>
+#include <circle/spinlock.h>
+
+#define USE_BITBANG_SPI	0
+#define USE_SPI_DMA		1
+	// Pixels are sent in ILI_BUFFER_PIXELS sized chunks.
+	// With DMA the chunks are double buffered, so the next one
+	// is converted while the previous one is being sent.
+
+#if USE_BITBANG_SPI
+	#undef USE_SPI_DMA
+	#define USE_SPI_DMA 0
+	#include "bangspi.h"
+	#define ILISPI_CLASS CBangSPI
+#elif USE_SPI_DMA
+	#include <circle/spimasterdma.h>
+	#define ILISPI_CLASS CSPIMasterDMA
+		// which must be constructed with the interrupt system
+#else
+	#include <circle/spimaster.h>
+	#define ILISPI_CLASS CSPIMaster
+#endif
+
+
+#define SPI_BUS_MAX_DEVICES		4
+#define SPI_BUS_QUEUE_SIZE		8
+#define SPI_BUS_MAX_BURST		4
+	// queued transfers for one device before another gets a turn
+
+
+typedef void spiBusCallback(void *pParam);
+	// called at interrupt time when an asynchronous
+	// transfer is finished, in DMA builds
+
+
+typedef struct
+{
+	const char *name;
+	u8  chip_select;
+	u32 clock;
+	u32 num_transfers;
+	u32 bus_time;				// us
+	u32 num_started;			// asynchronous transfers queued so far
+	volatile u32 num_done;		// and finished
+}	spiBusDevice_t;
+
+
+typedef struct
+{
+	u8 device;
+	const void *tx;
+	void *rx;
+	u32 len;
+	spiBusCallback *callback;
+	void *param;
+}	spiBusTransfer_t;
+
+
+class CSPIBus
+{
+public:
+
+	CSPIBus(ILISPI_CLASS *pSPI);
+
+	u8 addDevice(const char *name, u8 chip_select, u32 clock);
+		// returns the device number to use in other calls
+	void setClock(u8 device, u32 clock);
+		// the clock is only sent to the master when a transfer
+		// for the device follows one at a different rate
+
+	int transfer(u8 device, const void *tx, void *rx, u32 len);
+		// synchronous, rx may be 0 for writes.
+		// returns the number of bytes transferred, or < 0 on error
+	u32 start(u8 device, const void *tx, void *rx, u32 len,
+		spiBusCallback *callback=0, void *param=0);
+		// queues an asynchronous transfer, or does it synchronously
+		// without DMA.  The DMA version needs an rx buffer to put
+		// the bytes it reads back.  Waits if the queue is full.
+		// Returns the transfer's serial number for waitDone().
+
+	void waitDone(u8 device, u32 serial);
+		// until the device's transfer with the given serial number,
+		// and so all of the ones before it, have finished.
+	void waitIdle(u8 device);
+		// until none of the device's transfers are queued or running
+	void waitIdle();
+
+	const char *getName(u8 device)		{ return m_device[device].name; }
+	u32 getBusTime(u8 device)			{ return m_device[device].bus_time; }
+	u32 getNumTransfers(u8 device)		{ return m_device[device].num_transfers; }
+	u32 getNumClockChanges()			{ return m_num_clock_changes; }
+	u8  getNumDevices()					{ return m_num_devices; }
+	void logStats();
+
+private:
+
+	ILISPI_CLASS *m_pSPI;
+	CSpinLock m_lock;
+	u32 m_clock;					// as last set on the master
+	u32 m_num_clock_changes;
+
+	u8 m_num_devices;
+	spiBusDevice_t m_device[SPI_BUS_MAX_DEVICES];
+
+	// the queue is kept in order, and is short enough
+	// to just shift down when a transfer is taken out
+
+	u8 m_num_queued;
+	spiBusTransfer_t m_queue[SPI_BUS_QUEUE_SIZE];
+
+	// these are only changed with m_lock held
+
+	u8 m_hold;						// a synchronous transfer is waiting
+	u8 m_active;					// a DMA transfer is in progress
+	spiBusTransfer_t m_current;
+	u8 m_last_device;
+	u8 m_burst;						// transfers in a row for m_last_device
+	u32 m_start_time;
+
+	void select(u8 device);
+	void startNext();
+		// called with m_lock held
+
+	#if USE_SPI_DMA
+		static void dmaComplete(boolean bStatus, void *pParam);
+	#endif
+
+};
+
+
+#endif      // !__spibus_h__
@@ -22,8 +22,14 @@
 //	      and taking the average
 //      - keeping a circular buffer of samples
 //
-// I am re-implementing this to initially do NO multi-sampling
-// just to see how it works.
+// This implementation samples on its own schedule in poll(), which
+// is called from the main loop, at XPT_SAMPLE_RATE.  When nobody is
+// touching the screen it only reads the PENIRQ pin, so the UI does
+// not pay for any SPI transfers.  While touched, each sample is put
+// in a small ring, and the output is the median of the last three
+// (which throws out single sample spikes) run through a simple IIR.
+// Down and up are debounced over XPT_DEBOUNCE samples, which also
+// throws away the first, noisy, sample of a touch.
 //
 // CALIBRATION
 //
@@ -64,7 +70,7 @@
 // #define PIN_MISO        	9	// default rPi SPI MISO
 // #define PIN_MOSI        	10	// default rPi SPI MOSI
 // #define PIN_SCLK        	11	// default rPi SPI SCLK
-// #define PIN_TP_IRQ      	17	// we are not using the touch IRQ
+// #define PIN_TP_IRQ      	17	// XPT_PIN_IRQ in xpt2046.h
 // #define PIN_CD          	24	// for the LCD only - not used by XPT2046
 // #define PIN_RESET       	25	// not used on XPT2046, or ILI9488, for that matter
 
@@ -99,6 +105,9 @@
 		// 0xC9 = 100 = +REF=YP -REF=XN +IN=YN m=Z2_position drivers=YP
 #define XPT_READ_X		(XPT_START_BIT | (0x5 << 4) | XPT_POWER_ADC)
 		// 0xD1 = 101 = +REF=XP -REF=XN +IN=YP m=X_position  drivers=XP
+#define XPT_READ_Y_PD	(XPT_START_BIT | (0x1 << 4))
+		// 0x90 = the last read of a sample powers down, which
+		// is the only mode in which PENIRQ is enabled
 
 
 //------------------------------------------------
@@ -132,10 +141,14 @@ XPT2046::~XPT2046()
 
 
 XPT2046::XPT2046(ILISPI_CLASS *pSPI, ILIBASE *pTFT) :
-    m_pSPI(pSPI),
 	m_pTFT(pTFT),
+	m_pBus(pTFT->getBus()),
 	m_pFileSystem(0)
+	#if XPT_PIN_IRQ
+		,m_penirq(XPT_PIN_IRQ,GPIOModeInputPullUp)
+	#endif
 {
+	m_bus_id = m_pBus->addDevice("xpt2046",1,SPI_FREQ);
 	m_rotation = pTFT->getRotation();
     m_width = pTFT->GetWidth();
     m_height = pTFT->GetHeight();
@@ -147,6 +160,15 @@ XPT2046::XPT2046(ILISPI_CLASS *pSPI, ILIBASE *pTFT) :
     m_lasty = 0;
     m_lastz = 0;
 
+	m_sample_time = 0;
+	m_touching = 0;
+	m_debounce = 0;
+	m_pressure = 0;
+	m_num_samples = 0;
+	m_filt_x = 0;
+	m_filt_y = 0;
+	memset(m_ring,0,sizeof(m_ring));
+
 	// arbitrary starting calibration values from
 	// emprical testing on a orange ILI9488 device
 
@@ -173,8 +195,7 @@ u16 XPT2046::transfer16(u8 reg)
 	buf[0] = reg;
 	buf[1] = 0;
 	buf[2] = 0;
-	m_pSPI->SetClock(SPI_FREQ);
-	int rslt = m_pSPI->WriteRead(1,buf,buf,3);
+	int rslt = m_pBus->transfer(m_bus_id,buf,buf,3);
 	CTimer::Get()->usDelay(5);
 	assert(rslt == 3);
 
@@ -210,8 +231,100 @@ u16 XPT2046::transfer16(u8 reg)
 #define swap(i,j)  { s16 tmp; tmp=i; i=j; j=tmp; }
 
 
+static u16 median3(u16 a, u16 b, u16 c)
+{
+	if (a > b) { u16 t=a; a=b; b=t; }
+	if (b > c) b = c;
+	return a > b ? a : b;
+}
+
+
+void XPT2046::poll()
+{
+	u32 now = CTimer::GetClockTicks();
+	if (now - m_sample_time < CLOCKHZ / XPT_SAMPLE_RATE)
+		return;
+	m_sample_time = now;
+
+	// PENIRQ is high when nobody is touching, and we only
+	// need to keep sampling after a touch to see it let up
+
+	#if XPT_PIN_IRQ
+		if (!m_touching && !m_debounce && m_penirq.Read())
+			return;
+	#endif
+
+	sample();
+}
+
+
+void XPT2046::sample()
+	// Another thing the doc just completely fails to describe
+	// is what are z1 and z2 and how to use them.  From the
+	// TFT_ESPI implementation, I gleaned this weird bit of
+	// code that subtracts z2 from z1 and biases it by full scale,
+	// which goes up with pressure, and which we keep as the
+	// pressure estimate.  Whether it is a touch at all is still
+	// decided by z1 being non-zero.
+{
+	// 8 bit mode results come back in the top of the 12 bits
+
+	u16 z1 = transfer16(XPT_READ_Z1) >> 4;		// 0xB9
+	u16 z2 = transfer16(XPT_READ_Z2) >> 4;		// 0xC9
+	u16 x  = transfer16(XPT_READ_X);			// 0xD1
+	u16 y  = transfer16(XPT_READ_Y_PD);			// 0x90
+
+	bool z = z1 != 0;
+	m_pressure = z ? 0xff + z1 - z2 : 0;
+	if (m_pressure > 0xff)
+		m_pressure = 0xff;
+
+	#if DEBUG_TOUCH
+		LOG("z1(%3d) z2(%3d) pressure(%3d) x(%5d) y(%5d)",z1,z2,m_pressure,x,y);
+	#endif
+
+	// debounce
+
+	if (z != m_touching)
+	{
+		if (++m_debounce < XPT_DEBOUNCE)
+			return;
+		m_touching = z;
+		m_num_samples = 0;
+	}
+	m_debounce = 0;
+	if (!z)
+		return;
+
+	// ring, median, and IIR, starting the filter
+	// at the first sample of a touch
+
+	u32 n = m_num_samples++;
+	m_ring[n & (XPT_RING_SIZE-1)].x = x;
+	m_ring[n & (XPT_RING_SIZE-1)].y = y;
+
+	if (n < 2)
+	{
+		m_filt_x = x << 4;
+		m_filt_y = y << 4;
+		return;
+	}
+
+	const xptSample_t *a = &m_ring[(n-2) & (XPT_RING_SIZE-1)];
+	const xptSample_t *b = &m_ring[(n-1) & (XPT_RING_SIZE-1)];
+	const xptSample_t *c = &m_ring[n & (XPT_RING_SIZE-1)];
+	s32 mx = median3(a->x,b->x,c->x);
+	s32 my = median3(a->y,b->y,c->y);
+	m_filt_x += ((mx << 4) - m_filt_x) >> XPT_IIR_SHIFT;
+	m_filt_y += ((my << 4) - m_filt_y) >> XPT_IIR_SHIFT;
+}
+
+
 void XPT2046::Update()
+	// called at the UI frame rate
 {
+	poll();
+
 	// Cancel or advance the calibration phase based on timer
 
 	if (m_calibration_phase)
@@ -257,38 +370,14 @@ void XPT2046::Update()
 		}
 	}
 
-	// Another thing the doc just completely fails to describe
-	// is what are z1 and z2 and how to use them.  From the
-	// TFT_ESPI implementation, I gleaned this weird bit of
-	// code that subtracts z2 from z1 and biases it by 0xfff,
-	// then uses a threshold (350 typically).  In the end
-	// I went with my MUCH simpler code.
-
-	#if 0
-		#define Z_THRESH  128
-		s16 z1 = transfer16(0xB0);
-		s16 z2 = transfer16(0xC0);
-		s16 z3 = 0xfff + z1 - z2;
-		s16 z = z3 > Z_THRESH ? 1 : 0;
-	#else
-		// read z1 three times and only set z to 1 if all three have values
-		s16 z1 = transfer16(XPT_READ_Z1);	// 0xB9
-		s16 z2 = transfer16(XPT_READ_Z1);	// 0xB9
-		s16 z3 = transfer16(XPT_READ_Z1);	// 0xB9
-		s16 z = z1 && z2 && z3 ? 1 : 0;
-	#endif
-
-	// x and y are only valid if z, so
-	// if z, get, then scale and rotate x and y
+	// x and y are only valid while touching, so
+	// if z, get the filtered values, then scale and rotate them
 
+	s16 z = m_touching;
 	if (z)
 	{
-		s16 x  = transfer16(XPT_READ_X);	// 0xD1
-		s16 y  = transfer16(XPT_READ_Y);	// 0x91
-
-		#if DEBUG_TOUCH
-			LOG("z(%5d) z1(%5d) z2(%5d) z3(%5d) x(%5d) y(%5d)",z,z1,z2,z3,x,y);
-		#endif
+		s16 x = m_filt_x >> 4;
+		s16 y = m_filt_y >> 4;
 
 		if (m_calibration_phase)
 		{
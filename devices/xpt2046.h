@@ -5,29 +5,62 @@
 #include <circle/spimaster.h>
 #include <circle/screen.h>
 #include <circle/input/touchscreen.h>
+#include <circle/gpiopin.h>
 #include <fatfs/ff.h>
 #include "ili_base.h"
 
 
+#define XPT_PIN_IRQ         17
+    // The PENIRQ pin, which goes low while the screen is touched.
+    // Define as 0 if it is not wired, and poll() will do SPI
+    // transfers at XPT_SAMPLE_RATE all the time.
+#define XPT_SAMPLE_RATE     200     // per second, while touched
+#define XPT_RING_SIZE       4       // raw samples, power of 2
+#define XPT_DEBOUNCE        2       // samples to agree on a down or up
+#define XPT_IIR_SHIFT       1       // each sample moves the output 1/2 of the way
+
+
+typedef struct
+{
+    u16 x;
+    u16 y;
+}   xptSample_t;
+
+
 class XPT2046 : public CTouchScreenBase
     // Constructed in context of a TFT CScreenDeviceBase (i.e. ili9486).
 	// You must call setRotation() at startup and whenever the
 	// display device is rotated.
     //
-	// Furthermore you must take care to call Update() from
-    // the same thread/processor as any UI drawing routines,
-    // inasmuch as both use the SPIMaster object which is not
-    // otherwise protected.
+	// Furthermore you must take care to call poll() and Update()
+    // from the same thread/processor as any UI drawing routines,
+    // inasmuch as both use the TFT's CSPIBus, which is not
+    // otherwise protected.  Touch reads go ahead of any queued
+    // pixels, after the one being sent.
+    //
+    // poll() should be called as often as possible, i.e. every
+    // time through the main loop.  It samples at XPT_SAMPLE_RATE,
+    // but only while the PENIRQ pin says the screen is touched,
+    // into a small ring, and filters the samples with a median of
+    // three followed by an IIR.  Update() is called at the UI frame
+    // rate, and only turns the filtered state into events.
 {
 public:
 
     XPT2046(ILISPI_CLASS *pSPI, ILIBASE *pTFT);
 		// Constructed with knowledge abou the fixed
-		// physical width and height in rotation 0
+		// physical width and height in rotation 0.
+		// pSPI is no longer used; it goes through pTFT->getBus()
     ~XPT2046();
 
     void setRotation(u8 rotation);
 	virtual void Update(void) override;
+    void poll();
+
+    u16 getPressure()           { return m_pressure; }
+        // 0..255, larger is a firmer touch, from the last sample
+    bool isTouched()            { return m_touching; }
+        // debounced, as of the last sample
 
 	void Initialize(FATFS *pFileSystem);
 	void startCalibration();
@@ -35,8 +68,9 @@ public:
 
 protected:
 
-    ILISPI_CLASS *m_pSPI;
 	ILIBASE    *m_pTFT;
+	CSPIBus    *m_pBus;			// owned by the TFT
+	u8          m_bus_id;
 	FATFS 	   *m_pFileSystem;
 
     u8  m_rotation;
@@ -47,6 +81,22 @@ protected:
     u16 m_lasty;
     u16 m_lastz;
 
+    // sampling state
+
+    #if XPT_PIN_IRQ
+        CGPIOPin m_penirq;
+    #endif
+    u32 m_sample_time;
+    bool m_touching;                // debounced
+    u8  m_debounce;                 // samples that disagree with m_touching
+    u16 m_pressure;
+    u32 m_num_samples;              // since the touch started
+    xptSample_t m_ring[XPT_RING_SIZE];
+    s32 m_filt_x;                   // IIR output << 4
+    s32 m_filt_y;
+
+    void sample();
+
 	s16 m_min_x;
 	s16 m_max_x;
 	s16 m_min_y;
@@ -4,8 +4,16 @@
 // from the input device to the output device to verify that
 // both input and outputs work.  For the Octo, the six inputs
 // are mapped to the first 6 outputs.
+//
+// With USE_AUDIO_GRAPH the input and output streams and their
+// connections are not static objects, but are built by
+// AudioGraph::load() from a descriptor on the SD card.  Build the
+// descriptors from the passthru_*.txt files with "make graph" and
+// copy the .grf for your codec to the root of the SD card.  The
+// codec itself is still a static object in either case.
 
 #include <audio\Audio.h>
+#include <audio\AudioGraph.h>
 
 // You must define one of the following.
 
@@ -14,6 +22,18 @@
 #define USE_STGL5000            1
 #define USE_TEENSY_QUAD_SLAVE   0
 
+#define USE_AUDIO_GRAPH         1
+
+#if USE_AUDIO_GRAPH
+    #if USE_CS42448
+        #define GRAPH_FILENAME  "SD:/passthru_tdm.grf"
+    #elif USE_TEENSY_QUAD_SLAVE
+        #error The teensy quad devices are not in AudioGraphFormat.h
+    #else
+        #define GRAPH_FILENAME  "SD:/passthru_i2s.grf"
+    #endif
+#endif
+
 // prh 2024-05-27 - this program has not been tested in ages.
 //
 // Initial attempt to turn on SGTL5000 revealed that I removed
@@ -33,8 +53,10 @@
 #if USE_CS42448
 
     // Octo is always the master
-    AudioInputTDM input;
-    AudioOutputTDM output;
+    #if !USE_AUDIO_GRAPH
+        AudioInputTDM input;
+        AudioOutputTDM output;
+    #endif
     AudioControlCS42448 control;
 
 #elif USE_TEENSY_QUAD_SLAVE
@@ -46,8 +68,10 @@
 
     // the rpi cannot be a master to an sgtl5000.
     // the sgtl5000 requires 3 clocks and the rpi can only generate 2
-    AudioInputI2S input;
-    AudioOutputI2S output;
+    #if !USE_AUDIO_GRAPH
+        AudioInputI2S input;
+        AudioOutputI2S output;
+    #endif
         // AudioInputI2Sslave input;
         // AudioOutputI2Sslave output;
 
@@ -61,8 +85,10 @@
         // the rPi is a horrible i2s master.
         // It is better with the wm831 as the master i2s device
 
-    AudioInputI2S input;
-    AudioOutputI2S output;
+    #if !USE_AUDIO_GRAPH
+        AudioInputI2S input;
+        AudioOutputI2S output;
+    #endif
 
     #if I2S_MASTER
         AudioControlWM8731 control;
@@ -73,13 +99,15 @@
 #endif
 
 
-AudioConnection  o0(input, 0, output, 0);
-AudioConnection  o1(input, 1, output, 1);
-#if USE_CS42448
-    AudioConnection  o2(input, 2, output, 2);
-    AudioConnection  o3(input, 3, output, 3);
-    AudioConnection  o4(input, 4, output, 4);
-    AudioConnection  o5(input, 5, output, 5);
+#if !USE_AUDIO_GRAPH
+    AudioConnection  o0(input, 0, output, 0);
+    AudioConnection  o1(input, 1, output, 1);
+    #if USE_CS42448
+        AudioConnection  o2(input, 2, output, 2);
+        AudioConnection  o3(input, 3, output, 3);
+        AudioConnection  o4(input, 4, output, 4);
+        AudioConnection  o5(input, 5, output, 5);
+    #endif
 #endif
 
 
@@ -90,7 +118,19 @@ void setup()
     // The audio memory system can now be instantiated
     // with very large buffers ..
     
-    AudioSystem::initialize(150);
+    #if USE_AUDIO_GRAPH
+        // load() constructs the streams and then
+        // initializes the AudioSystem itself
+        if (!AudioGraph::load(GRAPH_FILENAME))
+        {
+            printf("could not load %s\n",GRAPH_FILENAME);
+            return;
+        }
+        printf("%s: %d devices in %d bytes\n",GRAPH_FILENAME,
+            AudioGraph::getNumDevices(),AudioGraph::getArenaBytes());
+    #else
+        AudioSystem::initialize(150);
+    #endif
     
     // The audio system now starts any i2s devices,
     // so you don't need to call control.enable().
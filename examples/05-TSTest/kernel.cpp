@@ -125,8 +125,8 @@ CKernel::CKernel(void) :
 	#if USE_READY_PIN
 		,m_ReadyPin(USE_READY_PIN,GPIOModeOutput)
 	#endif
-	#if USE_ILI_DEVICE
-		,m_SPI()
+	#if USE_ILI_DEVICE && USE_SPI_DMA
+		,m_SPI(&m_Interrupt)
 	#endif
 {
 	m_ActLED.Toggle();
@@ -292,6 +292,10 @@ TShutdownMode CKernel::Run(void)
 				}
 
 				m_xpt2046->Update();
+				m_tft_device->flush();
+					// with USE_ILI_SHADOW nothing reaches the screen
+					// until flush(), which the wsApplication would
+					// otherwise call at the end of every frame
 				#if DEBUG_TOUCH
 					CTimer::Get()->MsDelay(100);
 				#else
@@ -90,7 +90,7 @@ void awsLoopTrackButton::onUpdateTouch(bool touched)
 			m_ltb_state = 0;
 	}
 	
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 }
 
 
@@ -105,7 +105,7 @@ void awsLoopTrackButton::onUpdateClick()
 	if (m_ltb_state >= NUM_STATES)
 		m_ltb_state = 0;
 	
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 	
 	//	getApplication()->addEvent(new wsEvent(
 	//		EVT_TYPE_BUTTON,
@@ -196,5 +196,5 @@ void awsLoopTrackButton::handleMidiEvent(midiEvent *event)
 			m_ltb_state = 0;
 	}
 	
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 }
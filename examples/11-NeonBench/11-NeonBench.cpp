@@ -0,0 +1,260 @@
+// 11-NeonBench.cpp
+//
+// Times the basic arm_math kernels in the audio library against
+// plain C reference loops, for block sizes from 32 to 1024, and
+// checks that both give the same results.
+//
+// The audio library selects the NEON versions in arm_math_neon.cpp
+// at compile time (unless ARM_MATH_NO_NEON is defined), so with
+// a normal build this compares scalar against NEON throughput.
+//
+// The results are printed to the serial port as CSV:
+//
+//     kernel,block_size,scalar_us,library_us,speedup,match
+//
+// No audio devices are needed or started.
+
+#include <system/std_kernel.h>
+#include <audio\Audio.h>
+#include <audio\arm_math.h>
+
+
+#define MAX_BLOCK       1024
+#define TOTAL_SAMPLES   (256 * 1024)
+    // each measurement runs enough iterations to process
+    // this many samples, so that the microsecond timer
+    // gives a useful resolution at every block size
+
+
+static q31_t  a31[MAX_BLOCK];
+static q31_t  b31[MAX_BLOCK];
+static q31_t  r31[MAX_BLOCK];
+static q31_t  n31[MAX_BLOCK];
+static q15_t  a15[MAX_BLOCK];
+static q15_t  b15[MAX_BLOCK];
+static q15_t  r15[MAX_BLOCK];
+static q15_t  n15[MAX_BLOCK];
+static float32_t af[MAX_BLOCK];
+static float32_t rf[MAX_BLOCK];
+static float32_t nf[MAX_BLOCK];
+
+
+//------------------------------------------
+// scalar references
+//------------------------------------------
+// These follow the CMSIS reference code.  They are kept out
+// of line so the compiler does not vectorize them into the
+// benchmark loop.
+
+#define NOINLINE  __attribute__((noinline, optimize("no-tree-vectorize")))
+
+NOINLINE static void ref_add_q31(q31_t *a, q31_t *b, q31_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = clip_q63_to_q31((q63_t) *a++ + *b++);
+}
+
+NOINLINE static void ref_shift_q31(q31_t *a, int8_t shift, q31_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = shift >= 0 ?
+            clip_q63_to_q31((q63_t) *a++ << shift) :
+            *a++ >> -shift;
+}
+
+NOINLINE static void ref_q15_to_q31(q15_t *a, q31_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = (q31_t) *a++ << 16;
+}
+
+NOINLINE static void ref_q31_to_q15(q31_t *a, q15_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = (q15_t) (*a++ >> 16);
+}
+
+NOINLINE static void ref_float_to_q31(float32_t *a, q31_t *d, uint32_t n)
+{
+    while (n--)
+    {
+        float32_t in = *a++ * 2147483648.0f;
+        #ifdef ARM_MATH_ROUNDING
+            in += in > 0.0f ? 0.5f : -0.5f;
+        #endif
+        *d++ = clip_q63_to_q31((q63_t) in);
+    }
+}
+
+NOINLINE static void ref_mult_q31(q31_t *a, q31_t *b, q31_t *d, uint32_t n)
+{
+    while (n--)
+    {
+        q31_t out = (q31_t) (((q63_t) *a++ * *b++) >> 32);
+        *d++ = __SSAT(out, 31) << 1u;
+    }
+}
+
+NOINLINE static void ref_mult_q15(q15_t *a, q15_t *b, q15_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = (q15_t) __SSAT(((q31_t) *a++ * *b++) >> 15, 16);
+}
+
+NOINLINE static void ref_scale_q31(q31_t *a, q31_t scale, int8_t shift, q31_t *d, uint32_t n)
+{
+    int8_t kShift = shift + 1;
+    while (n--)
+    {
+        q31_t in = (q31_t) (((q63_t) *a++ * scale) >> 32);
+        *d++ = kShift >= 0 ?
+            clip_q63_to_q31((q63_t) in << kShift) :
+            in >> -kShift;
+    }
+}
+
+NOINLINE static void ref_scale_q15(q15_t *a, q15_t scale, int8_t shift, q15_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = (q15_t) __SSAT(((q31_t) *a++ * scale) >> (15 - shift), 16);
+}
+
+NOINLINE static void ref_fill_q31(q31_t value, q31_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = value;
+}
+
+NOINLINE static void ref_copy_q15(q15_t *a, q15_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = *a++;
+}
+
+NOINLINE static void ref_copy_f32(float32_t *a, float32_t *d, uint32_t n)
+{
+    while (n--)
+        *d++ = *a++;
+}
+
+
+//------------------------------------------
+// test vectors
+//------------------------------------------
+
+static u32 s_seed = 0x12345678;
+
+static u32 rand32()
+{
+    s_seed = s_seed * 1664525 + 1013904223;
+    return s_seed;
+}
+
+
+static void fillVectors()
+{
+    for (u16 i=0; i<MAX_BLOCK; i++)
+    {
+        // include the extremes so saturation is exercised
+        a31[i] = (i & 63) == 0 ? 0x80000000 : (i & 63) == 1 ? 0x7fffffff : rand32();
+        b31[i] = (i & 63) == 2 ? 0x7fffffff : rand32();
+        a15[i] = (i & 63) == 0 ? -32768 : (i & 63) == 1 ? 32767 : (q15_t) rand32();
+        b15[i] = (i & 63) == 2 ? 32767 : (q15_t) rand32();
+        af[i] = ((float) (s32) rand32()) / 1073741824.0;    // +/- 2.0
+    }
+}
+
+
+//------------------------------------------
+// timing
+//------------------------------------------
+
+#define TIME_IT(result, call) \
+    { \
+        u32 loops = TOTAL_SAMPLES / n; \
+        u32 start = CTimer::GetClockTicks(); \
+        for (u32 i=0; i<loops; i++) \
+            call; \
+        result = CTimer::GetClockTicks() - start; \
+    }
+
+#define BENCH(name, ref_call, lib_call, ref_out, lib_out) \
+    { \
+        u32 ref_us; \
+        u32 lib_us; \
+        TIME_IT(ref_us, ref_call); \
+        TIME_IT(lib_us, lib_call); \
+        bool match = !memcmp(ref_out, lib_out, n * sizeof(ref_out[0])); \
+        if (!match) num_fail++; \
+        printf("%s,%u,%u,%u,%0.2f,%s\n", name, n, ref_us, lib_us, \
+            lib_us ? ((float) ref_us) / lib_us : 0.0, \
+            match ? "ok" : "FAIL"); \
+    }
+
+
+void setup()
+{
+    printf("11-NeonBench::setup()\n");
+
+    #ifdef ARM_MATH_NEON
+        printf("library kernels: NEON\n");
+    #else
+        printf("library kernels: scalar\n");
+    #endif
+
+    fillVectors();
+    u16 num_fail = 0;
+
+    printf("kernel,block_size,scalar_us,library_us,speedup,match\n");
+    for (u32 n=32; n<=MAX_BLOCK; n<<=1)
+    {
+        BENCH("add_q31",
+            ref_add_q31(a31, b31, r31, n),
+            arm_add_q31(a31, b31, n31, n), r31, n31);
+        BENCH("shift_q31_left",
+            ref_shift_q31(a31, 3, r31, n),
+            arm_shift_q31(a31, 3, n31, n), r31, n31);
+        BENCH("shift_q31_right",
+            ref_shift_q31(a31, -5, r31, n),
+            arm_shift_q31(a31, -5, n31, n), r31, n31);
+        BENCH("q15_to_q31",
+            ref_q15_to_q31(a15, r31, n),
+            arm_q15_to_q31(a15, n31, n), r31, n31);
+        BENCH("q31_to_q15",
+            ref_q31_to_q15(a31, r15, n),
+            arm_q31_to_q15(a31, n15, n), r15, n15);
+        BENCH("float_to_q31",
+            ref_float_to_q31(af, r31, n),
+            arm_float_to_q31(af, n31, n), r31, n31);
+        BENCH("mult_q31",
+            ref_mult_q31(a31, b31, r31, n),
+            arm_mult_q31(a31, b31, n31, n), r31, n31);
+        BENCH("mult_q15",
+            ref_mult_q15(a15, b15, r15, n),
+            arm_mult_q15(a15, b15, n15, n), r15, n15);
+        BENCH("scale_q31",
+            ref_scale_q31(b31, 0x5a827999, 1, r31, n),
+            arm_scale_q31(b31, 0x5a827999, 1, n31, n), r31, n31);
+        BENCH("scale_q15",
+            ref_scale_q15(a15, 0x5a82, 1, r15, n),
+            arm_scale_q15(a15, 0x5a82, 1, n15, n), r15, n15);
+        BENCH("fill_q31",
+            ref_fill_q31(0x1234567, r31, n),
+            arm_fill_q31(0x1234567, n31, n), r31, n31);
+        BENCH("copy_q15",
+            ref_copy_q15(a15, r15, n),
+            arm_copy_q15(a15, n15, n), r15, n15);
+        BENCH("copy_f32",
+            ref_copy_f32(af, rf, n),
+            arm_copy_f32(af, nf, n), rf, nf);
+    }
+
+    if (num_fail)
+        printf("11-NeonBench: %d results did not match\n", num_fail);
+    printf("11-NeonBench::setup() finished\n");
+}
+
+
+void loop()
+{
+}
@@ -0,0 +1,132 @@
+// 12-AudioBench.cpp
+//
+// Runs every audio device in the library, unconnected, on
+// synthetic input through AudioBench, and prints the cost of
+// each as CSV to the serial port.  Capture the output and diff
+// it against a previous run to catch regressions in update().
+//
+// The i2s and tdm devices are not instantiated, as that would
+// start the pcm hardware.  Their dma buffer de/interleave kernels
+// are timed instead.
+//
+// The mixer feeding the reverb is also timed as a chain, so that
+// the block traffic between streams (transmit, ref counts, release)
+// is included, as a before/after check on the block pool layout.
+//
+// The biquad bank is run again with every stage of every channel
+// in use, next to freeverb, to compare the cost of the bank at
+// its fullest against the most expensive effect in the library.
+//
+// The convolution reverb is not included as it needs an impulse
+// response from the SD card.
+
+#include <system/std_kernel.h>
+#include <audio\Audio.h>
+#include <audio\AudioBench.h>
+
+
+AudioMixer4                     mixer;
+AudioAmplifier                  amp;
+AudioEffectFreeverb             freeverb;
+AudioEffectFreeverbStereo       freeverbStereo;
+AudioEffectReverb               reverb;
+AudioSynthWaveformSine          sine;
+AudioSynthWaveformSineHires     sineHires;
+AudioSynthWaveformSineModulated sineModulated;
+AudioAnalyzePeak                peak;
+AudioAnalyzeRMS                 rms;
+AudioRecorder                   recorder;
+AudioEffectDelay                delayEffect(500.0);
+AudioEffectASRC                 asrc;
+AudioEffectDynamics             dynamics;
+AudioFilterBiquadBank           biquads;
+
+AudioMixer4                     chainMixer;
+AudioEffectReverb               chainReverb;
+AudioConnection                 chainPatch(chainMixer, 0, chainReverb, 0);
+AudioStream                    *chain[] = { &chainMixer, &chainReverb };
+
+
+//------------------------------------------
+// i/o kernels
+//------------------------------------------
+
+static uint32_t dma_buffer[AUDIO_BLOCK_SAMPLES * NUM_TDM_CHANNELS];
+static int16_t  channel_data[NUM_TDM_CHANNELS][AUDIO_BLOCK_SAMPLES];
+static int16_t *channels[NUM_TDM_CHANNELS];
+
+static void tdmDeinterleave()   { AudioInputTDM::deinterleave(dma_buffer, channels); }
+static void tdmInterleave()     { AudioOutputTDM::interleave(channels, dma_buffer); }
+static void i2sDeinterleave()   { AudioInputI2S::deinterleave(dma_buffer, channels[0], channels[1]); }
+static void i2sInterleave()     { AudioOutputI2S::interleave(channels[0], channels[1], dma_buffer); }
+
+
+
+void setup()
+{
+    printf("12-AudioBench::setup()\n");
+
+    // 16 bit blocks for 8 inputs and 8 outputs at a time,
+    // and delay arena blocks for the delay line.
+    
+    AudioSystem::initialize(64, 8, 0, 256);
+    AudioSystem::setGovernor(false);
+
+    // give everything something to do
+
+    for (u16 i=0; i<4; i++)
+    {
+        mixer.gain(i, 0.5);
+        chainMixer.gain(i, 0.25);
+    }
+    amp.gain(0.7);
+    freeverb.roomsize(0.8);
+    freeverbStereo.roomsize(0.8);
+    sine.frequency(440.0);
+    sine.amplitude(0.5);
+    sineHires.frequency(440.0);
+    sineHires.amplitude(0.5);
+    sineModulated.frequency(440.0);
+    sineModulated.amplitude(0.5);
+    recorder.setRecordMask(0x0f);
+    recorder.startRecording();
+    for (u8 tap=0; tap<4; tap++)
+        delayEffect.setDelay(tap, 100.0 * (tap + 1));
+    dynamics.setMode(DYNAMICS_COMPRESSOR);
+    for (u8 ch=0; ch<BIQUAD_BANK_CHANNELS; ch++)
+    {
+        biquads.setLowpass(ch, 0, 8000.0);
+        biquads.setPeaking(ch, 1, 1000.0, 1.0, 6.0);
+    }
+
+    for (u8 i=0; i<NUM_TDM_CHANNELS; i++)
+    {
+        channels[i] = channel_data[i];
+        memcpy(channels[i], AudioBench::getSignal(i), AUDIO_BLOCK_BYTES);
+    }
+
+    AudioBench::printHeader();
+    for (AudioStream *p = AudioSystem::getFirstStream(); p; p = p->getNextStream())
+        AudioBench::run(p);
+    AudioBench::runChain("mixer_reverb", chain, 2);
+
+    for (u8 ch=0; ch<BIQUAD_BANK_CHANNELS; ch++)
+        for (u8 st=0; st<BIQUAD_BANK_STAGES; st++)
+            biquads.setPeaking(ch, st, 250.0 * (st + 1), 1.0, 3.0);
+    AudioStream *bank[] = { &biquads };
+    AudioStream *verb[] = { &freeverb };
+    AudioBench::runChain("biquad_bank_full", bank, 1);
+    AudioBench::runChain("freeverb", verb, 1);
+
+    AudioBench::runKernel("tdm_deinterleave", tdmDeinterleave);
+    AudioBench::runKernel("tdm_interleave", tdmInterleave);
+    AudioBench::runKernel("i2s_deinterleave", i2sDeinterleave);
+    AudioBench::runKernel("i2s_interleave", i2sInterleave);
+    
+    printf("12-AudioBench::setup() finished\n");
+}
+
+
+void loop()
+{
+}
@@ -0,0 +1,220 @@
+// 13-DynamicsTest.cpp
+//
+// Checks that AudioEffectDynamics in limiter mode never lets an
+// output sample past its ceiling, over a range of ceilings,
+// look-aheads and makeup gains, and prints the cost per block of
+// each mode.  Output is CSV on the serial port:
+//
+//     ceiling_db,lookahead_ms,makeup_db,blocks,peak_in,peak_out,limit,result
+//
+// followed by the AudioBench lines.
+//
+// The test source drives two linked channels with material that is
+// hard on a look-ahead limiter: single full scale spikes out of
+// silence, a square wave that starts part way into a sub-block,
+// full scale noise, and a full scale sine.  The right channel runs
+// a different part of the pattern than the left, so the loudest
+// channel changes from one sub-block to the next.
+//
+// The chain is clocked by hand with AudioBench::step(), so no i/o
+// devices are needed.
+
+#include <system/std_kernel.h>
+#include <audio\Audio.h>
+#include <audio\AudioBench.h>
+
+
+#define TEST_BLOCKS     2000
+#define SETTLE_BLOCKS   8
+    // blocks run after a setting changes and before checking,
+    // to flush the look-ahead of targets from the old setting
+
+
+static int16_t testSample(u32 n)
+    // sample n of a pattern that repeats every 16 blocks
+{
+    u32 seg = (n / (4 * AUDIO_BLOCK_SAMPLES)) & 3;
+    u32 pos = n % (4 * AUDIO_BLOCK_SAMPLES);
+    u32 hash = n * 2654435761u;
+    hash ^= hash >> 15;
+
+    switch (seg)
+    {
+        case 0 :
+            return pos % 333 == 0 ? -32768 : 0;
+        case 1 :
+            if (pos < 37)
+                return 0;
+            return ((pos - 37) / 50) & 1 ? -32767 : 32767;
+        case 2 :
+            return (int16_t) (hash >> 16);
+    }
+    return (int16_t) (32767.0 * sinf(2.0 * M_PI * 997.0 * n / AUDIO_SAMPLE_RATE));
+}
+
+
+class TestSource : public AudioStream
+{
+public:
+
+    TestSource() : AudioStream(0,2,0)   { m_sample = 0; m_peak = 0; }
+
+    virtual const char *getName()   { return "testsrc"; }
+    s32 getPeak()                   { return m_peak; }
+
+private:
+
+    u32 m_sample;
+    s32 m_peak;
+
+    virtual void update()
+    {
+        for (u8 ch=0; ch<2; ch++)
+        {
+            audio_block_t *block = AudioSystem::allocate();
+            if (!block)
+                return;
+            u32 offset = ch ? 8 * AUDIO_BLOCK_SAMPLES : 0;
+            for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+            {
+                s32 v = testSample(m_sample + offset + i);
+                block->data[i] = v;
+                if (v < 0) v = -v;
+                if (v > m_peak) m_peak = v;
+            }
+            transmit(block,ch);
+            AudioSystem::release(block);
+        }
+        m_sample += AUDIO_BLOCK_SAMPLES;
+    }
+};
+
+
+class TestSink : public AudioStream
+{
+public:
+
+    TestSink() : AudioStream(2,0,inputQueueArray)  { m_peak = 0; m_blocks = 0; }
+
+    virtual const char *getName()   { return "testsink"; }
+    void reset()                    { m_peak = 0; m_blocks = 0; }
+    s32 getPeak()                   { return m_peak; }
+    u32 getBlocks()                 { return m_blocks; }
+
+private:
+
+    audio_block_t *inputQueueArray[2];
+    s32 m_peak;
+    u32 m_blocks;
+
+    virtual void update()
+    {
+        for (u8 ch=0; ch<2; ch++)
+        {
+            audio_block_t *block = receiveReadOnly(ch);
+            if (!block)
+                continue;
+            for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+            {
+                s32 v = block->data[i];
+                if (v < 0) v = -v;
+                if (v > m_peak) m_peak = v;
+            }
+            if (!ch)
+                m_blocks++;
+            AudioSystem::release(block);
+        }
+    }
+};
+
+
+TestSource          source;
+AudioEffectDynamics limiter;
+TestSink            sink;
+AudioEffectDynamics benchDynamics;
+
+AudioConnection c0(source, 0, limiter, 0);
+AudioConnection c1(source, 1, limiter, 1);
+AudioConnection c2(limiter, 0, sink, 0);
+AudioConnection c3(limiter, 1, sink, 1);
+
+
+static float ceilings[]   = { 0.0, -0.3, -1.0, -6.0, -20.0 };
+static float lookaheads[] = { 0.0, 2.0, 10.0 };
+static float makeups[]    = { 0.0, 6.0 };
+
+#define NUM(a)  (sizeof(a) / sizeof(a[0]))
+
+
+static void runBlocks(u32 num_blocks)
+{
+    for (u32 b=0; b<num_blocks; b++)
+    {
+        AudioBench::step(&source);
+        AudioBench::step(&limiter);
+        AudioBench::step(&sink);
+    }
+}
+
+
+static bool checkCeiling(float ceiling_db, float lookahead_ms, float makeup_db)
+{
+    limiter.setCeiling(ceiling_db);
+    limiter.setLookahead(lookahead_ms);
+    limiter.setMakeup(makeup_db);
+    runBlocks(SETTLE_BLOCKS);
+
+    sink.reset();
+    runBlocks(TEST_BLOCKS);
+
+    s32 limit = (s32) (powf(10.0, ceiling_db / 20.0) * 32768.0);
+    bool ok = sink.getPeak() <= limit && sink.getBlocks() == TEST_BLOCKS;
+    printf("%0.1f,%0.1f,%0.1f,%d,%d,%d,%d,%s\n",
+        ceiling_db,lookahead_ms,makeup_db,sink.getBlocks(),
+        source.getPeak(),sink.getPeak(),limit,
+        ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+
+void setup()
+{
+    printf("13-DynamicsTest::setup()\n");
+
+    AudioSystem::initialize(64, 8, 0, 0);
+    AudioSystem::setGovernor(false);
+
+    limiter.setMode(DYNAMICS_LIMITER);
+    limiter.setRelease(50.0);
+
+    u32 failed = 0;
+    printf("ceiling_db,lookahead_ms,makeup_db,blocks,peak_in,peak_out,limit,result\n");
+    for (u16 c=0; c<NUM(ceilings); c++)
+        for (u16 l=0; l<NUM(lookaheads); l++)
+            for (u16 m=0; m<NUM(makeups); m++)
+                if (!checkCeiling(ceilings[c],lookaheads[l],makeups[m]))
+                    failed++;
+    printf("ceiling check %s, %d failed\n",failed ? "FAILED" : "passed",failed);
+
+    // cost per block with all eight channels linked, on
+    // AudioBench's -6db input, named by mode via runChain()
+
+    AudioStream *bench[] = { &benchDynamics };
+    AudioBench::printHeader();
+    benchDynamics.setCeiling(-12.0);
+    benchDynamics.setMode(DYNAMICS_LIMITER);
+    AudioBench::runChain("limiter", bench, 1);
+    benchDynamics.setMode(DYNAMICS_COMPRESSOR);
+    AudioBench::runChain("compressor", bench, 1);
+    benchDynamics.setDetectRMS(1);
+    AudioBench::runChain("compressor_rms", bench, 1);
+    benchDynamics.setMode(DYNAMICS_GATE);
+    AudioBench::runChain("gate_rms", bench, 1);
+
+    printf("13-DynamicsTest::setup() finished\n");
+}
+
+
+void loop()
+{
+}
@@ -0,0 +1,199 @@
+// 14-AsrcTest.cpp
+//
+// Measures the THD+N of AudioEffectASRC against the ratio offset.
+// The converter is run open loop with setRatio() over a sweep of
+// offsets, fed a sine, and a stretch of its settled output is
+// captured.  A sine plus DC at the known output frequency is fit
+// to the capture by least squares, and whatever the fit does not
+// explain (harmonics, images, noise) is the THD+N.  Output is CSV
+// on the serial port:
+//
+//     ratio_ppm,freq_hz,samples,thdn_db,underruns,overruns
+//
+// The input is only fed when the fifo is below its target fill,
+// as a source in another clock domain would be, so the converter
+// should never underrun.  The chain is clocked by hand with
+// AudioBench::step(), so no i/o devices are needed.
+
+#include <system/std_kernel.h>
+#include <audio\Audio.h>
+#include <audio\AudioBench.h>
+
+
+#define SETTLE_BLOCKS     32
+#define CAPTURE_SAMPLES   8192
+#define TEST_AMPLITUDE    (0.7 * 32767.0)
+
+
+class TestSource : public AudioStream
+{
+public:
+
+    TestSource() : AudioStream(0,2,0)   { m_phase = 0.0; m_inc = 0.0; }
+
+    virtual const char *getName()   { return "testsrc"; }
+    void setFrequency(float freq)   { m_inc = 2.0 * M_PI * freq / AUDIO_SAMPLE_RATE; }
+
+private:
+
+    double m_phase;
+    double m_inc;
+
+    virtual void update()
+    {
+        audio_block_t *block = AudioSystem::allocate();
+        if (!block)
+            return;
+        for (u16 i=0; i<AUDIO_BLOCK_SAMPLES; i++)
+        {
+            block->data[i] = (int16_t) (TEST_AMPLITUDE * sin(m_phase));
+            m_phase += m_inc;
+            if (m_phase > 2.0 * M_PI)
+                m_phase -= 2.0 * M_PI;
+        }
+        transmit(block,0);
+        transmit(block,1);
+        AudioSystem::release(block);
+    }
+};
+
+
+class TestSink : public AudioStream
+{
+public:
+
+    TestSink() : AudioStream(1,0,inputQueueArray)  { m_count = 0; }
+
+    virtual const char *getName()   { return "testsink"; }
+    void reset()                    { m_count = 0; }
+    bool full()                     { return m_count >= CAPTURE_SAMPLES; }
+    const int16_t *getSamples()     { return m_samples; }
+
+private:
+
+    audio_block_t *inputQueueArray[1];
+    u32 m_count;
+    int16_t m_samples[CAPTURE_SAMPLES];
+
+    virtual void update()
+    {
+        audio_block_t *block = receiveReadOnly(0);
+        if (!block)
+            return;
+        for (u16 i=0; i<AUDIO_BLOCK_SAMPLES && m_count<CAPTURE_SAMPLES; i++)
+            m_samples[m_count++] = block->data[i];
+        AudioSystem::release(block);
+    }
+};
+
+
+TestSource      source;
+AudioEffectASRC asrc;
+TestSink        sink;
+
+AudioConnection c0(source, 0, asrc, 0);
+AudioConnection c1(source, 1, asrc, 1);
+AudioConnection c2(asrc, 0, sink, 0);
+
+
+static float ratio_ppm[] = { 0, 10, -10, 100, -100, 1000, -1000, 5000, -5000, 10000, -10000 };
+static float freqs[]     = { 1000.0, 10000.0 };
+
+#define NUM(a)  (sizeof(a) / sizeof(a[0]))
+
+
+static void runBlock()
+{
+    if (asrc.getFill() < ASRC_TARGET_FILL)
+        AudioBench::step(&source);
+    AudioBench::step(&asrc);
+    AudioBench::step(&sink);
+}
+
+
+static float thdn(const int16_t *x, u32 n, double w)
+    // Least squares fit of a*cos(wt) + b*sin(wt) + c, by solving
+    // the 3x3 normal equations.  Returns the residual relative to
+    // the fitted sine, in db.
+{
+    double m[3][4];
+    memset(m,0,sizeof(m));
+    for (u32 t=0; t<n; t++)
+    {
+        double v[3] = { cos(w * t), sin(w * t), 1.0 };
+        for (u16 i=0; i<3; i++)
+        {
+            for (u16 j=0; j<3; j++)
+                m[i][j] += v[i] * v[j];
+            m[i][3] += v[i] * x[t];
+        }
+    }
+
+    for (u16 i=0; i<3; i++)
+    {
+        for (u16 k=i+1; k<3; k++)
+        {
+            double f = m[k][i] / m[i][i];
+            for (u16 j=i; j<4; j++)
+                m[k][j] -= f * m[i][j];
+        }
+    }
+    double c[3];
+    for (s16 i=2; i>=0; i--)
+    {
+        double s = m[i][3];
+        for (u16 j=i+1; j<3; j++)
+            s -= m[i][j] * c[j];
+        c[i] = s / m[i][i];
+    }
+
+    double residual = 0.0;
+    for (u32 t=0; t<n; t++)
+    {
+        double e = x[t] - (c[0] * cos(w * t) + c[1] * sin(w * t) + c[2]);
+        residual += e * e;
+    }
+    double signal = (c[0] * c[0] + c[1] * c[1]) / 2.0 * n;
+    return 10.0 * log10(residual / signal);
+}
+
+
+void setup()
+{
+    printf("14-AsrcTest::setup()\n");
+
+    AudioSystem::initialize(32, 0, 0, 0);
+    AudioSystem::setGovernor(false);
+
+    printf("ratio_ppm,freq_hz,samples,thdn_db,underruns,overruns\n");
+    for (u16 f=0; f<NUM(freqs); f++)
+    {
+        source.setFrequency(freqs[f]);
+        for (u16 r=0; r<NUM(ratio_ppm); r++)
+        {
+            asrc.setRatio(1.0 + ratio_ppm[r] / 1000000.0);
+            for (u16 b=0; b<SETTLE_BLOCKS; b++)
+                runBlock();
+
+            asrc.clearErrors();
+            sink.reset();
+            while (!sink.full())
+                runBlock();
+
+            // the output runs at ratio input samples per sample
+
+            double w = 2.0 * M_PI * freqs[f] / AUDIO_SAMPLE_RATE * asrc.getRatio();
+            printf("%0.0f,%0.0f,%d,%0.1f,%d,%d\n",
+                ratio_ppm[r],freqs[f],CAPTURE_SAMPLES,
+                thdn(sink.getSamples(),CAPTURE_SAMPLES,w),
+                asrc.getUnderruns(),asrc.getOverruns());
+        }
+    }
+
+    printf("14-AsrcTest::setup() finished\n");
+}
+
+
+void loop()
+{
+}
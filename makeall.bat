@@ -161,6 +161,26 @@ cd examples
     if %errorlevel% neq 0 exit /b %errorlevel%
     cd ..
 
+    cd 11-NeonBench
+    make %DO_CLEAN%
+    if %errorlevel% neq 0 exit /b %errorlevel%
+    cd ..
+
+    cd 12-AudioBench
+    make %DO_CLEAN%
+    if %errorlevel% neq 0 exit /b %errorlevel%
+    cd ..
+
+    cd 13-DynamicsTest
+    make %DO_CLEAN%
+    if %errorlevel% neq 0 exit /b %errorlevel%
+    cd ..
+
+    cd 14-AsrcTest
+    make %DO_CLEAN%
+    if %errorlevel% neq 0 exit /b %errorlevel%
+    cd ..
+
 cd ..
     
 :END_MACRO
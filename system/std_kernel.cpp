@@ -125,6 +125,7 @@ CCoreTask::~CCoreTask()
 		}
 		else
 		{
+			AudioSystem::logGovernor();
 			loop();
 		}
 	}
@@ -134,9 +135,6 @@ CCoreTask::~CCoreTask()
 
 #if USE_UI_SYSTEM
 
-	#define UI_FRAME_RATE   60
-		// undefine this to not throttle the UI
-
 	void CCoreTask::runUISystem(unsigned nCore, bool init)
 	{
 		if (init)
@@ -180,21 +178,61 @@ CCoreTask::~CCoreTask()
 				if (m_bAudioStarted)
 			#endif
 		{
-			#ifdef UI_FRAME_RATE
-			static u32 ui_timer = 0;
-			u32 now = m_pKernel->m_Timer.GetClockTicks();
-			if (now > ui_timer + (1000000/UI_FRAME_RATE))
-			{
-				ui_timer = now;
+			m_pKernel->m_app.timeSlice();
+				// not throttled here, as wsApplication paces its own
+				// frames, and the touch screen wants to be polled
+				// as often as possible
+			#if UI_STATS_LOG_SECS
+				logUIStats();
 			#endif
+		}
+	}
 
-				m_pKernel->m_app.timeSlice();
 
-			#if UI_FRAME_RATE
-			}
+	#if UI_STATS_LOG_SECS
+
+		static u32 ui_stats_time = 0;
+		#if USE_ILI_TFT
+			static u32 spi_bus_time[SPI_BUS_MAX_DEVICES];
+			static u32 spi_transfers[SPI_BUS_MAX_DEVICES];
+		#endif
+
+		void CCoreTask::logUIStats()
+			// Called every UI time slice, and logs every UI_STATS_LOG_SECS.
+			// It runs on the UI core, as the frame stats and the SPI bus may
+			// only be used from there.  Along with the bus totals, each
+			// device's share of the bus over the interval is shown.
+		{
+			u32 now = CTimer::GetClockTicks();
+			u32 elapsed = now - ui_stats_time;
+			if (elapsed < UI_STATS_LOG_SECS * CLOCKHZ)
+				return;
+			ui_stats_time = now;
+
+			wsApplication *pApp = &m_pKernel->m_app;
+			LOG("ui frame_rate(%d) dropped_events(%d)",
+				pApp->getFrameRate(),
+				pApp->getNumDroppedEvents());
+			pApp->getFrameStats()->logStats();
+
+			#if USE_ILI_TFT
+				CSPIBus *pBus = m_pKernel->m_tft.getBus();
+				pBus->logStats();
+				for (u8 i=0; i<pBus->getNumDevices(); i++)
+				{
+					u32 bus_time = pBus->getBusTime(i);
+					u32 transfers = pBus->getNumTransfers(i);
+					LOG("%-8s last %ds: transfers(%d) busy(%d%%)",
+						pBus->getName(i),
+						UI_STATS_LOG_SECS,
+						transfers - spi_transfers[i],
+						(bus_time - spi_bus_time[i]) / (elapsed / 100));
+					spi_bus_time[i] = bus_time;
+					spi_transfers[i] = transfers;
+				}
 			#endif
 		}
-	}
+	#endif
 #endif
 
 
@@ -365,6 +403,9 @@ CKernel::CKernel(void) :
 		,m_DWHCI(&m_Interrupt, &m_Timer)
 	#endif
 	#if USE_ILI_TFT
+		#if USE_SPI_DMA
+			,m_SPI(&m_Interrupt)
+		#endif
 		,m_tft(&m_SPI)
 		#if USE_XPT2046
 			,m_xpt2046(&m_SPI,&m_tft)
@@ -45,6 +45,11 @@
 #define USE_MAIN_SERIAL  	1
 #define USE_FILE_SYSTEM     1			// include (and initalize) the addon fatfs
 
+#define UI_STATS_LOG_SECS	60
+	// If non-zero, and USE_UI_SYSTEM, the UI core logs the frame
+	// rate and timings of the wsApplication, and the SPI bus usage
+	// of an ILI tft and its touch screen, this often.
+
 // The following defines override the binding of the user
 // interface to physical devices.  By defaut, it expects
 // a bcm hdmi circle CScreen device, and will automatically
@@ -209,6 +214,9 @@ class CCoreTask
 	#if USE_UI_SYSTEM
 		void runUISystem(unsigned nCore, bool init);
 		volatile bool m_bUIStarted;
+		#if UI_STATS_LOG_SECS
+			void logUIStats();
+		#endif
 	#endif
 };
 
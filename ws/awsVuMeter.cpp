@@ -26,6 +26,7 @@ awsVuMeter::awsVuMeter(wsWindow *pParent,u16 id, s32 xs, s32 ys, s32 xe, s32 ye,
     }
     
 	setBackColor(wsBLACK);
+	setWantsFrameTick(true);
 }
 
 
@@ -88,7 +89,7 @@ void awsVuMeter::updateFrame()
     // wsWindow::update();
     // wsWindow::updateFrame();
     
-    if (m_pPeak)
+    if (m_pPeak && m_pPeak->available())
     {
         float peak = m_pPeak->read();
         u8 value = (peak * ((float)m_num_divs) + 0.8);
@@ -97,7 +98,7 @@ void awsVuMeter::updateFrame()
             // LOG("setting next_value to %d",value);
             m_next_value = value;
             // m_pDC->invalidate(m_rect_abs);
-			setBit(m_state,WIN_STATE_DRAW);
+			setStateBits(WIN_STATE_DRAW);
 
         }
     }
@@ -51,9 +51,12 @@ wsApplication::wsApplication() :
 	m_pTouchFocus = 0;
 	memset(&m_touch_state,0,sizeof(touchState_t));
 
-	m_pFirstEvent = 0;
-	m_pLastEvent = 0;
+	m_event_head = 0;
+	m_event_tail = 0;
+	m_num_dropped_events = 0;
 	m_update_frame_time = 0;
+	m_frame_period = CLOCKHZ / WS_FRAME_RATE_MAX;
+	m_quiet_frames = 0;
 
 	m_state |= WIN_STATE_PARENT_VISIBLE;
 		// the application is always progenator of
@@ -61,13 +64,40 @@ wsApplication::wsApplication() :
 }
 
 
+void wsApplication::addEvent(u32 type, u32 id, wsWindow *obj)
+{
+	if (id == EVENT_VALUE_CHANGED)
+	{
+		for (u16 i=m_event_head; i!=m_event_tail; i=(i+1) & (WS_EVENT_RING_SIZE-1))
+		{
+			wsEvent *pending = &m_event_ring[i];
+			if (pending->m_obj == obj &&
+				pending->m_type == type &&
+				pending->m_id == id)
+				return;
+		}
+	}
+
+	u16 next = (m_event_tail + 1) & (WS_EVENT_RING_SIZE-1);
+	if (next == m_event_head)
+	{
+		if (!m_num_dropped_events++)
+			LOG_ERROR("event ring full - dropping events",0);
+		return;
+	}
+
+	wsEvent *event = &m_event_ring[m_event_tail];
+	event->m_type = type;
+	event->m_id = id;
+	event->m_obj = obj;
+	m_event_tail = next;
+}
+
+
 void wsApplication::addEvent(wsEvent *event)
 {
-	if (m_pLastEvent)
-		event->m_pNext = m_pLastEvent;
-	else
-		m_pFirstEvent = event;
-	m_pLastEvent = event;
+	addEvent(event->m_type,event->m_id,event->m_obj);
+	delete event;
 }
 
 
@@ -124,7 +154,7 @@ void wsApplication::Initialize(
 	m_pDC = new wsDC(m_pScreen);
 	m_pDC->setFont(wsFont8x14);
 
-	// print_rect("initial invalid",&m_pDC->getInvalid());
+	// print_rect("initial invalid",&m_pDC->getInvalid().getBounds());
 
 	setFont(wsFont8x14);
 	m_pScreen->InitializeUI(m_pDC,wsDC::driverRegisterStub);
@@ -142,7 +172,7 @@ void wsApplication::Initialize(
 
 	Create();
 
-	// print_rect("after create invalid",&m_pDC->getInvalid());
+	// print_rect("after create invalid",&m_pDC->getInvalid().getBounds());
 
 	LOG("Initialize() returning",0);
 }
@@ -280,10 +310,6 @@ void wsApplication::onTouchEvent(
 // timeSlice()
 //--------------------------------------------------
 
-#define UI_FRAME_RATE    30
-	// if the std_kernel is set to 60 frames,
-	// probably want to undefine this
-
 #define USE_AUDIO_MONITOR	0
 	// not yet tested with actual Looper2
 
@@ -295,18 +321,30 @@ void wsApplication::onTouchEvent(
 
 void wsApplication::timeSlice()
 {
-	// Gate the entire process to UI_FRAME_RATE
+	// the touch screen samples on its own schedule,
+	// and only does SPI transfers while it is touched
+
+	#if USE_XPT2046
+		CCoreTask::Get()->GetKernel()->GetXPT2046()->poll();
+	#endif
+
+	// Gate the entire process to the rate chosen by paceFrames(),
+	// or the full rate as soon as the screen is touched.
 
 	CTimer *timer = CTimer::Get();
 
-	#if UI_FRAME_RATE
-		unsigned cur_time = timer->GetClockTicks();
-		if (cur_time > m_update_frame_time &&
-			cur_time < m_update_frame_time + CLOCKHZ/UI_FRAME_RATE)
-			return;
-		m_update_frame_time = cur_time;
+	u32 frame_period = m_frame_period;
+	#if USE_XPT2046
+		if (CCoreTask::Get()->GetKernel()->GetXPT2046()->isTouched())
+			frame_period = CLOCKHZ / WS_FRAME_RATE_MAX;
 	#endif
 
+	u32 cur_time = timer->GetClockTicks();
+	if (cur_time - m_update_frame_time < frame_period)
+		return;
+	m_update_frame_time = cur_time;
+	m_frame_stats.startFrame();
+
 	#if USE_AUDIO_MONITOR && USE_AUDIO_SYSTEM
 		audio_mon.Update();
 	#endif
@@ -317,7 +355,11 @@ void wsApplication::timeSlice()
 			delay(10);
 			printf("================= update =====================\n");
 			if (!m_pDC->getInvalid().isEmpty())
-				print_rect("invalid",&m_pDC->getInvalid());
+			{
+				const wsRegion &invalid = m_pDC->getInvalid();
+				for (u16 i=0; i<invalid.getNumRects(); i++)
+					print_rect("invalid",&invalid.getRect(i));
+			}
 		}
 	#endif
 
@@ -331,6 +373,7 @@ void wsApplication::timeSlice()
 		{
 			calibration_started = 1;
 			xpt2046->Update();
+			m_pDC->flush();
 			return;
 		}
 		else if (calibration_started)
@@ -347,10 +390,12 @@ void wsApplication::timeSlice()
 		m_pMouse->UpdateCursor();
 	if (m_pTouch)
 		m_pTouch->Update();
+	m_frame_stats.endPhase(WS_FRAME_PHASE_TOUCH);
 
 	#if USE_MIDI_SYSTEM
 		midiSystem::getMidiSystem()->dispatchEvents();
 	#endif
+	m_frame_stats.endPhase(WS_FRAME_PHASE_MIDI);
 
 
 	//----------------------------------
@@ -360,16 +405,38 @@ void wsApplication::timeSlice()
 	// or size event, and is generally set on static window objects
 	// only on their creation, or when a parent is updated, so update()
 	// is not called on every object on every frame. updateFrame() IS
-	// called on every frame, allowing for polling which changes the
+	// called on every frame, on the windows that registered with
+	// setWantsFrameTick(), allowing for polling which changes the
 	// WIN_STATE_DRAW or REDRAW bits.
 
 
 	for (wsTopLevelWindow *p=m_pBottomWindow; p; p=p->m_pNextWindow)
 	{
-		p->updateFrame();
+		if (p->m_num_tickers)
+			p->updateFrame();
 	}
+	m_frame_stats.endPhase(WS_FRAME_PHASE_TICK);
+
+	// Anything to draw, drag, or dispatch keeps the pacer
+	// at the full frame rate.
+
+	bool busy = m_pTouchFocus || m_event_head != m_event_tail;
 
 
+	// Mark the windows under the invalid region using each
+	// top level window's spatial index, so that update() only
+	// has to follow the dirty paths down to them.
+
+	const wsRegion &invalid = m_pDC->getInvalid();
+	if (!invalid.isEmpty())
+	{
+		busy = true;
+		for (wsTopLevelWindow *p=m_pBottomWindow; p; p=p->m_pNextWindow)
+		{
+			p->markInvalid(invalid);
+		}
+	}
+
 	// We do not call the base class update() method here ...
 	// instead, we call update directly on each top level window
 	// so that they are drawn in the right order (the stack order
@@ -384,7 +451,11 @@ void wsApplication::timeSlice()
 				printf("---- top window ----\n");
 			}
 		#endif
-		p->update();
+		if (p->needsUpdate())
+		{
+			busy = true;
+			p->update();
+		}
 	}
 
 	// since we do not call our own base class update() method
@@ -395,7 +466,8 @@ void wsApplication::timeSlice()
 	clearBit(m_state,
 		WIN_STATE_UPDATE |
 		WIN_STATE_DRAW |
-		WIN_STATE_REDRAW );
+		WIN_STATE_REDRAW |
+		WIN_STATE_SUBTREE_DIRTY );
 
 	// At this point all objects should be up to date and completely drawn.
 	// We empty the DC's clipping region here, it will be expanded
@@ -421,24 +493,49 @@ void wsApplication::timeSlice()
 		if (debug_update)
 			debug_update--;
 	#endif
+	m_frame_stats.endPhase(WS_FRAME_PHASE_UPDATE);
 
-	// dispatch any pending events to the top level window
+	// dispatch pending events to the top level window until the
+	// ring is empty or the time budget is used up.  The event is
+	// copied out first, so handlers can queue new ones.
 
-	if (m_pFirstEvent && m_pTopWindow)
+	if (m_pTopWindow)
 	{
-		wsEvent *event = m_pFirstEvent;
-		if (event->m_pNext)
+		unsigned start_time = timer->GetClockTicks();
+		while (m_event_head != m_event_tail &&
+			   timer->GetClockTicks() - start_time < WS_EVENT_TIME_BUDGET)
 		{
-			m_pFirstEvent = event->m_pNext;
-			m_pFirstEvent->m_pPrev = 0;
-		}
-		else
-		{
-			m_pFirstEvent = 0;
-			m_pLastEvent = 0;
+			wsEvent event(m_event_ring[m_event_head]);
+			m_event_head = (m_event_head + 1) & (WS_EVENT_RING_SIZE-1);
+			m_pTopWindow->handleEvent(&event);
+			busy = true;
 		}
+	}
+	m_frame_stats.endPhase(WS_FRAME_PHASE_EVENTS);
 
-		m_pTopWindow->handleEvent(event);
-		delete event;
+	// send anything the screen has buffered to the display
+
+	m_pDC->flush();
+	m_frame_stats.endPhase(WS_FRAME_PHASE_FLUSH);
+	m_frame_stats.endFrame();
+
+	paceFrames(busy);
+}
+
+
+void wsApplication::paceFrames(bool busy)
+{
+	if (busy)
+	{
+		m_quiet_frames = 0;
+		m_frame_period = CLOCKHZ / WS_FRAME_RATE_MAX;
+	}
+	else if (m_quiet_frames < WS_PACER_IDLE_FRAMES)
+	{
+		m_quiet_frames++;
+	}
+	else
+	{
+		m_frame_period = CLOCKHZ / WS_FRAME_RATE_IDLE;
 	}
 }
@@ -8,8 +8,23 @@
 #define _wsApp_h
 
 #include "wsTopWindow.h"
+#include "wsEvent.h"
+#include "wsFrameStats.h"
 #include <circle/input/mouse.h>
 #include <circle/input/touchscreen.h>
+#include <circle/timer.h>
+
+
+#define WS_EVENT_RING_SIZE		64		// power of 2
+#define WS_EVENT_TIME_BUDGET	5000	// us per frame
+
+#define WS_FRAME_RATE_MAX		60
+#define WS_FRAME_RATE_IDLE		10
+#define WS_PACER_IDLE_FRAMES	30
+	// Frames run at WS_FRAME_RATE_MAX while anything is drawn,
+	// dragged, or dispatched, and drop to WS_FRAME_RATE_IDLE
+	// after this many quiet frames in a row.  A touch goes
+	// back to the full rate before the next frame.
 
 
 //------------------------------------
@@ -52,16 +67,34 @@ class wsApplication : public wsWindow
 		void addTopLevelWindow(wsTopLevelWindow *pWindow);
 		void removeTopLevelWindow(wsTopLevelWindow *pWindow);
 		
+		void addEvent(u32 type, u32 id, wsWindow *obj);
+			// Queues an event in a fixed ring that timeSlice() drains
+			// each frame, up to WS_EVENT_TIME_BUDGET.  An EVENT_VALUE_CHANGED
+			// for a window that already has one pending is dropped, as the
+			// handler reads the current value from the window anyway.
+			// It may be called from handleEvent().
 		void addEvent(wsEvent *event);
-			// addEvent() is only to be called during the update() cycle.
-			// you cannot call addEvent() from handleEvent() !!!
-			// addPendingEvent() not implemented yet!
+			// for old code that news its events; the event is copied
+			// into the ring and deleted.
+
+		u32 getNumDroppedEvents() const		{ return m_num_dropped_events; }
+
+		const wsFrameStats *getFrameStats() const	{ return &m_frame_stats; }
+		u32 getFrameRate() const	{ return CLOCKHZ / m_frame_period; }
+			// the rate the pacer is currently running at
 		
 	private:
 		
-		wsEvent *m_pFirstEvent;
-		wsEvent *m_pLastEvent;
+		wsEvent m_event_ring[WS_EVENT_RING_SIZE];
+		u16 m_event_head;		// next to dispatch
+		u16 m_event_tail;		// next free
+		u32 m_num_dropped_events;
 		u32 m_update_frame_time;
+		u32 m_frame_period;			// us, set by paceFrames()
+		u16 m_quiet_frames;
+		wsFrameStats m_frame_stats;
+
+		void paceFrames(bool busy);
 		
 		wsWindow *m_pTouchFocus;
 		touchState_t m_touch_state;
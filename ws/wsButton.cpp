@@ -51,7 +51,7 @@ void wsButton::onUpdateTouch(bool touched)
 	#if DEBUG_TOUCH
 		printf("wsButton(%08x)::onUpdateTouch(%d)\n",(u32)this,touched);
 	#endif
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 }
 
 
@@ -65,12 +65,12 @@ void wsButton::onUpdateClick()
 	if (m_button_style & BTN_STYLE_TOGGLE_VALUE)
 		toggleBit(m_button_state, BTN_STATE_PRESSED);
 
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 	
-	getApplication()->addEvent(new wsEvent(
+	getApplication()->addEvent(
 		EVT_TYPE_BUTTON,
 		EVENT_CLICK,
-		this ));
+		this );
 }
 
 
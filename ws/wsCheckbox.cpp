@@ -26,7 +26,7 @@ void wsCheckbox::onUpdateTouch(bool touched)
 		setBit(m_checkbox_state,CHB_STATE_PRESSED);
 	else
 		clearBit(m_checkbox_state,CHB_STATE_PRESSED);
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 }
 
 
@@ -37,12 +37,12 @@ void wsCheckbox::onUpdateClick()
 	#endif
 	
 	toggleBit(m_checkbox_state, CHB_STATE_CHECKED);
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 	
-	getApplication()->addEvent(new wsEvent(
+	getApplication()->addEvent(
 		EVT_TYPE_CHECKBOX,
 		EVENT_VALUE_CHANGED,
-		this ));
+		this );
 }
 
 
@@ -86,7 +86,7 @@ void wsCheckbox::onDraw()
 	{
 		s32 x = xoff + checkbox_check_coords[i*2];
 		s32 y = yoff + checkbox_check_coords[i*2+1];
-		if (m_pDC->getClip().intersects(x,y))
+		if (m_pDC->inClip(x,y))
 			m_pDC->setPixel(x,y,color);
 	}
 
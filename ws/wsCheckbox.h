@@ -62,7 +62,7 @@ class wsCheckbox : public wsControl
 				m_checkbox_state |= CHB_STATE_CHECKED;
 			else
 				m_checkbox_state &= ~CHB_STATE_CHECKED;
-			setBit(m_state,WIN_STATE_DRAW);
+			setStateBits(WIN_STATE_DRAW);
 		}
 		
 		void setAltBackColor(wsColor color)  {m_alt_back_color = color;}
@@ -13,9 +13,48 @@ typedef u8 (*drawLineDriver)(void *pThat, s16 x0, s16 y0, s16 x1, s16 y1, wsColo
 typedef u8 (*fillFrameDriver)(void *pThat, s16 x0, s16 y0, s16 x1, s16 y1, wsColor color);
 typedef void (*pushPixelFxn)(void *pThat, wsColor color);
 typedef pushPixelFxn (*fillAreaDriver)(void *pThat, s16 x0, s16 y0, s16 x1, s16 y1);
+typedef void (*flushDriver)(void *pThat);
+typedef void (*blitDriver)(void *pThat, s16 x0, s16 y0, s16 x1, s16 y1, const wsColor *pixels, s32 stride);
 
 		 
 
+void wsDC::setClip(const wsRect &rect, bool invalid)
+{
+	m_clip.assign(rect);
+	if (invalid && !m_invalid.isEmpty())
+	{
+		m_num_clips = m_invalid.clip(rect,m_clips);
+		m_clip.empty();
+		for (u16 i=0; i<m_num_clips; i++)
+			m_clip.expand(m_clips[i]);
+	}
+	else
+	{
+		m_clips[0].assign(rect);
+		m_num_clips = rect.isEmpty() ? 0 : 1;
+	}
+}
+
+
+bool wsDC::inClip(s32 x, s32 y) const
+{
+	for (u16 i=0; i<m_num_clips; i++)
+	{
+		if (m_clips[i].intersects(x,y))
+			return true;
+	}
+	return false;
+}
+
+
+
+void wsDC::flush()
+{
+	if (m_opt_driver[OPT_DRIVER_FLUSH])
+		((flushDriver)m_opt_driver[OPT_DRIVER_FLUSH])(m_pScreen);
+}
+
+
 void wsDC::fillScreen( wsColor color )
 {
 	fillFrame(0,0,m_xdim-1,m_ydim-1,color);
@@ -30,14 +69,18 @@ void wsDC::fillFrame( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color )
 	if ( x1 < x0 ) swapU16(x0,x1);
 	if ( y1 < y0 ) swapU16(y0,y1);
 
-	wsRect rect(x0,y0,x1,y1);
-	rect.intersect(m_clip);
-	if (rect.isEmpty())
+	for (u16 i=0; i<m_num_clips; i++)
 	{
-		// LOG("skipping %d,%d,%d,%d",x0,y0,x1,y1);
-		return;
+		wsRect rect(x0,y0,x1,y1);
+		rect.intersect(m_clips[i]);
+		if (!rect.isEmpty())
+			_fillFrame(rect,color);
 	}
-	
+}
+
+
+void wsDC::_fillFrame( const wsRect &rect, wsColor color )
+{
 	if ( m_opt_driver[OPT_DRIVER_FILL_FRAME])
 	{
 		((fillFrameDriver)m_opt_driver[OPT_DRIVER_FILL_FRAME])
@@ -56,70 +99,112 @@ void wsDC::fillFrame( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color )
 
 
 
-void wsDC::drawLine( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color )
+//------------------------------------
+// span rasterizer
+//------------------------------------
+// Everything is broken into horizontal and vertical spans that
+// are clipped once and sent as fillFrame() calls, so the screen
+// sees one window per run of pixels instead of one per pixel.
+
+void wsDC::_hspan( s32 x0, s32 x1, s32 y, wsColor color )
 {
-	wsRect rect(x0,y0,x1,y1);
-	rect.intersect(m_clip);
-	if (rect.isEmpty())
-		return;
+	if ( x1 < x0 ) swapU16(x0,x1);
+	for (u16 i=0; i<m_num_clips; i++)
+	{
+		wsRect rect(x0,y,x1,y);
+		rect.intersect(m_clips[i]);
+		if (!rect.isEmpty())
+			_fillFrame(rect,color);
+	}
+}
+
+
+void wsDC::_vspan( s32 x, s32 y0, s32 y1, wsColor color )
+{
+	if ( y1 < y0 ) swapU16(y0,y1);
+	for (u16 i=0; i<m_num_clips; i++)
+	{
+		wsRect rect(x,y0,x,y1);
+		rect.intersect(m_clips[i]);
+		if (!rect.isEmpty())
+			_fillFrame(rect,color);
+	}
+}
 
+
+void wsDC::drawLine( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color )
+{
 	if ( m_opt_driver[OPT_DRIVER_DRAW_LINE])
 	{
 		// clipping not applied to optimized draw line.
 		// which needs to be passed the clipping rectangle ..
+		// so it is drawn once if it touches any of the clips
 		
-		((drawLineDriver)m_opt_driver[OPT_DRIVER_DRAW_LINE])
-			(m_pScreen, x0,y0,x1,y1,color);
+		wsRect rect(x0,y0,x1,y1);
+		for (u16 i=0; i<m_num_clips; i++)
+		{
+			if (rect.intersects(m_clips[i]))
+			{
+				((drawLineDriver)m_opt_driver[OPT_DRIVER_DRAW_LINE])
+					(m_pScreen, x0,y0,x1,y1,color);
+				return;
+			}
+		}
 		return;
 	}
 
-	s16 dx = x1 - x0;
-	s16 dy = y1 - y0;
-	s16 dxabs = (dx>0) ? dx : -dx;
-	s16 dyabs = (dy>0) ? dy : -dy;
-	s16 sgndx = (dx>0) ? 1  : -1;
-	s16 sgndy = (dy>0) ? 1  : -1;
-	s16 x = dyabs >> 1;
-	s16 y = dxabs >> 1;
-	s16 drawx = x0;
-	s16 drawy = y0;
+	// Bresenham, where the pixels that share a row (or column
+	// for steep lines) are collected into one span.
+
+	s32 dx = x1 - x0;
+	s32 dy = y1 - y0;
+	s32 dxabs = (dx>0) ? dx : -dx;
+	s32 dyabs = (dy>0) ? dy : -dy;
+	s32 sgndx = (dx>0) ? 1  : -1;
+	s32 sgndy = (dy>0) ? 1  : -1;
+	s32 x = x0;
+	s32 y = y0;
+	s32 start = 0;
 	
-	setPixel(drawx, drawy, color);
-
 	if( dxabs >= dyabs )
 	{
-		for (s16 n=0; n<dxabs; n++)
+		s32 err = dxabs >> 1;
+		start = x;
+		for (s32 n=0; n<dxabs; n++)
 		{
-			y += dyabs;
-			if (y >= dxabs)
+			err += dyabs;
+			if (err >= dxabs)
 			{
-				y -= dxabs;
-				drawy += sgndy;
+				err -= dxabs;
+				_hspan(start,x,y,color);
+				y += sgndy;
+				start = x + sgndx;
 			}
-			drawx += sgndx;
-			if (rect.intersects(drawx,drawy))
-				setPixel(drawx, drawy, color);
+			x += sgndx;
 		}
+		_hspan(start,x,y,color);
 	}
 	else
 	{
-		for (s16 n=0; n<dyabs; n++)
+		s32 err = dyabs >> 1;
+		start = y;
+		for (s32 n=0; n<dyabs; n++)
 		{
-			x += dxabs;
-			if (x >= dyabs)
+			err += dxabs;
+			if (err >= dyabs)
 			{
-				x -= dyabs;
-				drawx += sgndx;
+				err -= dyabs;
+				_vspan(x,start,y,color);
+				x += sgndx;
+				start = y + sgndy;
 			}
-			drawy += sgndy;
-			if (rect.intersects(drawx,drawy))
-				setPixel(drawx, drawy, color);
+			y += sgndy;
 		}
+		_vspan(x,start,y,color);
 	}
 }
 
 
-
 void wsDC::drawFrame( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color, u16 frame_width )
 {
 	if (!frame_width) frame_width = 1;
@@ -143,40 +228,169 @@ void wsDC::drawFrame( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color, u16 frame_w
 
 
 
+// The circles use the uGUI midpoint algorithm over one octant,
+// where x only changes every so often as y is stepped.  Each run
+// of y's for a given x is a vertical span in the octants that are
+// steep, and a horizontal span in the octants that are flat.
+// The octant bits are those of uGUI's UG_DrawArc(), counter
+// clockwise from 3 o'clock: 0x01 and 0x02 are the upper right.
 
-void wsDC::fillRoundFrame( s32 x0, s32 y0, s32 x1, s32 y1, u16 r, wsColor color )
+void wsDC::_arcSpans( s32 cx, s32 cy, s32 x, s32 y0, s32 y1, u8 s, wsColor color )
 {
-	
+	if (s & 0x01) _vspan(cx + x, cy - y1, cy - y0, color);
+	if (s & 0x02) _hspan(cx + y0, cx + y1, cy - x, color);
+	if (s & 0x04) _hspan(cx - y1, cx - y0, cy - x, color);
+	if (s & 0x08) _vspan(cx - x, cy - y1, cy - y0, color);
+	if (s & 0x10) _vspan(cx - x, cy + y0, cy + y1, color);
+	if (s & 0x20) _hspan(cx - y1, cx - y0, cy + x, color);
+	if (s & 0x40) _hspan(cx + y0, cx + y1, cy + x, color);
+	if (s & 0x80) _vspan(cx + x, cy + y0, cy + y1, color);
 }
 
-void wsDC::wsDC::drawMesh( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color )
+
+void wsDC::_fillRounded( s32 xl, s32 yt, s32 xr, s32 yb, u16 r, wsColor color )
+	// fills the rounded ends of a shape made of four quarter
+	// circles centered at the corners (xl,yt) to (xr,yb),
+	// which are the same point for a circle.
 {
-	
-}
+	s32 x = r;
+	s32 y = 0;
+	s32 e = 0;
+	s32 xd = 1 - (r << 1);
+	s32 yd = 0;
 
+	while (x >= y)
+	{
+		s32 px = x;
+		s32 py = y;
 
+		_hspan(xl - x, xr + x, yt - y, color);
+		if (y || yt != yb)
+			_hspan(xl - x, xr + x, yb + y, color);
 
-void wsDC::drawRoundFrame( s32 x0, s32 y0, s32 x1, s32 y1, u16 r, wsColor color )
+		y++;
+		e += yd;
+		yd += 2;
+		if (((e << 1) + xd) > 0)
+		{
+			x--;
+			e += xd;
+			xd += 2;
+		}
+
+		if (x != px || x < y)
+		{
+			if (px != py)
+			{
+				_hspan(xl - py, xr + py, yt - px, color);
+				_hspan(xl - py, xr + py, yb + px, color);
+			}
+		}
+	}
+}
+
+
+void wsDC::drawArc( s32 x, s32 y, u16 r, u8 s, wsColor color )
 {
-	
+	s32 ax = r;
+	s32 ay = 0;
+	s32 e = 0;
+	s32 xd = 1 - (r << 1);
+	s32 yd = 0;
+	s32 start = 0;
+
+	while (ax >= ay)
+	{
+		s32 px = ax;
+		s32 py = ay;
+
+		ay++;
+		e += yd;
+		yd += 2;
+		if (((e << 1) + xd) > 0)
+		{
+			ax--;
+			e += xd;
+			xd += 2;
+		}
+
+		if (ax != px || ax < ay)
+		{
+			_arcSpans(x,y,px,start,py,s,color);
+			start = ay;
+		}
+	}
 }
 
+
 void wsDC::drawCircle( s32 x, s32 y, u16 r, wsColor color )
 {
-	
+	drawArc(x,y,r,0xFF,color);
 }
 
+
 void wsDC::fillCircle( s32 x, s32 y, u16 r, wsColor color )
 {
-	
+	_fillRounded(x,y,x,y,r,color);
 }
 
-void wsDC::drawArc( s32 x, s32 y, u16 r, u8 s, wsColor color )
+
+void wsDC::drawRoundFrame( s32 x0, s32 y0, s32 x1, s32 y1, u16 r, wsColor color )
 {
-	
+	if ( x1 < x0 ) swapU16(x0,x1);
+	if ( y1 < y0 ) swapU16(y0,y1);
+	if ( 2*r > x1 - x0 || 2*r > y1 - y0 )
+		return;
+
+	_hspan(x0+r, x1-r, y0, color);
+	_hspan(x0+r, x1-r, y1, color);
+	_vspan(x0, y0+r, y1-r, color);
+	_vspan(x1, y0+r, y1-r, color);
+
+	drawArc(x0+r, y0+r, r, 0x0C, color);
+	drawArc(x1-r, y0+r, r, 0x03, color);
+	drawArc(x0+r, y1-r, r, 0x30, color);
+	drawArc(x1-r, y1-r, r, 0xC0, color);
 }
 
 
+void wsDC::fillRoundFrame( s32 x0, s32 y0, s32 x1, s32 y1, u16 r, wsColor color )
+{
+	if ( x1 < x0 ) swapU16(x0,x1);
+	if ( y1 < y0 ) swapU16(y0,y1);
+	if ( 2*r > x1 - x0 || 2*r > y1 - y0 )
+		return;
+
+	if (y1 - r - 1 >= y0 + r + 1)
+		fillFrame(x0, y0+r+1, x1, y1-r-1, color);
+	_fillRounded(x0+r, y0+r, x1-r, y1-r, r, color);
+}
+
+
+void wsDC::drawMesh( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color )
+	// every other pixel of every other row, as in uGUI
+{
+	if ( x1 < x0 ) swapU16(x0,x1);
+	if ( y1 < y0 ) swapU16(y0,y1);
+
+	for (u16 i=0; i<m_num_clips; i++)
+	{
+		wsRect rect(x0,y0,x1-1,y1-1);
+		rect.intersect(m_clips[i]);
+		if (rect.isEmpty())
+			continue;
+		s32 xs = rect.xs + ((rect.xs - x0) & 1);
+		s32 ys = rect.ys + ((rect.ys - y0) & 1);
+		for (s32 y=ys; y<=rect.ye; y+=2)
+		{
+			for (s32 x=xs; x<=rect.xe; x+=2)
+				setPixel(x,y,color);
+		}
+	}
+}
+
+
+
 void wsDC::_putChar( char chr, s32 x, s32 y, wsColor fc, wsColor bc, const wsRect &clip )
 {
 	// set the background and foreground to distinctive colors
@@ -215,6 +429,18 @@ void wsDC::_putChar( char chr, s32 x, s32 y, wsColor fc, wsColor bc, const wsRec
 	if (rect.isEmpty())
 		return;
 
+	// cached glyphs are clipped as a whole and
+	// sent to the screen a row at a time
+
+	const wsGlyph *glyph = m_glyphs.get(m_pFont,bt,fc,bc);
+	if (glyph)
+	{
+		_blit(rect,
+			&glyph->pixels[(rect.ys - y) * char_width + rect.xs - x],
+			char_width);
+		return;
+	}
+
 	s32 bn = char_width >> 3;
 	if (char_width % 8)
 		bn++;
@@ -286,12 +512,48 @@ void wsDC::_putChar( char chr, s32 x, s32 y, wsColor fc, wsColor bc, const wsRec
 }
 
 
+void wsDC::_blit( const wsRect &rect, const wsColor *pixels, s32 stride )
+	// rect is already clipped, and pixels points at its top left
+{
+	if ( m_opt_driver[OPT_DRIVER_BLIT])
+	{
+		((blitDriver)m_opt_driver[OPT_DRIVER_BLIT])
+			(m_pScreen,rect.xs,rect.ys,rect.xe,rect.ye,pixels,stride);
+		return;
+	}
+
+	s32 width = rect.getWidth();
+	if ( m_opt_driver[OPT_DRIVER_FILL_AREA])
+	{
+		pushPixelFxn pushPixel = ((fillAreaDriver)m_opt_driver[OPT_DRIVER_FILL_AREA])
+			(m_pScreen, rect.xs, rect.ys, rect.xe, rect.ye);
+		for (s32 y=rect.ys; y<=rect.ye; y++, pixels += stride)
+		{
+			for (s32 i=0; i<width; i++)
+				pushPixel(m_pScreen,pixels[i]);
+		}
+		return;
+	}
+
+	for (s32 y=rect.ys; y<=rect.ye; y++, pixels += stride)
+	{
+		for (s32 i=0; i<width; i++)
+			setPixel(rect.xs + i,y,pixels[i]);
+	}
+}
+
+
 void wsDC::putString( s32 x, s32 y, const char* str )
+{
+	for (u16 i=0; i<m_num_clips; i++)
+		_putString(x,y,str,m_clips[i]);
+}
+
+
+void wsDC::_putString( s32 x, s32 y, const char* str, const wsRect &clip )
 {
 	s32 xp = x;
 	s32 yp = y;
-	if (m_clip.isEmpty())
-		return;
 	
 	assert(m_pFont);
 	while ( *str != 0 )
@@ -315,7 +577,7 @@ void wsDC::putString( s32 x, s32 y, const char* str )
 			yp += m_pFont->char_height + m_vspace;
 		}
 		
-		_putChar(chr, xp, yp, m_fore_color, m_back_color, m_clip);
+		_putChar(chr, xp, yp, m_fore_color, m_back_color, clip);
 		
 		xp += cw + m_hspace;
 	}	
@@ -335,9 +597,23 @@ void wsDC::putText(
 		return;
 	if (!text || !*text)
 		return;
-	
+	for (u16 i=0; i<m_num_clips; i++)
+		_putText(bc,fc,area,align,hspace,vspace,text,m_clips[i]);
+}
+
+
+void wsDC::_putText(
+	wsColor bc,
+	wsColor fc,
+	const wsRect &area,
+	wsAlignType align,
+	s16     hspace,
+	s16     vspace,
+	const char *text,
+	const wsRect &clip)
+{
 	wsRect rect(area);
-	rect.intersect(m_clip);
+	rect.intersect(clip);
 	if (rect.isEmpty())
 		return;
 		
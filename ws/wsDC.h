@@ -9,6 +9,7 @@
 
 #include "wsColor.h"
 #include "wsFont.h"
+#include "wsGlyphCache.h"
 #include "wsRect.h"
 #include <circle/screen.h>
 
@@ -17,10 +18,15 @@
 // wsDeviceContext
 //-----------------------------------
 
-#define NUM_OPT_DRIVERS  			3
+#define NUM_OPT_DRIVERS  			5
 #define OPT_DRIVER_DRAW_LINE        0
 #define OPT_DRIVER_FILL_FRAME       1
 #define OPT_DRIVER_FILL_AREA        2
+#define OPT_DRIVER_FLUSH            3
+	// for screens that buffer their drawing, called at
+	// the end of every wsApplication::timeSlice()
+#define OPT_DRIVER_BLIT             4
+	// copies a rectangle of pixels, a row at a time
 
 
 class wsDC
@@ -45,6 +51,8 @@ class wsDC
 				for (int i=0; i<NUM_OPT_DRIVERS; i++)
 					m_opt_driver[i] = 0;
 				m_invalid.empty();
+				m_clips[0].assign(m_clip);
+				m_num_clips = 1;
 			}
 
 		CScreenDeviceBase *getScreen() 	{ return m_pScreen; }
@@ -53,6 +61,7 @@ class wsDC
 		void setPixel(s32 x, s32 y, wsColor color)
 			{ m_pScreen->SetPixel(x,y,color); }
 
+		void flush();
 		void fillScreen( wsColor color );
 		void fillFrame( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color );
 		void drawLine( s32 x0, s32 y0, s32 x1, s32 y1, wsColor color );
@@ -70,23 +79,25 @@ class wsDC
 		void putString( s32 x, s32 y, const char* str );
 
 		const wsRect &getClip()  { return m_clip; }
-		void setClip(const wsRect &rect, bool invalid)
+			// the bounding rectangle of the current clipping list
+		bool inClip(s32 x, s32 y) const;
+		void setClip(const wsRect &rect, bool invalid);
 			// temporarily set to the window clipping region
-			// for the next call(s)
-		{
-			m_clip.assign(rect);
-			if (invalid && !m_invalid.isEmpty())
-				m_clip.intersect(m_invalid);
-		}
-		const wsRect &getInvalid()			{ return m_invalid; }			
+			// for the next call(s).  If invalid, the clipping
+			// region is the intersection of rect with each of
+			// the rectangles in the invalid region, and the
+			// drawing methods draw once for each.
+		const wsRegion &getInvalid()		{ return m_invalid; }
 		void validate()						{ m_invalid.empty(); }
-		void invalidate(const wsRect &rect)	{ m_invalid.expand(rect); }
+		void invalidate(const wsRect &rect)	{ m_invalid.add(rect); }
 			// sets an area of the screen as invalid (needs repainting)
 			// so drawing methods only draw to the intersection of the
 			// clipping region and the invalid region.  The invalid region
 			// is cleared at the end of timeSlice() before sending events,
 			// and then windows that intersect it are set to REDRAW at
-			// the start of the loop.
+			// the start of the loop.  The region is kept as a small set
+			// of disjoint rectangles (see wsRegion) so that unrelated
+			// areas of the screen do not redraw everything between them.
 		
 		void putText(
 			wsColor bc,
@@ -118,6 +129,22 @@ class wsDC
 		wsDC() {}
 
 		void _putChar( char chr, s32 x, s32 y, wsColor fc, wsColor bc, const wsRect &clip);
+		void _fillFrame( const wsRect &rect, wsColor color );
+		void _blit( const wsRect &rect, const wsColor *pixels, s32 stride );
+		void _hspan( s32 x0, s32 x1, s32 y, wsColor color );
+		void _vspan( s32 x, s32 y0, s32 y1, wsColor color );
+		void _arcSpans( s32 cx, s32 cy, s32 x, s32 y0, s32 y1, u8 s, wsColor color );
+		void _fillRounded( s32 xl, s32 yt, s32 xr, s32 yb, u16 r, wsColor color );
+		void _putString( s32 x, s32 y, const char* str, const wsRect &clip );
+		void _putText(
+			wsColor bc,
+			wsColor fc,
+			const wsRect &area,
+			wsAlignType align,
+			s16     hspace,
+			s16     vspace,
+			const char *text,
+			const wsRect &clip);
 		
 		CScreenDeviceBase *m_pScreen;
 		
@@ -125,7 +152,9 @@ class wsDC
 		s32 m_ydim;
 		
 		wsRect m_clip;
-		wsRect m_invalid;
+		wsRegion m_invalid;
+		u16 m_num_clips;
+		wsRect m_clips[WS_REGION_MAX_RECTS];
 
 		const wsFont *m_pFont;
 		wsColor m_fore_color;
@@ -135,6 +164,8 @@ class wsDC
 		s16 m_vspace;
 		
 		void *m_opt_driver[NUM_OPT_DRIVERS];
+
+		wsGlyphCache m_glyphs;
 		
 };	// wsDC
 
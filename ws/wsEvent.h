@@ -30,14 +30,14 @@ class wsEvent
 {
 	public:
 	
+		wsEvent() :
+			m_type(0),
+			m_id(0),
+			m_obj(0) {}
 		wsEvent(u32 type, u32 id, wsWindow *obj) :
 			m_type(type),
 			m_id(id),
-			m_obj(obj)
-		{
-			m_pNext = 0;
-			m_pPrev = 0;
-		}
+			m_obj(obj) {}
 
 		~wsEvent() {}
 		
@@ -53,9 +53,6 @@ class wsEvent
 		u32 m_id;
 		wsWindow *m_obj;
 		
-		wsEvent *m_pNext;
-		wsEvent *m_pPrev;
-		
 };	// wsEvent
 
 
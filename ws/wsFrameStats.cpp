@@ -0,0 +1,123 @@
+//
+// wsWindows
+//
+// A event driven windowing system that kind of combines uGUI and wxWindows.
+// Written for the rPi Circle bare metal C++ libraries.
+
+#include "wsFrameStats.h"
+#include <circle/timer.h>
+#include <circle/logger.h>
+#include <circle/util.h>
+#include <utils/myUtils.h>
+
+#define log_name  "wsframe"
+
+
+static const char *phase_names[WS_FRAME_NUM_TIMES] =
+{
+	"touch",
+	"midi",
+	"tick",
+	"update",
+	"events",
+	"flush",
+	"total",
+};
+
+
+wsFrameStats::wsFrameStats()
+{
+	m_frame_start = 0;
+	m_phase_start = 0;
+	m_num_frames = 0;
+	memset(m_last,0,sizeof(m_last));
+	memset(m_max,0,sizeof(m_max));
+	memset(m_hist,0,sizeof(m_hist));
+}
+
+
+// static
+const char *wsFrameStats::getPhaseName(u8 phase)
+{
+	return phase < WS_FRAME_NUM_TIMES ? phase_names[phase] : "?";
+}
+
+
+void wsFrameStats::startFrame()
+{
+	m_frame_start = CTimer::GetClockTicks();
+	m_phase_start = m_frame_start;
+}
+
+
+void wsFrameStats::endPhase(u8 phase)
+{
+	u32 now = CTimer::GetClockTicks();
+	addTime(phase,now - m_phase_start);
+	m_phase_start = now;
+}
+
+
+void wsFrameStats::endFrame()
+{
+	addTime(WS_FRAME_TOTAL,CTimer::GetClockTicks() - m_frame_start);
+
+	if (++m_num_frames % WS_FRAME_STATS_DECAY == 0)
+	{
+		for (u8 i=0; i<WS_FRAME_NUM_TIMES; i++)
+		{
+			m_max[i] >>= 1;
+			for (u8 j=0; j<WS_FRAME_HIST_BUCKETS; j++)
+				m_hist[i][j] >>= 1;
+		}
+	}
+}
+
+
+void wsFrameStats::addTime(u8 phase, u32 us)
+{
+	m_last[phase] = us;
+	if (us > m_max[phase])
+		m_max[phase] = us;
+
+	u8 bucket = us ? 31 - __builtin_clz(us) : 0;
+	if (bucket >= WS_FRAME_HIST_BUCKETS)
+		bucket = WS_FRAME_HIST_BUCKETS - 1;
+	m_hist[phase][bucket]++;
+}
+
+
+u32 wsFrameStats::getPercentile(u8 phase, u8 percent) const
+{
+	const u16 *hist = m_hist[phase];
+	u32 total = 0;
+	for (u8 i=0; i<WS_FRAME_HIST_BUCKETS; i++)
+		total += hist[i];
+	if (!total)
+		return 0;
+
+	u32 want = (total * percent + 99) / 100;
+	u32 count = 0;
+	for (u8 i=0; i<WS_FRAME_HIST_BUCKETS; i++)
+	{
+		count += hist[i];
+		if (count >= want)
+			return (2 << i) - 1;
+	}
+	return (2 << (WS_FRAME_HIST_BUCKETS-1)) - 1;
+}
+
+
+void wsFrameStats::logStats() const
+{
+	LOG("frames(%d)",m_num_frames);
+	for (u8 i=0; i<WS_FRAME_NUM_TIMES; i++)
+	{
+		LOG("%-7s last(%5d) max(%5d) p50(%5d) p99(%5d)",
+			getPhaseName(i),
+			m_last[i],
+			m_max[i],
+			getPercentile(i,50),
+			getPercentile(i,99));
+	}
+}
@@ -0,0 +1,75 @@
+//
+// wsWindows
+//
+// A event driven windowing system that kind of combines uGUI and wxWindows.
+// Written for the rPi Circle bare metal C++ libraries.
+
+#ifndef _wsFrameStats_h
+#define _wsFrameStats_h
+
+#include <circle/types.h>
+
+
+//------------------------------------
+// wsFrameStats
+//------------------------------------
+// Times each phase of a wsApplication::timeSlice() frame, and the
+// frame as a whole, in microseconds.  Besides the last and maximum
+// times, each phase has a histogram of power of two buckets, where
+// bucket n counts the frames that took from 2^n to 2^(n+1)-1 us.
+//
+// The histograms are rolling: every WS_FRAME_STATS_DECAY frames all
+// counts, and the maximums, are halved, so they mostly describe the
+// last few seconds.  Everything is written and read on the UI core.
+
+#define WS_FRAME_PHASE_TOUCH		0
+#define WS_FRAME_PHASE_MIDI			1
+#define WS_FRAME_PHASE_TICK			2		// updateFrame()
+#define WS_FRAME_PHASE_UPDATE		3		// update() and draw()
+#define WS_FRAME_PHASE_EVENTS		4
+#define WS_FRAME_PHASE_FLUSH		5
+#define WS_FRAME_TOTAL				6
+#define WS_FRAME_NUM_TIMES			7
+
+#define WS_FRAME_HIST_BUCKETS		16		// the last one holds 32ms and up
+#define WS_FRAME_STATS_DECAY		256		// frames
+
+
+class wsFrameStats
+{
+public:
+
+	wsFrameStats();
+
+	void startFrame();
+	void endPhase(u8 phase);
+		// adds the time since the start of the frame,
+		// or the end of the previous phase, to the phase
+	void endFrame();
+
+	u32 getNumFrames() const				{ return m_num_frames; }
+	u32 getLast(u8 phase) const				{ return m_last[phase]; }
+	u32 getMax(u8 phase) const				{ return m_max[phase]; }
+	const u16 *getHistogram(u8 phase) const	{ return m_hist[phase]; }
+	u32 getPercentile(u8 phase, u8 percent) const;
+		// the upper bound, in us, of the bucket that holds
+		// the given percentile of the phase's histogram
+
+	static const char *getPhaseName(u8 phase);
+	void logStats() const;
+
+private:
+
+	u32 m_frame_start;
+	u32 m_phase_start;
+	u32 m_num_frames;
+	u32 m_last[WS_FRAME_NUM_TIMES];
+	u32 m_max[WS_FRAME_NUM_TIMES];
+	u16 m_hist[WS_FRAME_NUM_TIMES][WS_FRAME_HIST_BUCKETS];
+
+	void addTime(u8 phase, u32 us);
+
+};
+
+
+#endif  // !_wsFrameStats_h
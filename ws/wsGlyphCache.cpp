@@ -0,0 +1,145 @@
+//
+// wsWindows
+//
+// A event driven windowing system that kind of combines uGUI and wxWindows.
+// Written for the rPi Circle bare metal C++ libraries.
+
+#include "wsGlyphCache.h"
+#include <circle/util.h>
+
+
+wsGlyphCache::wsGlyphCache()
+{
+	m_hits = 0;
+	m_misses = 0;
+	m_pPixels = new wsColor[WS_GLYPH_CACHE_SLOTS * WS_GLYPH_MAX_PIXELS];
+
+	// all slots start out empty on the lru list
+
+	for (u16 i=0; i<WS_GLYPH_CACHE_SLOTS; i++)
+	{
+		wsGlyph *glyph = &m_glyph[i];
+		glyph->font = 0;
+		glyph->pixels = &m_pPixels[i * WS_GLYPH_MAX_PIXELS];
+		glyph->hash_next = 0;
+		glyph->lru_prev = i ? &m_glyph[i-1] : 0;
+		glyph->lru_next = i < WS_GLYPH_CACHE_SLOTS-1 ? &m_glyph[i+1] : 0;
+	}
+	m_pMRU = &m_glyph[0];
+	m_pLRU = &m_glyph[WS_GLYPH_CACHE_SLOTS-1];
+
+	for (u16 i=0; i<WS_GLYPH_HASH_SIZE; i++)
+		m_hash[i] = 0;
+}
+
+
+wsGlyphCache::~wsGlyphCache()
+{
+	delete [] m_pPixels;
+}
+
+
+// static
+u32 wsGlyphCache::hash(const wsFont *pFont, u8 chr, wsColor fc, wsColor bc)
+{
+	u32 h = ((u32) pFont) >> 2;
+	h = h * 31 + chr;
+	h = h * 31 + fc;
+	h = h * 31 + bc;
+	return (h ^ (h >> 12)) & (WS_GLYPH_HASH_SIZE - 1);
+}
+
+
+void wsGlyphCache::unhash(wsGlyph *glyph)
+{
+	wsGlyph **pp = &m_hash[hash(glyph->font,glyph->chr,glyph->fc,glyph->bc)];
+	while (*pp && *pp != glyph)
+		pp = &(*pp)->hash_next;
+	if (*pp)
+		*pp = glyph->hash_next;
+	glyph->hash_next = 0;
+}
+
+
+void wsGlyphCache::moveToFront(wsGlyph *glyph)
+{
+	if (glyph == m_pMRU)
+		return;
+
+	glyph->lru_prev->lru_next = glyph->lru_next;
+	if (glyph->lru_next)
+		glyph->lru_next->lru_prev = glyph->lru_prev;
+	else
+		m_pLRU = glyph->lru_prev;
+
+	glyph->lru_prev = 0;
+	glyph->lru_next = m_pMRU;
+	m_pMRU->lru_prev = glyph;
+	m_pMRU = glyph;
+}
+
+
+void wsGlyphCache::render(wsGlyph *glyph)
+	// same bit order as wsDC::_putChar(),
+	// lsb first, rows padded to whole bytes
+{
+	const wsFont *pFont = glyph->font;
+	s32 char_width = pFont->char_width;
+	s32 char_height = pFont->char_height;
+	s32 bn = (char_width + 7) >> 3;
+	const u8 *src = &pFont->p[(glyph->chr - pFont->start_char) * char_height * bn];
+	wsColor *dest = glyph->pixels;
+
+	for (s32 j=0; j<char_height; j++)
+	{
+		s32 c = char_width;
+		for (s32 i=0; i<bn; i++)
+		{
+			u8 b = *src++;
+			for (s32 k=0; (k<8) && c; k++, c--)
+			{
+				*dest++ = (b & 0x01) ? glyph->fc : glyph->bc;
+				b >>= 1;
+			}
+		}
+	}
+}
+
+
+const wsGlyph *wsGlyphCache::get(const wsFont *pFont, u8 chr, wsColor fc, wsColor bc)
+{
+	if (pFont->char_width * pFont->char_height > WS_GLYPH_MAX_PIXELS)
+		return 0;
+
+	u32 h = hash(pFont,chr,fc,bc);
+	for (wsGlyph *glyph = m_hash[h]; glyph; glyph = glyph->hash_next)
+	{
+		if (glyph->font == pFont &&
+			glyph->chr == chr &&
+			glyph->fc == fc &&
+			glyph->bc == bc)
+		{
+			m_hits++;
+			moveToFront(glyph);
+			return glyph;
+		}
+	}
+
+	// reuse the least recently used slot
+
+	m_misses++;
+	wsGlyph *glyph = m_pLRU;
+	if (glyph->font)
+		unhash(glyph);
+
+	glyph->font = pFont;
+	glyph->chr = chr;
+	glyph->fc = fc;
+	glyph->bc = bc;
+	render(glyph);
+
+	glyph->hash_next = m_hash[h];
+	m_hash[h] = glyph;
+	moveToFront(glyph);
+	return glyph;
+}
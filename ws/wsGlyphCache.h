@@ -0,0 +1,77 @@
+//
+// wsWindows
+//
+// A event driven windowing system that kind of combines uGUI and wxWindows.
+// Written for the rPi Circle bare metal C++ libraries.
+
+#ifndef _wsGlyphCache_h
+#define _wsGlyphCache_h
+
+#include "wsColor.h"
+#include "wsFont.h"
+
+
+//------------------------------------
+// wsGlyphCache
+//------------------------------------
+// Characters rendered into RGB565 pixels for a given font and
+// pair of colors, so that wsDC can blit them a row at a time
+// instead of walking the font bitmap for every pixel.
+//
+// There are a fixed number of slots, each big enough for the
+// largest compiled in font (16x26).  Bigger fonts are not cached.
+// When all slots are in use the least recently used glyph is
+// thrown away.
+
+#define WS_GLYPH_CACHE_SLOTS     128
+#define WS_GLYPH_MAX_PIXELS      (16 * 26)
+#define WS_GLYPH_HASH_SIZE       64		// power of 2
+
+
+typedef struct wsGlyphStruct
+{
+	const wsFont *font;
+	u16 chr;
+	wsColor fc;
+	wsColor bc;
+	wsColor *pixels;		// char_width * char_height
+
+	struct wsGlyphStruct *hash_next;
+	struct wsGlyphStruct *lru_prev;
+	struct wsGlyphStruct *lru_next;
+
+}   wsGlyph;
+
+
+class wsGlyphCache
+{
+public:
+
+	wsGlyphCache();
+	~wsGlyphCache();
+
+	const wsGlyph *get(const wsFont *pFont, u8 chr, wsColor fc, wsColor bc);
+		// returns 0 if the font is too big to cache
+
+	u32 getHits() const		{ return m_hits; }
+	u32 getMisses() const	{ return m_misses; }
+
+private:
+
+	wsGlyph m_glyph[WS_GLYPH_CACHE_SLOTS];
+	wsGlyph *m_hash[WS_GLYPH_HASH_SIZE];
+	wsGlyph *m_pMRU;
+	wsGlyph *m_pLRU;
+	wsColor *m_pPixels;
+
+	u32 m_hits;
+	u32 m_misses;
+
+	static u32 hash(const wsFont *pFont, u8 chr, wsColor fc, wsColor bc);
+	void unhash(wsGlyph *glyph);
+	void moveToFront(wsGlyph *glyph);
+	void render(wsGlyph *glyph);
+};
+
+
+#endif  // !_wsGlyphCache_h
@@ -38,14 +38,8 @@ public:
             hide();
             
             
-            // you cannot call addEvent() from handleEvent() !!!
-            //            
-            // it cannot just get added to the list of events
-            // being generated as they are also simultaneously
-            // being dispatched!
-            //
-            // addPendingEvent() is not implemented yet!
-            // so we send it directly to the next up top window ..
+            // we send it directly to the next up top window
+            // rather than re-queueing it with addEvent()
 
             return m_pParent->getTopWindow()->handleEvent(event);
         }
@@ -58,14 +58,14 @@ void wsMidiButton::onUpdateTouch(bool touched)
 {
 	// LOG("onUpdateTouch(%s) touched=%d",getText(),touched);
 	m_pressed = touched;
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 
 	if (touched)
 	{
-		getApplication()->addEvent(new wsEvent(
+		getApplication()->addEvent(
 			EVT_TYPE_BUTTON,
 			EVENT_CLICK,
-			this ));
+			this );
 	}
 }
 
@@ -80,14 +80,14 @@ void wsMidiButton::staticHandleMidiEvent(void *pThis, midiEvent *event)
 void wsMidiButton::handleMidiEvent(midiEvent *event)
 {
 	m_pressed = event->getMsg() == MIDI_EVENT_NOTE_ON;
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 
 	if (m_pressed)
 	{
-		getApplication()->addEvent(new wsEvent(
+		getApplication()->addEvent(
 			EVT_TYPE_BUTTON,
 			EVENT_CLICK,
-			this ));
+			this );
 	}
 }
 
@@ -183,4 +183,120 @@ wsRect &wsRect::expand(const wsRect &rect)
 }
 
 
+//------------------------------------
+// wsRegion
+//------------------------------------
 
+static s32 mergeCost(const wsRect &a, const wsRect &b)
+	// the number of pixels in the bounding rectangle
+	// of two disjoint rectangles that are in neither
+{
+	wsRect bounds(a);
+	bounds.expand(b);
+	return bounds.getWidth() * bounds.getHeight()
+		- a.getWidth() * a.getHeight()
+		- b.getWidth() * b.getHeight();
+}
+
+
+wsRegion::wsRegion()
+{
+	empty();
+}
+
+
+wsRegion &wsRegion::empty()
+{
+	m_num_rects = 0;
+	m_bounds.empty();
+	return *this;
+}
+
+
+bool wsRegion::intersects(const wsRect &rect) const
+{
+	if (!m_bounds.intersects(rect))
+		return false;
+	for (u16 i=0; i<m_num_rects; i++)
+	{
+		if (m_rect[i].intersects(rect))
+			return true;
+	}
+	return false;
+}
+
+
+u16 wsRegion::clip(const wsRect &rect, wsRect *pOut) const
+{
+	u16 num = 0;
+	for (u16 i=0; i<m_num_rects; i++)
+	{
+		pOut[num].assign(rect);
+		pOut[num].intersect(m_rect[i]);
+		if (!pOut[num].isEmpty())
+			num++;
+	}
+	return num;
+}
+
+
+wsRegion &wsRegion::add(const wsRect &rect)
+{
+	if (rect.isEmpty())
+		return *this;
+
+	// the common case is a control invalidating
+	// the same rectangle every frame
+
+	for (u16 i=0; i<m_num_rects; i++)
+	{
+		const wsRect &r = m_rect[i];
+		if (rect.xs >= r.xs && rect.ys >= r.ys &&
+			rect.xe <= r.xe && rect.ye <= r.ye)
+			return *this;
+	}
+
+	// Merge with anything that overlaps or is cheap to merge with.
+	// The merged rectangle may now overlap others, so start over
+	// until nothing changes.  If there is no room for it as a
+	// separate rectangle, merge with the cheapest one and go again.
+
+	wsRect new_rect(rect);
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (u16 i=0; i<m_num_rects; i++)
+		{
+			if (new_rect.intersects(m_rect[i]) ||
+				mergeCost(new_rect,m_rect[i]) <= WS_REGION_MERGE_SLACK)
+			{
+				new_rect.expand(m_rect[i]);
+				remove(i);
+				merged = true;
+				break;
+			}
+		}
+		if (!merged && m_num_rects == WS_REGION_MAX_RECTS)
+		{
+			u16 best = 0;
+			s32 best_cost = mergeCost(new_rect,m_rect[0]);
+			for (u16 i=1; i<m_num_rects; i++)
+			{
+				s32 cost = mergeCost(new_rect,m_rect[i]);
+				if (cost < best_cost)
+				{
+					best = i;
+					best_cost = cost;
+				}
+			}
+			new_rect.expand(m_rect[best]);
+			remove(best);
+			merged = true;
+		}
+	}
+
+	m_rect[m_num_rects++].assign(new_rect);
+	m_bounds.expand(new_rect);
+	return *this;
+}
@@ -55,4 +55,47 @@ public:
 };
 
 
+//------------------------------------
+// wsRegion
+//------------------------------------
+// A small bounded set of non-overlapping rectangles used for the
+// invalid region of the DC.  Rectangles that overlap, or that
+// would waste fewer than WS_REGION_MERGE_SLACK pixels if merged,
+// are combined into their bounding rectangle.  When the set is
+// full, the pair that wastes the least is merged, so a region
+// degrades gracefully into the old single bounding rectangle.
+
+#define WS_REGION_MAX_RECTS      8
+#define WS_REGION_MERGE_SLACK    1024		// pixels, about 32x32
+
+class wsRegion
+{
+public:
+
+	wsRegion();
+
+	wsRegion &empty();
+	wsRegion &add(const wsRect &rect);
+
+	bool isEmpty() const					{ return !m_num_rects; }
+	bool intersects(const wsRect &rect) const;
+	u16 getNumRects() const					{ return m_num_rects; }
+	const wsRect &getRect(u16 i) const		{ return m_rect[i]; }
+	const wsRect &getBounds() const			{ return m_bounds; }
+
+	u16 clip(const wsRect &rect, wsRect *pOut) const;
+		// fills pOut[] with the non-empty intersections of rect
+		// with the region, and returns how many there are.
+		// pOut must hold WS_REGION_MAX_RECTS rectangles.
+
+private:
+
+	void remove(u16 i)		{ m_rect[i].assign(m_rect[--m_num_rects]); }
+
+	u16 m_num_rects;
+	wsRect m_rect[WS_REGION_MAX_RECTS];
+	wsRect m_bounds;
+};
+
+
 #endif  // !_wsRect_h
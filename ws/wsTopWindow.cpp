@@ -7,6 +7,7 @@
 #include "wsTopWindow.h"
 #include "wsApp.h"
 #include "wsEvent.h"
+#include <circle/util.h>
 
 #include <circle/logger.h>
 #define log_name  "wstop"
@@ -21,23 +22,170 @@ wsTopLevelWindow::wsTopLevelWindow(wsApplication *pParent, u16 id, s32 xs, s32 y
 {
 	m_pPrevWindow = 0;
 	m_pNextWindow = 0;
+	m_index = 0;
+	m_index_size = 0;
+	memset(m_cell_start,0,sizeof(m_cell_start));
+	setBit(m_state,WIN_STATE_INDEX_STALE);
 	pParent->addTopLevelWindow(this);
 }
 
 
+wsTopLevelWindow::~wsTopLevelWindow()
+{
+	if (m_index)
+		delete [] m_index;
+	m_index = 0;
+}
+
+
+//----------------------------------------------
+// spatial index
+//----------------------------------------------
+
+void wsTopLevelWindow::getCells(const wsRect &rect, u16 *c0, u16 *r0, u16 *c1, u16 *r1) const
+	// the range of cells a rectangle touches, clamped to the grid,
+	// so windows (and invalid rects) that extend past the top level
+	// window land in the edge cells.
+{
+	s32 width = m_index_rect.getWidth();
+	s32 height = m_index_rect.getHeight();
+	if (!width) width = 1;
+	if (!height) height = 1;
+
+	s32 xs = (rect.xs - m_index_rect.xs) * WS_INDEX_COLS / width;
+	s32 xe = (rect.xe - m_index_rect.xs) * WS_INDEX_COLS / width;
+	s32 ys = (rect.ys - m_index_rect.ys) * WS_INDEX_ROWS / height;
+	s32 ye = (rect.ye - m_index_rect.ys) * WS_INDEX_ROWS / height;
+
+	*c0 = xs < 0 ? 0 : xs >= WS_INDEX_COLS ? WS_INDEX_COLS-1 : xs;
+	*c1 = xe < 0 ? 0 : xe >= WS_INDEX_COLS ? WS_INDEX_COLS-1 : xe;
+	*r0 = ys < 0 ? 0 : ys >= WS_INDEX_ROWS ? WS_INDEX_ROWS-1 : ys;
+	*r1 = ye < 0 ? 0 : ye >= WS_INDEX_ROWS ? WS_INDEX_ROWS-1 : ye;
+}
+
+
+void wsTopLevelWindow::indexWindow(wsWindow *pWin, bool fill)
+	// Pre-order, so that each cell lists windows in the same
+	// order that the old recursive hitTest() visited them.
+	// The first pass counts, the second fills.
+{
+	if (!pWin->m_rect_abs.isEmpty())
+	{
+		u16 c0,r0,c1,r1;
+		getCells(pWin->m_rect_abs,&c0,&r0,&c1,&r1);
+		for (u16 row=r0; row<=r1; row++)
+		{
+			for (u16 col=c0; col<=c1; col++)
+			{
+				u16 cell = row * WS_INDEX_COLS + col;
+				if (fill)
+					m_index[m_cell_start[cell] + m_cell_fill[cell]] = pWin;
+				m_cell_fill[cell]++;
+			}
+		}
+	}
+	for (wsWindow *p = pWin->m_pFirstChild; p; p=p->m_pNextSibling)
+	{
+		indexWindow(p,fill);
+	}
+}
+
+
+void wsTopLevelWindow::rebuildIndex()
+{
+	clearBit(m_state,WIN_STATE_INDEX_STALE);
+	m_index_rect.assign(m_rect_abs);
+
+	memset(m_cell_fill,0,sizeof(m_cell_fill));
+	for (wsWindow *p = m_pFirstChild; p; p=p->m_pNextSibling)
+	{
+		indexWindow(p,false);
+	}
+
+	u16 total = 0;
+	for (u16 i=0; i<WS_INDEX_CELLS; i++)
+	{
+		m_cell_start[i] = total;
+		total += m_cell_fill[i];
+	}
+	m_cell_start[WS_INDEX_CELLS] = total;
+
+	if (total > m_index_size)
+	{
+		if (m_index)
+			delete [] m_index;
+		m_index_size = total + 32;
+		m_index = new wsWindow *[m_index_size];
+		if (!m_index)
+		{
+			LOG_ERROR("could not allocate index(%d)",m_index_size);
+			m_index_size = 0;
+			memset(m_cell_start,0,sizeof(m_cell_start));
+			return;
+		}
+	}
+
+	memset(m_cell_fill,0,sizeof(m_cell_fill));
+	for (wsWindow *p = m_pFirstChild; p; p=p->m_pNextSibling)
+	{
+		indexWindow(p,true);
+	}
+}
+
+
+void wsTopLevelWindow::markInvalid(const wsRegion &invalid)
+{
+	if (!invalid.intersects(m_rect_abs))
+		return;
+	setBit(m_state,WIN_STATE_INVALID);
+	if (m_state & WIN_STATE_INDEX_STALE)
+		rebuildIndex();
+
+	for (u16 i=0; i<invalid.getNumRects(); i++)
+	{
+		const wsRect &rect = invalid.getRect(i);
+		u16 c0,r0,c1,r1;
+		getCells(rect,&c0,&r0,&c1,&r1);
+		for (u16 row=r0; row<=r1; row++)
+		{
+			for (u16 col=c0; col<=c1; col++)
+			{
+				u16 cell = row * WS_INDEX_COLS + col;
+				for (u16 j=m_cell_start[cell]; j<m_cell_start[cell+1]; j++)
+				{
+					wsWindow *p = m_index[j];
+					if (!(p->m_state & WIN_STATE_INVALID) &&
+						p->m_rect_abs.intersects(rect))
+					{
+						setBit(p->m_state,WIN_STATE_INVALID);
+						p->setSubtreeDirty();
+					}
+				}
+			}
+		}
+	}
+}
+
+
 wsWindow* wsTopLevelWindow::hitTest(s32 x, s32 y)
 	// the current top level window is presumed
 	// to be visible ... 
+	// Only the windows in the touched cell of the index are
+	// checked, and the first one hit (in tree order) gets the
+	// base class hitTest() call that sets its touch state.
 {
 	wsWindow *found = 0;
-	wsWindow *p = m_pFirstChild;
-	while (p)
+	if (m_state & WIN_STATE_INDEX_STALE)
+		rebuildIndex();
+
+	wsRect point(x,y,x,y);
+	u16 col,row,c1,r1;
+	getCells(point,&col,&row,&c1,&r1);
+	u16 cell = row * WS_INDEX_COLS + col;
+	for (u16 j=m_cell_start[cell]; !found && j<m_cell_start[cell+1]; j++)
 	{
-		found = p->hitTest(x,y);
-		if (found)
-			p = 0;
-		else
-			p = p->m_pNextSibling;
+		if (m_index[j]->hits(x,y))
+			found = m_index[j]->hitTest(x,y);
 	}
 	// LOG("hitTest() found=%08x",found);
 	if (found)
@@ -55,10 +203,10 @@ wsWindow* wsTopLevelWindow::hitTest(s32 x, s32 y)
 		LOG("%08x:%d WIN_STYLE_POPUP generating EVENT_CLICK_OUTSIDE",(u32)this,m_id);
 		if (!m_rect_abs.intersects(x,y))
 		{
-			getApplication()->addEvent(new wsEvent(
+			getApplication()->addEvent(
 				EVT_TYPE_WINDOW,
 				EVENT_CLICK_OUTSIDE,
-				this ));
+				this );
 		}
 	}
 	
@@ -82,12 +230,6 @@ u32 wsTopLevelWindow::handleEvent(wsEvent *event)
 		assert(event->getObject() == this);
 		debugUpdate(1);
 		
-		// not that we don't try to dispatch an event 
-		// from an event handler
-		//
-		// you cannot call addEvent() from handleEvent() !!!
-		// and addPendingEvent() is not implemented yet!
-		
 		hide();
 		result_handled = 1;
 	}
@@ -12,13 +12,27 @@
 //-------------------------------------------
 // top level window
 //-------------------------------------------
+// Each top level window keeps a spatial index of the windows
+// in it, a uniform grid over its absolute rectangle where each
+// cell lists, in tree order, the windows whose m_rect_abs touch
+// it.  It is used to find the window under a touch, and the
+// windows under the invalid region, without walking the tree.
+//
+// The index is rebuilt lazily, on the next lookup after any window
+// in the tree is added, deleted, or sized (which includes resize()
+// and move()).  Visibility is checked when the index is used, so
+// show() and hide() do not require a rebuild.
+
+#define WS_INDEX_COLS	8
+#define WS_INDEX_ROWS	8
+#define WS_INDEX_CELLS	(WS_INDEX_COLS * WS_INDEX_ROWS)
 
 class wsTopLevelWindow : public wsWindow
 {
 	public:
 	
 		wsTopLevelWindow(wsApplication *pApp, u16 id, s32 xs, s32 ys, s32 xe, s32 ye, u32 style=0);
-		~wsTopLevelWindow() {}
+		~wsTopLevelWindow();
 		
 		virtual wsApplication *getApplication() const
 			{ return (wsApplication *) m_pParent; }
@@ -29,6 +43,11 @@ class wsTopLevelWindow : public wsWindow
 		// not intended for public use
 		
 		virtual u32 handleEvent(wsEvent *event);
+
+		void markInvalid(const wsRegion &invalid);
+			// called by the app before update() to set WIN_STATE_INVALID
+			// on the windows that intersect the invalid region, and
+			// WIN_STATE_SUBTREE_DIRTY on the paths to them.
 		
 	protected:
 		
@@ -39,6 +58,18 @@ class wsTopLevelWindow : public wsWindow
 		
 		wsTopLevelWindow *m_pPrevWindow;
 		wsTopLevelWindow *m_pNextWindow;
+
+	private:
+
+		void rebuildIndex();
+		void indexWindow(wsWindow *pWin, bool fill);
+		void getCells(const wsRect &rect, u16 *c0, u16 *r0, u16 *c1, u16 *r1) const;
+
+		wsRect m_index_rect;						// the rect the grid was built over
+		u16 m_cell_start[WS_INDEX_CELLS + 1];		// offsets into m_index
+		u16 m_cell_fill[WS_INDEX_CELLS];
+		wsWindow **m_index;
+		u16 m_index_size;
 		
 };
 
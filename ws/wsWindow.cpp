@@ -100,11 +100,13 @@ wsWindow::wsWindow(
 	m_pFirstChild  = 0;
 	m_pLastChild   = 0;
 	m_numChildren  = 0;
+	m_num_tickers  = 0;
 	m_frame_width  = 1;
 
 	if (m_pParent)
 	{
 		m_pParent->addChild(this);
+		setSubtreeDirty();
 
 		m_pDC = m_pParent->getDC();
 		m_pFont = m_pParent->getFont();
@@ -154,6 +156,7 @@ void wsWindow::onSize()
 
 	m_clip_abs.assign(m_rect_abs);
 	m_clip_client.assign(m_rect_client);
+	setIndexStale();
 
 	if (m_pParent)
 	{
@@ -220,6 +223,7 @@ void wsWindow::addChild(wsWindow *pWin)
 	}
 	m_pLastChild = pWin;
 	m_numChildren++;
+	setIndexStale();
 }
 
 
@@ -240,11 +244,75 @@ void wsWindow::deleteChild(wsWindow *pWin)
 		m_pLastChild = pWin->m_pPrevSibling;
 
 	m_numChildren--;
+	setIndexStale();
+
+	if (pWin->m_num_tickers)
+	{
+		for (wsWindow *p = this; p; p = p->m_pParent)
+			p->m_num_tickers -= pWin->m_num_tickers;
+	}
 
 	m_pDC->invalidate(pWin->m_rect_abs);
 }
 
 
+void wsWindow::setSubtreeDirty()
+	// mark the path from our parent up to the root so
+	// that update() will find its way down to us.  We
+	// can stop at the first ancestor that is already marked.
+{
+	for (wsWindow *p = m_pParent; p; p = p->m_pParent)
+	{
+		if (p->m_state & WIN_STATE_SUBTREE_DIRTY)
+			break;
+		setBit(p->m_state,WIN_STATE_SUBTREE_DIRTY);
+	}
+}
+
+
+void wsWindow::setIndexStale()
+	// tell our top level window to rebuild its index
+{
+	for (wsWindow *p = this; p; p = p->m_pParent)
+	{
+		if (p->m_style & WIN_STYLE_TOP_LEVEL)
+		{
+			setBit(p->m_state,WIN_STATE_INDEX_STALE);
+			break;
+		}
+	}
+}
+
+
+void wsWindow::setStateBits(u32 bits)
+{
+	setBit(m_state,bits);
+	if (bits & (WIN_STATE_UPDATE | WIN_STATE_DRAW | WIN_STATE_REDRAW))
+		setSubtreeDirty();
+}
+
+
+void wsWindow::setWantsFrameTick(bool wants)
+	// Windows that override updateFrame() call this, typically
+	// from their constructor.  The counts let updateFrame() skip
+	// whole subtrees that have nobody polling in them.
+{
+	if (wants == !!(m_state & WIN_STATE_FRAME_TICK))
+		return;
+	if (wants)
+		setBit(m_state,WIN_STATE_FRAME_TICK);
+	else
+		clearBit(m_state,WIN_STATE_FRAME_TICK);
+	for (wsWindow *p = this; p; p = p->m_pParent)
+	{
+		if (wants)
+			p->m_num_tickers++;
+		else
+			p->m_num_tickers--;
+	}
+}
+
+
 
 wsWindow *wsWindow::findChildByID(u16 id)
 {
@@ -277,10 +345,10 @@ void wsWindow::onDraw()
 		if (m_state & WIN_STATE_INVALID)
 		{
 			printf("INVALID(%d,%d,%d,%d) ",
-				m_pDC->getInvalid().xs,
-				m_pDC->getInvalid().ys,
-				m_pDC->getInvalid().xe,
-				m_pDC->getInvalid().ye);
+				m_pDC->getInvalid().getBounds().xs,
+				m_pDC->getInvalid().getBounds().ys,
+				m_pDC->getInvalid().getBounds().xe,
+				m_pDC->getInvalid().getBounds().ye);
 		}
 		printf("\n");
 	#endif
@@ -289,10 +357,10 @@ void wsWindow::onDraw()
 	#ifdef DEBUG_UPDATE
 		if (!m_pDC->getInvalid().isEmpty())
 			DBG_UPDATE(1,"draw(%08x:%d) invalid(%d,%d,%d,%d)\n",(u32)this,m_id,
-				m_pDC->getInvalid().xs,
-				m_pDC->getInvalid().ys,
-				m_pDC->getInvalid().xe,
-				m_pDC->getInvalid().ye);
+				m_pDC->getInvalid().getBounds().xs,
+				m_pDC->getInvalid().getBounds().ys,
+				m_pDC->getInvalid().getBounds().xe,
+				m_pDC->getInvalid().getBounds().ye);
 	#endif
 
 	if (m_style & WIN_STYLE_3D)
@@ -363,7 +431,7 @@ void wsWindow::resize(s32 xs, s32 ys, s32 xe, s32 ye )
 {
 	m_pDC->invalidate(m_rect_abs);
 	m_rect.assign(xs,ys,xe,ye);
-	setBit(m_state,WIN_STATE_UPDATE);
+	setStateBits(WIN_STATE_UPDATE);
 }
 
 void wsWindow::move( s32 x, s32 y )
@@ -372,7 +440,7 @@ void wsWindow::move( s32 x, s32 y )
 	s32 w = m_rect.xe - m_rect.xs + 1;
 	s32 h = m_rect.ye - m_rect.ys + 1;
 	m_rect.assign(x,y,x+w-1,y+h-1);
-	setBit(m_state,WIN_STATE_UPDATE);
+	setStateBits(WIN_STATE_UPDATE);
 
 }
 
@@ -382,7 +450,7 @@ void wsWindow::show()
 {
 	if (!(m_state & WIN_STATE_VISIBLE))
 	{
-		setBit(m_state,WIN_STATE_VISIBLE | WIN_STATE_DRAW);
+		setStateBits(WIN_STATE_VISIBLE | WIN_STATE_DRAW);
 	}
 }
 
@@ -403,17 +471,26 @@ void wsWindow::hide()
 	{
 		m_pDC->invalidate(m_rect_abs);
 		clearBit(m_state,WIN_STATE_VISIBLE);
+		setSubtreeDirty();
+			// so that our children clear their PARENT_VISIBLE bits
 	}
 }
 
 
 
-wsWindow* wsWindow::hitTest(s32 x, s32 y)
+bool wsWindow::hits(s32 x, s32 y) const
 {
-	if ((m_style & WIN_STYLE_TOUCH) &&
+	return
+		(m_style & WIN_STYLE_TOUCH) &&
 		(m_state & WIN_STATE_VISIBLE) &&
 		(m_state & WIN_STATE_PARENT_VISIBLE) &&
-		m_clip_abs.intersects(x,y))
+		m_clip_abs.intersects(x,y);
+}
+
+
+wsWindow* wsWindow::hitTest(s32 x, s32 y)
+{
+	if (hits(x,y))
 	{
 		setBit(m_state,WIN_STATE_IS_TOUCHED);
 		onUpdateTouch(1);
@@ -623,24 +700,24 @@ void wsWindow::updateTouch(touchState_t *touch_state)
 void wsWindow::onUpdateTouch(bool touched)
 	// called before validation, sets the DRAW bit directly
 {
-	setBit(m_state,WIN_STATE_DRAW);
+	setStateBits(WIN_STATE_DRAW);
 }
 
 
 void wsWindow::onUpdateClick()
 {
-	getApplication()->addEvent(new wsEvent(
+	getApplication()->addEvent(
 		EVT_TYPE_WINDOW,
 		EVENT_CLICK,
-		this ));
+		this );
 }
 
 void wsWindow::onUpdateLongClick()
 {
-	getApplication()->addEvent(new wsEvent(
+	getApplication()->addEvent(
 		EVT_TYPE_WINDOW,
 		EVENT_LONG_CLICK,
-		this ));
+		this );
 }
 
 void wsWindow::onUpdateDblClick()
@@ -786,8 +863,43 @@ void wsWindow::onUpdateDragEnd()
 
 
 
+bool wsWindow::needsUpdate() const
+	// Called by the parent, before our update(), to see if there
+	// is anything for us, or any of our children, to do.  Windows
+	// that are not on a path to a dirty window, and which do not
+	// intersect the invalid region, are skipped entirely.
+	// Windows under the invalid region have already been marked
+	// with WIN_STATE_INVALID by wsTopLevelWindow::markInvalid().
+{
+	if (m_state & (
+		WIN_STATE_UPDATE |
+		WIN_STATE_DRAW |
+		WIN_STATE_REDRAW |
+		WIN_STATE_INVALID |
+		WIN_STATE_SUBTREE_DIRTY))
+		return true;
+	if (!m_pParent)
+		return true;
+	if (m_pParent->m_state & (
+		WIN_STATE_UPDATE |
+		WIN_STATE_DRAW |
+		WIN_STATE_REDRAW ))
+		return true;
+
+	bool parent_visible =
+		(m_pParent->m_state & WIN_STATE_VISIBLE) &&
+		(m_pParent->m_state & WIN_STATE_PARENT_VISIBLE);
+	return parent_visible != !!(m_state & WIN_STATE_PARENT_VISIBLE);
+}
+
+
 void wsWindow::update()
 {
+	// clear this first, so that any window that
+	// changes during the update marks us again
+
+	clearBit(m_state,WIN_STATE_SUBTREE_DIRTY);
+
 	// inherit bits from parent
 
 	if (m_pParent)
@@ -829,9 +941,9 @@ void wsWindow::update()
 	if ((m_state & WIN_STATE_PARENT_VISIBLE) &&
 		(m_state & WIN_STATE_VISIBLE))
 	{
-		const wsRect &invalid = m_pDC->getInvalid();
+		const wsRegion &invalid = m_pDC->getInvalid();
 		if (!(m_state & (WIN_STATE_DRAW | WIN_STATE_REDRAW)) &&
-		    m_rect_abs.intersects(invalid))
+		    invalid.intersects(m_rect_abs))
 			setBit(m_state,WIN_STATE_INVALID);
 
 		if (m_state & (WIN_STATE_DRAW | WIN_STATE_REDRAW | WIN_STATE_INVALID))
@@ -845,7 +957,8 @@ void wsWindow::update()
 
 	for (wsWindow *p = m_pFirstChild; p; p=p->m_pNextSibling)
 	{
-		p->update();
+		if (p->needsUpdate())
+			p->update();
 	}
 
 	// clear our handled state bits
@@ -869,10 +982,12 @@ void wsWindow::update()
 // virtual
 
 void wsWindow::updateFrame()
-	// an update call tree that is called UI_FRAME_RATE times per second
+	// an update call tree that is called every frame
+	// only called on the subtrees that have registered tickers.
 {
 	for (wsWindow *p = m_pFirstChild; p; p=p->m_pNextSibling)
 	{
-		p->updateFrame();
+		if (p->m_num_tickers)
+			p->updateFrame();
 	}
 }
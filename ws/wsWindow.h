@@ -105,6 +105,10 @@ class wsEventHandler
 #define WIN_STATE_TOUCH_CHANGED		0x00002000
 #define WIN_STATE_DRAGGING			0x00004000
 
+#define WIN_STATE_SUBTREE_DIRTY		0x00010000
+#define WIN_STATE_FRAME_TICK		0x00020000
+#define WIN_STATE_INDEX_STALE		0x00040000
+
 // How it works.
 //
 //     UPDATE ==> DRAW ==> REDRAW
@@ -118,7 +122,7 @@ class wsEventHandler
 //     		!DRAW && !REDRAW && intersects(invalid) => INVALID
 //          DRAW | REDRAW | INVALID => onDraw()
 //  		onDraw() => setClip(m_clip_xxx,INVALID);
-//          setClip(INVALID) ==> clip.intersect(invalid)
+//          setClip(INVALID) ==> clip.intersect(each invalid rect)
 //
 // STATE_UPDATE means that the parent coordinates (may have)
 //    changed and so the object's absolute and clipping coordinates
@@ -141,6 +145,18 @@ class wsEventHandler
 //    so objects know that if their parent is not visible, they
 //    should not be drawn (or accept hit tests), while yet allowing
 //    each object to maintain it's own visibility state.
+//
+// SUBTREE_DIRTY is set on every ancestor of a window whose UPDATE,
+//    DRAW, or REDRAW bits are set with setStateBits(), so update()
+//    only walks down the paths to windows that changed, or that
+//    intersect the invalid region.  Derived classes must use
+//    setStateBits() rather than setting those bits directly.
+// FRAME_TICK is set by setWantsFrameTick() on windows that override
+//    updateFrame().  Each window counts the tickers in its subtree
+//    and updateFrame() is only called on subtrees that have some.
+// INDEX_STALE is set on a top level window when any window in it
+//    is added, deleted, or sized, so that it rebuilds its spatial
+//    index (see wsTopWindow.h) before the next lookup.
 
 
 // #define WIN_STATE_ENABLE            	0x00000002
@@ -170,7 +186,8 @@ class wsWindow : public wsEventHandler
 		u16 getID() const			{ return m_id; }
 		u32 getStyle() const	   	{ return m_style; };
 		u32 getState() const		{ return m_state; }
-		void setStateBits(u32 bits)	{ setBit(m_state,bits); }
+		void setStateBits(u32 bits);
+		void setWantsFrameTick(bool wants);
 		void setStyle(u32 style)	{ m_style = style; };
 
 		wsColor getForeColor() const	{ return m_fore_color; }
@@ -235,8 +252,12 @@ class wsWindow : public wsEventHandler
 		wsDC *getDC() const		{ return m_pDC; }
 		void setDC(wsDC *pDC)	{ m_pDC = pDC; }
 
-		virtual void updateFrame();		// an update call tree that is called UI_FRAME_RATE times per second
+		virtual void updateFrame();		// an update call tree that is called every frame
 		virtual void update();
+		bool needsUpdate() const;
+		void setSubtreeDirty();
+		void setIndexStale();
+		bool hits(s32 x, s32 y) const;
 		virtual void onDraw();
 		virtual void onSize();
 		virtual wsWindow *hitTest(s32 x, s32 y);
@@ -270,6 +291,7 @@ class wsWindow : public wsEventHandler
 		wsRect m_clip_client;   // the abs rect clipped by the parent client area
 
 		u16 m_numChildren;
+		u16 m_num_tickers;		// windows in this subtree with WIN_STATE_FRAME_TICK
 		wsWindow *m_pParent;
 		wsWindow *m_pPrevSibling;
 		wsWindow *m_pNextSibling;
@@ -85,20 +85,31 @@ CTrackDisplay::CTrackDisplay(
 	m_area.ys = ys;
 	m_area.xe = xe;
 	m_area.ye = ye;
-	m_buffer = 0;
+	m_pRecorder = 0;
+	m_channel = 0;
+	m_envelope = new recorder_minmax_t[xe - xs + 1];
 	SetText("NO BUFFER!!");
 	SetForeColor(C_RED);
 	SetBackColor(C_BLACK);
 }
 
 
+CTrackDisplay::~CTrackDisplay()
+{
+	delete [] m_envelope;
+	m_envelope = 0;
+}
+
+
 void CTrackDisplay::init(
-	s16 *buffer,
+	AudioRecorder *pRecorder,
+	u8 channel,
 	u32 num_samples,
 	u16 sample_rate,
 	double zoom)
 {
-	m_buffer = buffer;
+	m_pRecorder = pRecorder;
+	m_channel = channel;
 	m_fNumSamples = (double) num_samples;
 	m_fSampleRate = (double) sample_rate;
 	m_fZoom = zoom;
@@ -156,8 +167,11 @@ void CTrackDisplay::onZoomChange()
 
 
 void CTrackDisplay::draw(bool cold)
+	// draws the min..max envelope of each pixel column,
+	// from the recorder's summaries, so it costs the same
+	// at any zoom.
 {
-	if (!m_buffer)
+	if (!m_pRecorder)
 		return;
 	
 	UG_FillFrame(m_area.xs, m_area.ys, m_area.xe, m_area.ye, C_BLACK);
@@ -168,42 +182,30 @@ void CTrackDisplay::draw(bool cold)
 	u16 y_zero = m_area.ys + height/2;
 	UG_DrawLine(m_area.xs, y_zero, m_area.xe, y_zero, C_DARK_BLUE);
 	
-	s16 last_y = 0;
-	double area_height = m_area.ye - m_area.ys + 1;
+	// Each column starts at its own rounded down sample, from the
+	// fractional samples per pixel, so that the envelope does not
+	// drift off the end of the window at zooms where the ratio
+	// is not a whole number.
 	
-	for (double fTime = m_fWindowLeft;
-				fTime < m_fWindowRight;
-				fTime += m_fPixelDuration / 2.0)
+	u16 width = m_area.xe - m_area.xs + 1;
+	u32 start = m_fWindowLeft / m_fSampleDuration;
+	double samples_per_pixel = m_fPixelDuration / m_fSampleDuration;
+	u32 col_start = start;
+	for (u16 x=0; x<width; x++)
 	{
-		u16 x = ((fTime-m_fWindowLeft) / m_fPixelDuration);
-		u16 screen_x = x + m_area.xs;
-		u32 sample_num = (fTime / m_fSampleDuration);
-		
-		assert((double)sample_num < m_fNumSamples);
-		if ((double)sample_num >= m_fNumSamples)
-			return;
+		u32 col_end = start + (u32) ((x + 1) * samples_per_pixel);
+		m_pRecorder->getEnvelope(m_channel,col_start,col_end-col_start,1,&m_envelope[x]);
+		col_start = col_end;
+	}
 
-		// Scale the s16 -32767..32767 to Area.ye-5..Area.ys+5;
-		
-		double value = m_buffer[sample_num];
-			// -32768 .. 32767
-		value = 32767.0 - value;
-			// 65385 .. 0
-		value /= 65535.0;
-			// 1..0
-		value *= area_height;
-			// scaled to the area height
-		value += m_area.ys;
-			// offset to the areay
-		u16 y = value;
-			// converted to an integer
-
-		if (last_y == 0)
-			last_y = y;
-
-		UG_DrawLine(screen_x,last_y,screen_x,y,C_YELLOW);
-
-		last_y = y;
+	// Scale the s16 -32768..32767 to the area, top to bottom
+	
+	s32 area_height = height;
+	for (u16 x=0; x<width; x++)
+	{
+		s16 y_max = m_area.ys + ((32767 - (s32)m_envelope[x].max) * area_height) / 65536;
+		s16 y_min = m_area.ys + ((32767 - (s32)m_envelope[x].min) * area_height) / 65536;
+		UG_DrawLine(m_area.xs + x,y_max,m_area.xs + x,y_min,C_YELLOW);
 	}
 }
 
@@ -298,7 +300,8 @@ CRecordTrack::CRecordTrack(
 	if (m_pRecorder)
 	{
 		m_pTrack->init(
-			m_pRecorder->getBuffer(channel_num),
+			m_pRecorder,
+			channel_num,
 			RECORD_BUFFER_SAMPLES,
 			RECORD_SAMPLE_RATE,
 			1.00);
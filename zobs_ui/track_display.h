@@ -82,9 +82,11 @@ public:
         u16 ys,
         u16 xe,
         u16 ye );
+    ~CTrackDisplay();
     
     void init(
-        s16 *buffer,
+        AudioRecorder *pRecorder,
+        u8 channel,
         u32 num_samples,
         u16 sample_rate,
         double zoom);
@@ -105,7 +107,9 @@ private:
     bool    m_enabled;      // show disabled or enabled color scheme
     CWindow *m_pWin;
     UG_AREA m_area;
-    s16     *m_buffer;
+    AudioRecorder *m_pRecorder;
+    u8      m_channel;
+    recorder_minmax_t *m_envelope;      // one per pixel column
     
     double   m_fZoom;
     double   m_fNumSamples;
@@ -101,6 +101,7 @@ void CStatusWindow::Callback(UG_MESSAGE *pMsg)
 #define FT_S32_PTR       0x0020
 #define FT_U32_FXN       0x0100
 #define FT_CPU_FXN       0x0200
+#define FT_CPU_PTR       0x0400
 #define FTS_CPU          0x1000
 #define FTS_CPU_MAX      0x2000
 
@@ -119,6 +120,8 @@ typedef struct formEntryStruct
 formEntry *firstFormEntry = 0;
 formEntry *lastFormEntry = 0;
 s32 block_diff = 0;
+audio_system_stats_t audio_stats;
+    // read once per frame from the AudioSystem snapshot
 
 extern u32 main_loop_counter;
 
@@ -183,12 +186,12 @@ void CStatusWindow::init()
     addFormEntry(5, 27, FT_U32_PTR, "%-8d", &bcm_pcm.underflow_count);
     
     addFormEntry(6, 15, FT_S32_PTR, "%-8d",    &block_diff);
-    addFormEntry(0, 52, FT_U32_PTR, "%-8d",    &AudioSystem::s_nInUpdate);
-    addFormEntry(2, 52, FT_U32_PTR, "%-8d",    &AudioSystem::s_numOverflows);
-    addFormEntry(3, 52, FT_CPU_FXN, "%03.2f",  (void *)&AudioSystem::getCPUCycles);
-    addFormEntry(3, 74, FT_CPU_FXN, "%03.2f",  (void *)&AudioSystem::getCPUCyclesMax);
-    addFormEntry(4, 52, FT_U32_FXN, "%-8d",    (void *)&AudioSystem::getMemoryBlocksUsed);
-    addFormEntry(4, 74, FT_U32_FXN, "%-8d",    (void *)&AudioSystem::getMemoryBlocksUsedMax);
+    addFormEntry(0, 52, FT_U32_PTR, "%-8d",    &audio_stats.in_update);
+    addFormEntry(2, 52, FT_U32_PTR, "%-8d",    &audio_stats.num_overflows);
+    addFormEntry(3, 52, FT_CPU_PTR, "%03.2f",  &audio_stats.cpu_cycles);
+    addFormEntry(3, 74, FT_CPU_PTR, "%03.2f",  &audio_stats.cpu_cycles_max);
+    addFormEntry(4, 52, FT_U32_PTR, "%-8d",    &audio_stats.blocks_used);
+    addFormEntry(4, 74, FT_U32_PTR, "%-8d",    &audio_stats.blocks_used_max);
     
     int y = 8;
     addFormEntry(y++,0,FT_STATIC_TEXT,"Object       CPU        MAX");
@@ -225,6 +228,7 @@ void CStatusWindow::draw()
     if (!m_bStarted)
         init();
         
+    AudioSystem::getStats(&audio_stats);
     block_diff = ((s32)bcm_pcm.out_block_count) - ((s32)bcm_pcm.in_block_count);
         // the difference between in and out block counts, should be very close to 0
     float usPerBuffer = 1000000 / bcm_pcm.getSampleRate();
@@ -271,6 +275,15 @@ void CStatusWindow::draw()
                     }
                     break;
 
+                case FT_CPU_PTR :
+                    value = *(u32 *) f->fxn_ptr;
+                    if (value != f->last_value)
+                    {
+                        float us = ((float)value) / usPerBuffer;
+                        show(f->x,f->y,f->format,us);
+                    }
+                    break;
+
                 case FTS_CPU :
                     value = ((AudioStream *) f->fxn_ptr)->getCPUCycles();
                     if (value != f->last_value)